@@ -1,5 +1,8 @@
 #include "cli_handler.hpp"
 #include "color.hpp"
+#include "core/logger.hpp"
+#include "core/metrics.hpp"
+#include "core/file_utils.hpp"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
@@ -15,6 +18,13 @@ CLIHandler::CLIHandler(OreoBuild::BuildSystem& bs) : buildSystem(bs) {
     cleanLogDays = 0;
     caseInsensitiveSearch = false;
     listBuildIdsRequested = false;
+    impactLimit = 20;
+    explain = false;
+    keepGoing = 0;
+    topRss = 0;
+    shardIndex = 0;
+    shardCount = 1;
+    outputFormat = "text";
 }
 
 int CLIHandler::run(int argc, char* argv[]) {
@@ -30,20 +40,48 @@ int CLIHandler::run(int argc, char* argv[]) {
 
     parseArguments(std::vector<std::string>(argv, argv + argc));
 
-    return executeCommand();
+    auto start = std::chrono::steady_clock::now();
+    int result = executeCommand();
+    if (!metricsFile.empty() || !metricsJsonFile.empty()) {
+        writeMetrics(result == 0, std::chrono::steady_clock::now() - start);
+    }
+    return result;
+}
+
+void CLIHandler::writeMetrics(bool succeeded, std::chrono::steady_clock::duration elapsed) {
+    OreoBuild::Metrics::set(OreoBuild::Gauge::Success, succeeded ? 1 : 0);
+    OreoBuild::Metrics::set(OreoBuild::Gauge::DurationSeconds, std::chrono::duration<double>(elapsed).count());
+    // Written atomically, so a textfile collector never reads half a file.
+    if (!metricsFile.empty() &&
+        !OreoBuild::FileUtils::writeFileAtomically(metricsFile, OreoBuild::Metrics::toOpenMetrics())) {
+        OREO_WARN(OreoBuild::LogCategory::General, "Warning: Unable to write metrics to " << metricsFile);
+    }
+    if (!metricsJsonFile.empty() &&
+        !OreoBuild::FileUtils::writeFileAtomically(metricsJsonFile, OreoBuild::Metrics::toJson())) {
+        OREO_WARN(OreoBuild::LogCategory::General, "Warning: Unable to write metrics to " << metricsJsonFile);
+    }
 }
 
 bool CLIHandler::isValidCommand(const std::string& cmd) {
-    return cmd == "build" || cmd == "clean" || cmd == "debug" || cmd == "release" || cmd == "build-type";
+    return cmd == "build" || cmd == "clean" || cmd == "debug" || cmd == "release" || cmd == "build-type" || cmd == "impact" ||
+           cmd == "pgo" || cmd == "plan" || cmd == "test" ||
+           cmd == "query";
 }
 
 void CLIHandler::parseArguments(const std::vector<std::string>& args) {
-    for (const auto& arg : args) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const auto& arg = args[i];
         if (arg == "--help") {
             command = "--help";
             return;  // Exit parsing immediately if --help is found
         } else if (arg == "--force") {
             forceClean = true;
+        } else if (arg == "--explain") {
+            explain = true;
+        } else if (arg == "-k" && i + 1 < args.size()) {
+            keepGoing = std::stoul(args[++i]);
+        } else if (arg.size() > 2 && arg.substr(0, 2) == "-k") {
+            keepGoing = std::stoul(arg.substr(2));
         } else if (arg == "-v") {
             verbosityLevel = OreoBuild::BuildSystem::VerbosityLevel::Verbose;
         } else if (arg == "-vv") {
@@ -52,6 +90,42 @@ void CLIHandler::parseArguments(const std::vector<std::string>& args) {
             verbosityLevel = OreoBuild::BuildSystem::VerbosityLevel::ExtremelyVerbose;
         } else if (arg.substr(0, 6) == "--log=") {
             logFile = arg.substr(6);
+        } else if (arg.substr(0, 11) == "--log-file=") {
+            textLogFile = arg.substr(11);
+        } else if (arg.substr(0, 11) == "--log-json=") {
+            jsonLogFile = arg.substr(11);
+        } else if (arg.substr(0, 10) == "--metrics=") {
+            metricsFile = arg.substr(10);
+        } else if (arg.substr(0, 15) == "--metrics-json=") {
+            metricsJsonFile = arg.substr(15);
+        } else if (arg.substr(0, 17) == "--log-categories=") {
+            logCategories = arg.substr(17);
+        } else if (arg == "--train" && i + 1 < args.size()) {
+            trainCommand = args[++i];
+        } else if (arg.substr(0, 8) == "--train=") {
+            trainCommand = arg.substr(8);
+        } else if (arg.substr(0, 8) == "--shard=") {
+            size_t slash = arg.find('/', 8);
+            if (slash != std::string::npos) {
+                shardIndex = std::stoul(arg.substr(8, slash - 8));
+                shardCount = std::stoul(arg.substr(slash + 1));
+            }
+        } else if (arg.substr(0, 11) == "--variants=") {
+            std::stringstream list(arg.substr(11));
+            std::string variant;
+            while (std::getline(list, variant, ',')) {
+                if (!variant.empty()) {
+                    variants.push_back(variant);
+                }
+            }
+        } else if (arg.substr(0, 9) == "--format=") {
+            outputFormat = arg.substr(9);
+        } else if (arg == "--top-rss") {
+            topRss = 10;
+        } else if (arg.substr(0, 10) == "--top-rss=") {
+            topRss = std::stoul(arg.substr(10));
+        } else if (arg.substr(0, 6) == "--top=") {
+            impactLimit = std::stoul(arg.substr(6));
         } else if (arg.substr(0, 11) == "--view-log=") {
             viewLogFile = arg.substr(11);
         } else if (arg.substr(0, 12) == "--clean-log=") {
@@ -80,6 +154,8 @@ void CLIHandler::parseArguments(const std::vector<std::string>& args) {
             listBuildIdsRequested = true;
         } else if (command.empty()) {
             command = arg;
+        } else if (command == "query") {
+            queryArgs.push_back(arg);
         } else if (target == "all") {
             target = arg;
         }
@@ -92,7 +168,33 @@ int CLIHandler::executeCommand() {
         return 0;
     }
 
+    if (outputFormat != "text" && outputFormat != "json") {
+        OREO_ERROR(OreoBuild::LogCategory::General, Color::Red << "Error: --format expects text or json" << Color::Reset);
+        return 1;
+    }
+    // JSON output owns stdout; only warnings and errors still get through.
+    if (outputFormat == "json" && verbosityLevel == OreoBuild::BuildSystem::VerbosityLevel::Normal) {
+        verbosityLevel = OreoBuild::BuildSystem::VerbosityLevel::Quiet;
+    }
     buildSystem.setVerbosityLevel(verbosityLevel);
+    buildSystem.setExplain(explain);
+    buildSystem.setKeepGoing(keepGoing);
+    buildSystem.setTopRss(topRss);
+
+    try {
+        if (!logCategories.empty()) {
+            OreoBuild::Logger::setCategoryMask(OreoBuild::Logger::parseCategories(logCategories));
+        }
+        if (!textLogFile.empty()) {
+            OreoBuild::Logger::addSink(std::make_unique<OreoBuild::FileSink>(textLogFile));
+        }
+        if (!jsonLogFile.empty()) {
+            OreoBuild::Logger::addSink(std::make_unique<OreoBuild::JsonSink>(jsonLogFile));
+        }
+    } catch (const std::exception& e) {
+        OREO_ERROR(OreoBuild::LogCategory::General, Color::Red << "Error: " << e.what() << Color::Reset);
+        return 1;
+    }
 
     // Handle log-related commands
     if (handleLogCommands()) {
@@ -123,6 +225,34 @@ int CLIHandler::executeCommand() {
         buildSystem.getConfig().setBuildType(OreoBuild::BuildType::Release);
         std::cout << Color::Green << "Build type set to Release" << Color::Reset << std::endl;
         return 0;
+    } else if (command == "plan") {
+        return buildSystem.plan() ? 0 : 1;
+    } else if (command == "test") {
+        if (shardCount == 0 || shardIndex >= shardCount) {
+            OREO_ERROR(OreoBuild::LogCategory::General, Color::Red << "Error: --shard expects <index>/<count> with index below count" << Color::Reset);
+            return 1;
+        }
+        return buildSystem.test(shardIndex, shardCount) ? 0 : 1;
+    } else if (command == "query") {
+        if (queryArgs.empty()) {
+            OREO_ERROR(OreoBuild::LogCategory::General, Color::Red << "Error: query expects deps <file>, rdeps <file> or path <from> <to>" << Color::Reset);
+            return 1;
+        }
+        std::vector<std::string> files(queryArgs.begin() + 1, queryArgs.end());
+        return buildSystem.query(queryArgs[0], files, outputFormat == "json") ? 0 : 1;
+    } else if (command == "impact") {
+        buildSystem.impact(impactLimit);
+        return 0;
+    } else if (command == "pgo") {
+        if (trainCommand.empty()) {
+            OREO_ERROR(OreoBuild::LogCategory::General, Color::Red << "Error: pgo needs a training command, e.g. --train \"{output} input.dat\"" << Color::Reset);
+            return 1;
+        }
+        bool succeeded = buildSystem.pgo(trainCommand);
+        OreoBuild::Logger::flush();
+        std::cout << (succeeded ? Color::Green : Color::Red)
+                  << (succeeded ? "PGO build completed successfully." : "PGO build failed.") << Color::Reset << std::endl;
+        return succeeded ? 0 : 1;
     } else if (command == "build-type") {
         displayBuildType();
         return 0;
@@ -177,7 +307,17 @@ bool CLIHandler::isLogCommand() const {
 
 int CLIHandler::executeBuildCommand() {
     auto buildType = buildSystem.getConfig().getBuildType();
-    std::cout << Color::Cyan << "Building in " << (buildType == OreoBuild::BuildType::Debug ? "Debug" : "Release") << " mode" << Color::Reset << std::endl;
+    // Config loading logs asynchronously; let it finish before the banner.
+    OreoBuild::Logger::flush();
+    if (!variants.empty()) {
+        std::string names;
+        for (const auto& variant : variants) {
+            names += (names.empty() ? "" : ", ") + variant;
+        }
+        std::cout << Color::Cyan << "Building variants " << names << Color::Reset << std::endl;
+    } else {
+        std::cout << Color::Cyan << "Building in " << (buildType == OreoBuild::BuildType::Debug ? "Debug" : "Release") << " mode" << Color::Reset << std::endl;
+    }
     
     if (!buildTypeOverride.empty()) {
         if (buildTypeOverride == "debug") {
@@ -185,22 +325,28 @@ int CLIHandler::executeBuildCommand() {
         } else if (buildTypeOverride == "release") {
             buildSystem.getConfig().setBuildType(OreoBuild::BuildType::Release);
         }
+        OreoBuild::Logger::flush();
         std::cout << Color::Yellow << "Build type overridden to: " << buildTypeOverride << Color::Reset << std::endl;
     }
 
     auto startTime = std::chrono::high_resolution_clock::now();
 
     std::string buildSummary;
-    int totalFiles = buildSystem.getConfig().getSourceFiles().size();
+    int totalFiles = buildSystem.getConfig().getSourceFiles().size() * std::max<size_t>(1, variants.size());
     int compiledFiles = 0;
 
     try {
-        buildSystem.build(target, [&](const std::string& file) {
+        auto progress = [&](const std::string& file) {
             compiledFiles++;
             if (verbosityLevel >= OreoBuild::BuildSystem::VerbosityLevel::Verbose) {
                 showProgress(compiledFiles, totalFiles);
             }
-        });
+        };
+        bool succeeded = variants.empty() ? buildSystem.build(target, progress)
+                                          : buildSystem.buildVariants(variants, progress);
+        if (!succeeded) {
+            return 1;
+        }
 
         if (compiledFiles > 0) {
             buildSummary = "Compiled " + std::to_string(compiledFiles) + " file(s).";
@@ -254,11 +400,33 @@ void CLIHandler::printDetailedHelp() {
     std::cout << "  debug             Set build type to Debug" << std::endl;
     std::cout << "  release           Set build type to Release" << std::endl;
     std::cout << "  build-type        Display the current build type" << std::endl;
+    std::cout << "  impact            Rank headers by the rebuild cost of changing them" << std::endl;
+    std::cout << "  pgo               Instrumented build, training run, then a profile-optimized build" << std::endl;
+    std::cout << "  plan              Show what a build would run and why, with an estimated wall time" << std::endl;
+    std::cout << "  test              Build, then run the tests whose inputs changed since they last passed" << std::endl;
+    std::cout << "  query deps <file>       List the files <file> depends on in the last build" << std::endl;
+    std::cout << "  query rdeps <file>      List the files, translation units marked, that depend on <file>" << std::endl;
+    std::cout << "  query path <from> <to>  Show an include chain leading from <from> to <to>" << std::endl;
     std::cout << std::endl;
     std::cout << "OPTIONS:" << std::endl;
     std::cout << "  --force           Force clean without confirmation" << std::endl;
+    std::cout << "  --explain         Log why each step of a build runs" << std::endl;
+    std::cout << "  -k <n>            Keep compiling through up to n failed compiles (default 0: stop at the first)" << std::endl;
+    std::cout << "  --top=<n>         Number of entries shown by impact (default 20)" << std::endl;
+    std::cout << "  --top-rss[=<n>]   After a build, list the n steps with the largest peak RSS (default 10)" << std::endl;
+    std::cout << "  --shard=<i>/<n>   Run only the i-th of n test shards (0-based)" << std::endl;
+    std::cout << "  --format=<fmt>    Output of query: text (default) or json" << std::endl;
+    std::cout << "  --variants=<list> Build these variants together, e.g. debug,release,asan; others are" << std::endl;
+    std::cout << "                    declared with variant_flags[name] and variant_build_type[name]" << std::endl;
+    std::cout << "  --train <command> Training workload for pgo; {output} expands to the instrumented binary" << std::endl;
     std::cout << "  -v, -vv, -vvv     Set verbosity level (verbose, more verbose, very verbose)" << std::endl;
     std::cout << "  --log=<file>      Append build log to specified file" << std::endl;
+    std::cout << "  --log-file=<file> Write all diagnostic output, with timestamps, to <file>" << std::endl;
+    std::cout << "  --log-json=<file> Write diagnostic output as JSON lines to <file>" << std::endl;
+    std::cout << "  --metrics=<file>  Write build metrics to <file> in OpenMetrics text format" << std::endl;
+    std::cout << "  --metrics-json=<file>  Write the same metrics to <file> as a JSON summary" << std::endl;
+    std::cout << "  --log-categories=<list>  Only show verbose output for these categories" << std::endl;
+    std::cout << "                    (general,config,deps,compile,link,cache,distributed or all)" << std::endl;
     std::cout << "  --view-log=<file> View the contents of the specified log file" << std::endl;
     std::cout << "  --clean-log=<file>:<days>  Remove log entries older than <days> days" << std::endl;
     std::cout << "  --search-log=<file>:<term> Search log file for entries containing <term>" << std::endl;
@@ -270,7 +438,12 @@ void CLIHandler::printDetailedHelp() {
     std::cout << "EXAMPLES:" << std::endl;
     std::cout << "  oreobuild config.txt build" << std::endl;
     std::cout << "  oreobuild config.txt clean --force" << std::endl;
+    std::cout << "  oreobuild config.txt pgo --train \"{output} --benchmark\"" << std::endl;
+    std::cout << "  oreobuild config.txt test --shard=0/4" << std::endl;
+    std::cout << "  oreobuild config.txt build --variants=debug,release,asan" << std::endl;
+    std::cout << "  oreobuild config.txt query rdeps include/common.h --format=json" << std::endl;
     std::cout << "  oreobuild config.txt build -vv --log=build.log" << std::endl;
+    std::cout << "  oreobuild config.txt build -vv --log-categories=deps --log-json=build.jsonl" << std::endl;
     std::cout << "  oreobuild config.txt --search-log=build.log:error --case-insensitive" << std::endl;
     std::cout << "  oreobuild config.txt --compare-builds=build.log:220240814_143515:20240814_144326" << std::endl;
 }
@@ -457,7 +630,7 @@ void CLIHandler::appendBuildLog(const std::string& logFile, const std::string& t
         log << "\n--- Build Log Entry (ID: " << buildId << ") ---" << std::endl;
         log << "Date: " << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %X") << std::endl;
         log << "Build target: " << target << std::endl;
-        log << "Output file: " << buildSystem.getConfig().getOutputFile() << std::endl;
+        log << "Output file: " << buildSystem.getOutputPath() << std::endl;
         log << "Build type: " << (buildSystem.getConfig().getBuildType() == OreoBuild::BuildType::Debug ? "Debug" : "Release") << std::endl;
         log << "Total time: " << duration.count() << " µs (" 
             << std::fixed << std::setprecision(3) << duration.count() / 1000000.0 << " seconds)" << std::endl;
@@ -36,6 +36,7 @@ private:
     bool handleLogCommands();
     bool isLogCommand() const;
     int executeBuildCommand();
+    void writeMetrics(bool succeeded, std::chrono::steady_clock::duration elapsed);
 
     bool forceClean;
     OreoBuild::BuildSystem::VerbosityLevel verbosityLevel;
@@ -53,4 +54,19 @@ private:
     std::string compareId2;
     bool listBuildIdsRequested;
     std::string buildTypeOverride;
+    std::string textLogFile;
+    std::string jsonLogFile;
+    std::string logCategories;
+    std::string metricsFile;
+    std::string metricsJsonFile;
+    size_t impactLimit;
+    std::string trainCommand;
+    bool explain;
+    size_t keepGoing;
+    size_t topRss;
+    size_t shardIndex;
+    size_t shardCount;
+    std::vector<std::string> queryArgs;
+    std::vector<std::string> variants;
+    std::string outputFormat;
 };
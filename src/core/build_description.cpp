@@ -0,0 +1,120 @@
+#include "build_description.hpp"
+#include "hash.hpp"
+#include "logger.hpp"
+#include "process.hpp"
+#include "plugins/build_api.hpp"
+#include <cstdlib>
+#include <dlfcn.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef OREOBUILD_API_DIR
+#define OREOBUILD_API_DIR "src"
+#endif
+
+namespace OreoBuild {
+
+namespace {
+
+using DescriptionAbiVersionFn = uint32_t (*)();
+using DescribeFn = void (*)(DescriptionEmitFn emit, void* context);
+
+std::string getDescriptionCompiler() {
+    for (const char* name : {"OREOBUILD_CXX", "CXX"}) {
+        const char* value = std::getenv(name);
+        if (value && *value) {
+            return value;
+        }
+    }
+    return "c++";
+}
+
+std::string getApiIncludeDir() {
+    const char* value = std::getenv("OREOBUILD_INCLUDE_DIR");
+    return value && *value ? value : OREOBUILD_API_DIR;
+}
+
+void collectEntry(void* context, const char* key, const char* value) {
+    auto* entries = static_cast<std::vector<std::pair<std::string, std::string>>*>(context);
+    entries->emplace_back(key, value);
+}
+
+}
+
+bool BuildDescription::isDescription(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    return extension == ".cpp" || extension == ".cc" || extension == ".cxx";
+}
+
+std::string BuildDescription::compileCached(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open build description: " + path);
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+
+    std::string compiler = getDescriptionCompiler();
+    Hasher hasher;
+    hasher.update(content.str()).update(static_cast<uint64_t>(descriptionAbiVersion)).update(compiler);
+    std::filesystem::path cacheDir = std::filesystem::absolute(path).parent_path() / ".oreobuild";
+    std::string name = "build-" + hasher.hexDigest() + ".so";
+    std::filesystem::path library = cacheDir / name;
+    if (std::filesystem::exists(library)) {
+        OREO_VERBOSE(LogCategory::Config, "Using cached build description " << library.string());
+        return library.string();
+    }
+
+    std::filesystem::create_directories(cacheDir);
+    std::string scratch = library.string() + ".tmp";
+    std::string command = compiler + " -std=c++17 -shared -fPIC -O1 -I" + getApiIncludeDir() + " " + path +
+                          " -o " + scratch;
+    OREO_INFO(LogCategory::Config, "Compiling build description: " << path);
+    OREO_VERBOSE(LogCategory::Config, "Command: " << command);
+    Logger::flush();
+    if (Process::run(command) != 0) {
+        std::filesystem::remove(scratch);
+        throw std::runtime_error("Unable to compile build description: " + path);
+    }
+    // Renaming last means an interrupted compile never leaves a library
+    // that later runs would trust.
+    std::filesystem::rename(scratch, library);
+
+    // Only the current description is worth keeping.
+    for (const auto& entry : std::filesystem::directory_iterator(cacheDir)) {
+        std::string entryName = entry.path().filename().string();
+        if (entryName != name && entryName.rfind("build-", 0) == 0 && entry.path().extension() == ".so") {
+            std::error_code ec;
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+    return library.string();
+}
+
+std::vector<std::pair<std::string, std::string>> BuildDescription::evaluate(const std::string& path) {
+    std::string library = compileCached(path);
+    void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        throw std::runtime_error("Unable to load build description " + library + ": " + dlerror());
+    }
+
+    auto abiVersion = reinterpret_cast<DescriptionAbiVersionFn>(dlsym(handle, "oreobuild_description_abi_version"));
+    auto describe = reinterpret_cast<DescribeFn>(dlsym(handle, "oreobuild_describe"));
+    if (!abiVersion || !describe) {
+        dlclose(handle);
+        throw std::runtime_error("Build description " + path + " has no OREOBUILD_DESCRIPTION");
+    }
+    if (abiVersion() != descriptionAbiVersion) {
+        dlclose(handle);
+        throw std::runtime_error("Build description " + path + " was built for another oreobuild version");
+    }
+
+    std::vector<std::pair<std::string, std::string>> entries;
+    describe(collectEntry, &entries);
+    dlclose(handle);
+    return entries;
+}
+
+}
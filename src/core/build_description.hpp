@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace OreoBuild {
+
+// Loads C++ build descriptions (see plugins/build_api.hpp). The compiled
+// description is cached next to the source under .oreobuild/ as
+// build-<key>.so, where the key hashes the source, the description ABI
+// version and the compiler used, so an unchanged description costs one
+// dlopen.
+class BuildDescription {
+public:
+    // Returns the config entries the description sets, in order. Throws
+    // std::runtime_error when it cannot be compiled or loaded.
+    static std::vector<std::pair<std::string, std::string>> evaluate(const std::string& path);
+
+    static bool isDescription(const std::string& path);
+
+private:
+    static std::string compileCached(const std::string& path);
+};
+
+}
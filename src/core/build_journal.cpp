@@ -0,0 +1,124 @@
+#include "build_journal.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace OreoBuild {
+
+BuildJournal::~BuildJournal() {
+    close();
+}
+
+void BuildJournal::open(const std::string& newPath) {
+    close();
+    path = newPath;
+    // O_CLOEXEC keeps the descriptor out of the compilers the build spawns.
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        OREO_WARN(LogCategory::General, "Warning: Unable to open build journal: " << path);
+        return;
+    }
+    stopping = false;
+    flusher = std::thread(&BuildJournal::flushLoop, this);
+}
+
+void BuildJournal::close() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_one();
+        flusher.join();
+    }
+    sync();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+size_t BuildJournal::replay(const std::function<void(const std::string& kind, const std::string& value,
+                                                     const std::string& key)>& apply) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t applied = 0;
+    size_t start = 0;
+    for (size_t end = content.find('\n'); end != std::string::npos; start = end + 1, end = content.find('\n', start)) {
+        size_t kindEnd = content.find(' ', start);
+        size_t valueEnd = kindEnd < end ? content.find(' ', kindEnd + 1) : std::string::npos;
+        if (valueEnd >= end) {
+            continue;
+        }
+        apply(content.substr(start, kindEnd - start), content.substr(kindEnd + 1, valueEnd - kindEnd - 1),
+              content.substr(valueEnd + 1, end - valueEnd - 1));
+        applied++;
+    }
+    return applied;
+}
+
+void BuildJournal::append(const std::string& kind, const std::string& value, const std::string& key) {
+    if (fd < 0) {
+        return;
+    }
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        first = pending.empty();
+        pending.append(kind).append(1, ' ').append(value).append(1, ' ').append(key).append(1, '\n');
+    }
+    if (first) {
+        condition.notify_one();
+    }
+}
+
+void BuildJournal::sync() {
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    std::string batch;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        batch.swap(pending);
+    }
+    if (batch.empty() || fd < 0) {
+        return;
+    }
+    for (size_t offset = 0; offset < batch.size();) {
+        ssize_t count = ::write(fd, batch.data() + offset, batch.size() - offset);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            OREO_WARN(LogCategory::General, "Warning: Unable to write build journal: " << path);
+            return;
+        }
+        offset += static_cast<size_t>(count);
+    }
+    ::fdatasync(fd);
+}
+
+void BuildJournal::reset() {
+    sync();
+    std::lock_guard<std::mutex> writeLock(writeMutex);
+    if (fd >= 0 && ::ftruncate(fd, 0) == 0) {
+        ::fdatasync(fd);
+    }
+}
+
+void BuildJournal::flushLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        condition.wait(lock, [this] { return stopping || !pending.empty(); });
+        // Let the burst of steps finishing around now share one sync.
+        condition.wait_for(lock, batchWindow, [this] { return stopping; });
+        lock.unlock();
+        sync();
+        lock.lock();
+    }
+}
+
+}
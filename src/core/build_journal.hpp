@@ -0,0 +1,58 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace OreoBuild {
+
+// Append-only log of what a build learns step by step: each finished compile,
+// link or plugin step appends a record instead of waiting for the state files
+// to be saved at the end, so a build that crashes, is killed or runs out of
+// memory resumes where it stopped. Records are buffered and a background
+// thread writes each batch with a single fdatasync, at most batchWindow after
+// the first record in it. Once the full state has been saved, reset() empties
+// the journal.
+//
+// A record is one line, "<kind> <value> <key>", where key may contain spaces.
+class BuildJournal {
+public:
+    BuildJournal() = default;
+    ~BuildJournal();
+    BuildJournal(const BuildJournal&) = delete;
+    BuildJournal& operator=(const BuildJournal&) = delete;
+
+    // Syncs and closes the current journal, then opens path for appending,
+    // creating it when missing. Appends are dropped when it cannot be opened.
+    void open(const std::string& path);
+    // Calls apply for every complete record, oldest first; a line torn by a
+    // crash is skipped. Returns the number of records applied.
+    size_t replay(const std::function<void(const std::string& kind, const std::string& value,
+                                           const std::string& key)>& apply) const;
+    void append(const std::string& kind, const std::string& value, const std::string& key);
+    // Writes and syncs everything appended so far.
+    void sync();
+    // Discards every record, after their effect has been saved elsewhere.
+    void reset();
+
+private:
+    static constexpr std::chrono::milliseconds batchWindow{50};
+
+    std::string path;
+    int fd = -1;
+    // Guards pending and stopping.
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::string pending;
+    bool stopping = false;
+    // Keeps batches in order on disk.
+    std::mutex writeMutex;
+    std::thread flusher;
+
+    void flushLoop();
+    void close();
+};
+
+}
@@ -0,0 +1,228 @@
+#include "build_manifest.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace OreoBuild {
+
+BuildManifest::BuildManifest(const std::string& path) : path(path) {}
+
+void BuildManifest::load() {
+    clear();
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return;
+    }
+
+    std::string line;
+    if (!std::getline(file, line) || line != "oreobuild-manifest " + std::to_string(formatVersion)) {
+        // Unknown or older format: behave as if there was no previous build.
+        return;
+    }
+
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string kind;
+        iss >> kind;
+        if (kind == "root") {
+            iss >> rootFingerprint;
+        } else if (kind == "file") {
+            FileState state;
+            int exists = 0;
+            iss >> exists >> state.mtimeNs >> state.size;
+            state.exists = exists != 0;
+            std::string filePath;
+            iss.get();
+            std::getline(iss, filePath);
+            if (!filePath.empty()) {
+                fileStates.emplace_back(filePath, state);
+            }
+        } else if (kind == "deps") {
+            // "deps <from> <to>..." with indices into the file list.
+            const char* cursor = line.c_str() + 4;
+            char* end = nullptr;
+            unsigned long from = std::strtoul(cursor, &end, 10);
+            for (cursor = end;; cursor = end) {
+                unsigned long to = std::strtoul(cursor, &end, 10);
+                if (end == cursor) {
+                    break;
+                }
+                dependencyEdges.emplace_back(static_cast<uint32_t>(from), static_cast<uint32_t>(to));
+            }
+        } else if (kind == "cost") {
+            uint64_t micros = 0;
+            std::string objectPath;
+            iss >> micros;
+            iss.get();
+            std::getline(iss, objectPath);
+            if (!objectPath.empty()) {
+                compileCosts.set(objectPath, micros);
+            }
+        } else if (kind == "usage") {
+            ProcessUsage usage;
+            std::string outputPath;
+            iss >> usage.jobs >> usage.peakRssKb >> usage.userMicros >> usage.systemMicros >> usage.majorFaults;
+            iss.get();
+            std::getline(iss, outputPath);
+            if (iss && !outputPath.empty()) {
+                stepUsages.set(outputPath, usage);
+            }
+        } else if (kind == "changes") {
+            uint32_t count = 0;
+            std::string filePath;
+            iss >> count;
+            iss.get();
+            std::getline(iss, filePath);
+            if (!filePath.empty()) {
+                changeCounts[filePath] = count;
+            }
+        } else if (kind == "builds") {
+            iss >> recordedBuilds;
+        } else if (kind == "command") {
+            std::string signature, outputPath;
+            iss >> signature;
+            iss.get();
+            std::getline(iss, outputPath);
+            if (!outputPath.empty()) {
+                commandSignatures.set(outputPath, signature);
+            }
+        }
+    }
+}
+
+bool BuildManifest::save() const {
+    std::ostringstream file;
+    file << "oreobuild-manifest " << formatVersion << '\n';
+    file << "root " << rootFingerprint << '\n';
+    for (const auto& [filePath, state] : fileStates) {
+        file << "file " << (state.exists ? 1 : 0) << ' ' << state.mtimeNs << ' ' << state.size << ' ' << filePath << '\n';
+    }
+    commandSignatures.forEach([&](const std::string& outputPath, const std::string& signature) {
+        file << "command " << signature << ' ' << outputPath << '\n';
+    });
+    file << "builds " << recordedBuilds << '\n';
+    compileCosts.forEach([&](const std::string& objectPath, uint64_t micros) {
+        file << "cost " << micros << ' ' << objectPath << '\n';
+    });
+    stepUsages.forEach([&](const std::string& outputPath, const ProcessUsage& usage) {
+        file << "usage " << usage.jobs << ' ' << usage.peakRssKb << ' ' << usage.userMicros << ' '
+             << usage.systemMicros << ' ' << usage.majorFaults << ' ' << outputPath << '\n';
+    });
+    for (const auto& [filePath, count] : changeCounts) {
+        file << "changes " << count << ' ' << filePath << '\n';
+    }
+    // Edges are sorted by source, so each file's includes go on one line.
+    for (size_t i = 0; i < dependencyEdges.size();) {
+        uint32_t from = dependencyEdges[i].first;
+        file << "deps " << from;
+        for (; i < dependencyEdges.size() && dependencyEdges[i].first == from; ++i) {
+            file << ' ' << dependencyEdges[i].second;
+        }
+        file << '\n';
+    }
+
+    if (!FileUtils::writeFileAtomically(path, file.str())) {
+        OREO_WARN(LogCategory::General, "Warning: Unable to write build manifest: " << path);
+        return false;
+    }
+    return true;
+}
+
+void BuildManifest::clear() {
+    rootFingerprint.clear();
+    fileStates.clear();
+    commandSignatures.clear();
+    dependencyEdges.clear();
+    compileCosts.clear();
+    stepUsages.clear();
+    changeCounts.clear();
+    recordedBuilds = 0;
+}
+
+std::string BuildManifest::getCommandSignature(const std::string& outputPath) const {
+    std::string signature;
+    commandSignatures.find(outputPath, signature);
+    return signature;
+}
+
+void BuildManifest::setCommandSignature(const std::string& outputPath, const std::string& signature) {
+    commandSignatures.set(outputPath, signature);
+}
+
+void BuildManifest::setDependencies(const std::unordered_map<std::string, std::set<std::string>>& dependencies) {
+    std::unordered_map<std::string, uint32_t> indices;
+    indices.reserve(fileStates.size());
+    for (uint32_t i = 0; i < fileStates.size(); ++i) {
+        indices.emplace(fileStates[i].first, i);
+    }
+
+    dependencyEdges.clear();
+    for (const auto& [from, targets] : dependencies) {
+        auto fromIt = indices.find(from);
+        if (fromIt == indices.end()) {
+            continue;
+        }
+        for (const auto& to : targets) {
+            auto toIt = indices.find(to);
+            if (toIt != indices.end()) {
+                dependencyEdges.emplace_back(fromIt->second, toIt->second);
+            }
+        }
+    }
+    std::sort(dependencyEdges.begin(), dependencyEdges.end());
+}
+
+uint64_t BuildManifest::getCompileCost(const std::string& objectPath) const {
+    uint64_t cost = 0;
+    compileCosts.find(objectPath, cost);
+    return cost;
+}
+
+void BuildManifest::recordCompileCost(const std::string& objectPath, uint64_t micros) {
+    // Smooth out one-off slow or cached compiles.
+    compileCosts.update(objectPath, [micros](uint64_t& cost) {
+        cost = cost == 0 ? micros : (cost * 3 + micros) / 4;
+    });
+}
+
+ProcessUsage BuildManifest::getStepUsage(const std::string& outputPath) const {
+    ProcessUsage usage;
+    stepUsages.find(outputPath, usage);
+    return usage;
+}
+
+void BuildManifest::recordStepUsage(const std::string& outputPath, const ProcessUsage& usage) {
+    stepUsages.set(outputPath, usage);
+}
+
+std::vector<std::pair<std::string, ProcessUsage>> BuildManifest::getStepUsages() const {
+    std::vector<std::pair<std::string, ProcessUsage>> usages;
+    stepUsages.forEach([&](const std::string& outputPath, const ProcessUsage& usage) {
+        usages.emplace_back(outputPath, usage);
+    });
+    return usages;
+}
+
+uint32_t BuildManifest::getChangeCount(const std::string& filePath) const {
+    auto it = changeCounts.find(filePath);
+    return it == changeCounts.end() ? 0 : it->second;
+}
+
+void BuildManifest::updateFileStates(std::vector<std::pair<std::string, FileState>> states,
+                                     const std::set<std::string>& generated) {
+    if (!fileStates.empty()) {
+        std::unordered_map<std::string, FileState> previous(fileStates.begin(), fileStates.end());
+        for (const auto& [filePath, state] : states) {
+            auto it = previous.find(filePath);
+            if (it != previous.end() && it->second != state && generated.count(filePath) == 0) {
+                changeCounts[filePath]++;
+            }
+        }
+    }
+    recordedBuilds++;
+    fileStates = std::move(states);
+}
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "file_utils.hpp"
+#include "process.hpp"
+#include "sharded_map.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+
+namespace OreoBuild {
+
+// Persisted record of the last successful build: a root fingerprint over
+// config, toolchain and every file the build touched, plus the file-state
+// snapshot it was computed from. Also keeps the hash of the exact command
+// that produced each object and output, which survives failed builds.
+// For impact analysis it also records the dependency edges between the
+// recorded files, a smoothed compile time per object, and how often each
+// file has changed between successful builds. What the last run of each
+// compile and link used (peak memory, CPU time, major faults) feeds the
+// scheduler's memory admission and the --top-rss report.
+//
+// Command signatures, step times and usage are written by worker threads as
+// steps finish and may be updated concurrently; everything else is read and
+// written by the thread driving the build.
+class BuildManifest {
+public:
+    explicit BuildManifest(const std::string& path);
+
+    void load();
+    // Replaces the file atomically; false when it could not be written.
+    bool save() const;
+    void clear();
+
+    const std::string& getPath() const { return path; }
+    void setPath(const std::string& newPath) { path = newPath; }
+    const std::string& getRootFingerprint() const { return rootFingerprint; }
+    void setRootFingerprint(const std::string& fingerprint) { rootFingerprint = fingerprint; }
+
+    const std::vector<std::pair<std::string, FileState>>& getFileStates() const { return fileStates; }
+
+    // Empty string when no command has been recorded for the path.
+    std::string getCommandSignature(const std::string& outputPath) const;
+    void setCommandSignature(const std::string& outputPath, const std::string& signature);
+
+    // Edges are (from, to) indices into getFileStates(): from includes to.
+    const std::vector<std::pair<uint32_t, uint32_t>>& getDependencyEdges() const { return dependencyEdges; }
+    // Replaces the edges; paths missing from the file states are dropped.
+    void setDependencies(const std::unordered_map<std::string, std::set<std::string>>& dependencies);
+
+    // Time in microseconds of the step that produces the path (a compile,
+    // the link or a plugin step), or of the last passing run of a test
+    // under "test:<name>"; 0 when never measured.
+    uint64_t getCompileCost(const std::string& objectPath) const;
+    void recordCompileCost(const std::string& objectPath, uint64_t micros);
+
+    // Usage of the last measured run of the step producing the path; jobs
+    // is 0 when none was measured.
+    ProcessUsage getStepUsage(const std::string& outputPath) const;
+    void recordStepUsage(const std::string& outputPath, const ProcessUsage& usage);
+    std::vector<std::pair<std::string, ProcessUsage>> getStepUsages() const;
+
+    uint32_t getChangeCount(const std::string& filePath) const;
+    uint32_t getRecordedBuilds() const { return recordedBuilds; }
+    // Counts every input whose state differs from the previous snapshot as
+    // changed, then stores the new snapshot. Generated files are not counted.
+    void updateFileStates(std::vector<std::pair<std::string, FileState>> states,
+                          const std::set<std::string>& generated);
+
+private:
+    std::string path;
+    std::string rootFingerprint;
+    std::vector<std::pair<std::string, FileState>> fileStates;
+    ShardedMap<std::string> commandSignatures;
+    std::vector<std::pair<uint32_t, uint32_t>> dependencyEdges;
+    ShardedMap<uint64_t> compileCosts;
+    ShardedMap<ProcessUsage> stepUsages;
+    std::unordered_map<std::string, uint32_t> changeCounts;
+    uint32_t recordedBuilds = 0;
+
+    static const int formatVersion = 2;
+};
+
+}
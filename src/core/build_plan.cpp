@@ -0,0 +1,81 @@
+#include "build_plan.hpp"
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <queue>
+#include <utility>
+
+namespace OreoBuild {
+
+uint64_t BuildPlan::simulate(const std::vector<PlanTask>& tasks, size_t jobs, const std::map<std::string, int>& pools) {
+    std::vector<size_t> waitingOn(tasks.size(), 0);
+    std::vector<std::vector<size_t>> dependents(tasks.size());
+    std::list<size_t> ready;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        waitingOn[i] = tasks[i].after.size();
+        for (size_t before : tasks[i].after) {
+            dependents[before].push_back(i);
+        }
+        if (waitingOn[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+
+    using Running = std::pair<uint64_t, size_t>;  // (finish time, task)
+    std::priority_queue<Running, std::vector<Running>, std::greater<Running>> running;
+    std::map<std::string, int> poolActive;
+    size_t freeWorkers = std::max<size_t>(jobs, 1);
+    uint64_t now = 0;
+    while (true) {
+        // Like ResourcePools, a task waiting for its pool does not hold a
+        // worker, so later tasks may overtake it.
+        for (auto it = ready.begin(); it != ready.end() && freeWorkers > 0;) {
+            const PlanTask& task = tasks[*it];
+            auto pool = pools.find(task.pool);
+            if (pool != pools.end() && poolActive[task.pool] >= pool->second) {
+                ++it;
+                continue;
+            }
+            poolActive[task.pool]++;
+            freeWorkers--;
+            running.emplace(now + task.durationUs, *it);
+            it = ready.erase(it);
+        }
+        if (running.empty()) {
+            return now;
+        }
+        auto [finish, index] = running.top();
+        running.pop();
+        now = finish;
+        poolActive[tasks[index].pool]--;
+        freeWorkers++;
+        for (size_t dependent : dependents[index]) {
+            if (--waitingOn[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+}
+
+size_t BuildPlan::suggestJobs(const std::vector<PlanTask>& tasks, const std::map<std::string, int>& pools) {
+    if (tasks.empty()) {
+        return 1;
+    }
+    uint64_t unlimited = simulate(tasks, tasks.size(), pools);
+    uint64_t goal = unlimited + unlimited / 20;
+    // Wall time only falls as workers are added (barring rare scheduling
+    // anomalies), so bisect for the first count that meets the goal.
+    size_t low = 1;
+    size_t high = tasks.size();
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (simulate(tasks, middle, pools) <= goal) {
+            high = middle;
+        } else {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace OreoBuild {
+
+// One out-of-date step of a planned build.
+struct PlanTask {
+    std::string name;
+    uint64_t durationUs = 0;
+    // Resource pool the step runs in, empty for none.
+    std::string pool;
+    // Indices of the tasks that have to finish first.
+    std::vector<size_t> after;
+};
+
+// Predicts the wall time of a build by replaying its schedule: tasks start
+// in order as soon as their predecessors are done, a worker is free and
+// their pool has room, the way BuildSystem dispatches them.
+class BuildPlan {
+public:
+    // Wall time in microseconds on jobs workers.
+    static uint64_t simulate(const std::vector<PlanTask>& tasks, size_t jobs, const std::map<std::string, int>& pools);
+    // Smallest job count whose wall time is within 5% of what unlimited
+    // workers would achieve; more jobs than that stop paying off.
+    static size_t suggestJobs(const std::vector<PlanTask>& tasks, const std::map<std::string, int>& pools);
+};
+
+}
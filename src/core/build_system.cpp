@@ -1,299 +1,2215 @@
 #include "build_system.hpp"
 #include "file_utils.hpp"
+#include "hash.hpp"
+#include "remote_cache.hpp"
+#include "time_trace_report.hpp"
+#include "impact_analysis.hpp"
+#include "build_plan.hpp"
+#include "logger.hpp"
+#include "json.hpp"
+#include "metrics.hpp"
+#include "process.hpp"
 #include "color.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 #include <filesystem>
 #include <algorithm>
 #include <future>
 #include <chrono>
 #include <thread>
+#include <atomic>
+#include <limits>
+#include <deque>
+#include <sys/wait.h>
 
 namespace OreoBuild {
 
 BuildSystem::BuildSystem() 
     : compiler(createCompiler("gcc")),
-      threadPool(std::make_unique<ThreadPool>(std::thread::hardware_concurrency())),
-      cacheFilePath("build_cache.txt"),
+      threadPool(std::make_shared<ThreadPool>(std::thread::hardware_concurrency())),
+      manifest(""),
       verbosityLevel(VerbosityLevel::Normal),
       filesCompiled(0) {
-    loadCache();
+    resourcePools = std::make_shared<ResourcePools>(*threadPool);
+}
+
+BuildSystem::BuildSystem(const BuildSystem& parent, const std::string& variant)
+    : config(parent.config),
+      resourcePools(parent.resourcePools),
+      threadPool(parent.threadPool),
+      manifest(""),
+      remoteCache(parent.remoteCache),
+      pluginManager(parent.pluginManager),
+      variantOfParent(true),
+      explain(parent.explain),
+      keepGoing(parent.keepGoing),
+      topRss(parent.topRss),
+      verbosityLevel(parent.verbosityLevel),
+      filesCompiled(0) {
+    config.selectVariant(variant);
+    // Each variant hands its own module map to its compiler.
+    compiler = createConfiguredCompiler();
 }
 
 BuildSystem::~BuildSystem() {
-    saveCache();
+    if (!selectedVariantDir.empty()) {
+        saveState();
+    }
 }
 
 void BuildSystem::loadConfig(const std::string& configFile) {
     config.loadFromFile(configFile);
+    config.getLtoMode();  // rejects an invalid lto setting before any work starts
+    if (!config.getRemoteCacheUrl().empty()) {
+        remoteCache = std::make_shared<RemoteCache>(config.getRemoteCacheUrl(), config.isRemoteCacheReadOnly(),
+                                                    config.getRemoteCacheTimeoutMs());
+    }
+    compiler = createConfiguredCompiler();
+    if (config.isTimeTraceEnabled() && compiler->getName() != "Clang") {
+        OREO_WARN(LogCategory::Config, "Warning: time_trace needs a Clang compiler; no compile time report will be produced.");
+    }
+
+    auto workers = config.getDistributedWorkers();
+    size_t jobs = config.getJobs();
+    if (!workers.empty() && jobs == 0) {
+        // Leave room for remote slots on top of the local cores.
+        jobs = std::thread::hardware_concurrency() * (workers.size() + 1);
+    }
+    if (jobs > 0 && jobs != threadPool->getThreadCount()) {
+        threadPool = std::make_shared<ThreadPool>(jobs);
+        resourcePools->setThreadPool(*threadPool);
+    }
+    configurePools();
+    pluginManager = std::make_shared<PluginManager>();
+    pluginManager->load(config.getPlugins());
+
+    // After loading, print out the contents
+    OREO_VERBOSE(LogCategory::Config, "Loaded configuration:\n"
+                 << "Compiler: " << config.getCompiler() << "\n"
+                 << "Sources: " << joinString(config.getSourceFiles(), ", ") << "\n"
+                 << "Output: " << config.getOutputFile() << "\n"
+                 << "Include paths: " << joinString(config.getIncludePaths(), ", ") << "\n"
+                 << "System Include paths: " << joinString(config.getSystemIncludePaths(), ", ") << "\n"
+                 << "Libraries: " << joinString(config.getLibraries(), ", ") << "\n"
+                 << "Distributed workers: " << joinString(workers, ", ") << "\n"
+                 << "Plugins: " << joinString(config.getPlugins(), ", ") << "\n"
+                 << "Remote cache: " << config.getRemoteCacheUrl()
+                 << (config.isRemoteCacheReadOnly() ? " (read-only)" : "") << "\n"
+                 << "Build Type: " << (config.isDebug() ? "Debug" : "Release") << "\n"
+                 << "Compiler Flags: " << joinString(config.getCompilerFlags(), " ") << "\n"
+                 << "Debug Flags: " << config.getDebugFlags() << "\n"
+                 << "Release Flags: " << config.getReleaseFlags());
+}
+
+std::unique_ptr<Compiler> BuildSystem::createConfiguredCompiler() const {
+    std::unique_ptr<Compiler> configured = createCompiler(config.getCompiler());
+    auto workers = config.getDistributedWorkers();
+    if (!workers.empty()) {
+        configured = createDistributedCompiler(std::move(configured), workers, config.getDistributedTimeoutMs());
+    }
+    if (remoteCache) {
+        configured = createCachingCompiler(std::move(configured), remoteCache);
+    }
+    return configured;
+}
+
+std::string OreoBuild::BuildSystem::joinString(const std::vector<std::string>& v, const std::string& delimiter) {
+    std::string result;
+    for (size_t i = 0; i < v.size(); ++i) {
+        if (i > 0) {
+            result += delimiter;
+        }
+        result += v[i];
+    }
+    return result;
+}
+
+
+std::string BuildSystem::getVariantDir() const {
+    return (std::filesystem::path(config.getBuildDir()) / config.getVariantName()).string();
+}
+
+std::string BuildSystem::getObjectPath(const std::string& source) const {
+    // Mirror the source tree below the variant directory so that a/util.cpp and
+    // b/util.cpp map to distinct objects. Parent references are renamed so that
+    // sources outside the project still land inside the variant directory.
+    std::filesystem::path mirrored;
+    for (const auto& part : std::filesystem::path(source).relative_path().lexically_normal()) {
+        mirrored /= (part == ".." ? std::filesystem::path("__") : part);
+    }
+    return (std::filesystem::path(getVariantDir()) / "obj" / mirrored).string() + ".o";
+}
+
+std::string BuildSystem::getOutputPath() const {
+    std::filesystem::path output(config.getOutputFile());
+    if (output.is_absolute()) {
+        return output.string();
+    }
+    return (std::filesystem::path(getVariantDir()) / output).string();
+}
+
+void BuildSystem::selectVariant() {
+    std::string variantDir = getVariantDir();
+    if (variantDir == selectedVariantDir) {
+        return;
+    }
+    if (!selectedVariantDir.empty()) {
+        saveState();
+    }
+
+    selectedVariantDir = variantDir;
+    cacheFilePath = (std::filesystem::path(variantDir) / "build_cache.txt").string();
+    manifest.setPath((std::filesystem::path(variantDir) / "build_manifest.txt").string());
+    cacheMap.clear();
+    loadCache();
+    manifest.load();
+    recoverJournal();
+}
+
+void BuildSystem::loadCache() {
+    std::ifstream cacheFile(cacheFilePath);
+    if (cacheFile.is_open()) {
+        std::string filePath;
+        std::time_t timestamp;
+        while (cacheFile >> filePath >> timestamp) {
+            cacheMap.set(filePath, timestamp);
+        }
+    }
+}
+
+bool BuildSystem::saveCache() {
+    std::ostringstream content;
+    cacheMap.forEach([&](const std::string& filePath, std::time_t timestamp) {
+        content << filePath << " " << timestamp << "\n";
+    });
+    std::filesystem::create_directories(selectedVariantDir);
+    if (!FileUtils::writeFileAtomically(cacheFilePath, content.str())) {
+        OREO_WARN(LogCategory::General, "Warning: Unable to write build cache: " << cacheFilePath);
+        return false;
+    }
+    return true;
+}
+
+void BuildSystem::saveState() {
+    // The journal has to outlive both files: if either save fails, the next
+    // run still replays it on top of what was saved before.
+    bool cacheSaved = saveCache();
+    if (manifest.save() && cacheSaved) {
+        journal.reset();
+    }
+}
+
+void BuildSystem::recordStep(const std::string& output, const std::string& signature, uint64_t micros,
+                             const ProcessUsage& usage) {
+    manifest.setCommandSignature(output, signature);
+    journal.append("command", signature, output);
+    if (micros > 0) {
+        manifest.recordCompileCost(output, micros);
+        journal.append("cost", std::to_string(micros), output);
+    }
+    if (usage.jobs > 0) {
+        manifest.recordStepUsage(output, usage);
+        journal.append("usage", std::to_string(usage.jobs) + "," + std::to_string(usage.peakRssKb) + "," +
+                                    std::to_string(usage.userMicros) + "," + std::to_string(usage.systemMicros) +
+                                    "," + std::to_string(usage.majorFaults),
+                       output);
+        std::lock_guard<std::mutex> lock(usageMutex);
+        if (usage.peakRssKb > buildUsage.peakRssKb) {
+            heaviestStep = output;
+        }
+        buildUsage.add(usage);
+        buildJobMicros += micros;
+    }
+}
+
+void BuildSystem::recordSourceStamp(const std::string& source, std::time_t lastModified) {
+    cacheMap.set(source, lastModified);
+    journal.append("stamp", std::to_string(lastModified), source);
+}
+
+void BuildSystem::recoverJournal() {
+    std::filesystem::create_directories(selectedVariantDir);
+    journal.open((std::filesystem::path(selectedVariantDir) / "build_journal.log").string());
+    // Records are applied the way they were first recorded, so replaying the
+    // journal once more after a failed save does no harm.
+    size_t recovered = journal.replay([this](const std::string& kind, const std::string& value, const std::string& key) {
+        if (kind == "stamp") {
+            cacheMap.set(key, static_cast<std::time_t>(std::strtoll(value.c_str(), nullptr, 10)));
+        } else if (kind == "command") {
+            manifest.setCommandSignature(key, value);
+        } else if (kind == "cost") {
+            manifest.recordCompileCost(key, std::strtoull(value.c_str(), nullptr, 10));
+        } else if (kind == "usage") {
+            // jobs,peakRssKb,userMicros,systemMicros,majorFaults
+            ProcessUsage usage;
+            const char* field = value.c_str();
+            for (uint64_t* target : {&usage.jobs, &usage.peakRssKb, &usage.userMicros, &usage.systemMicros,
+                                     &usage.majorFaults}) {
+                char* end = nullptr;
+                *target = std::strtoull(field, &end, 10);
+                field = *end == ',' ? end + 1 : end;
+            }
+            manifest.recordStepUsage(key, usage);
+        }
+    });
+    if (recovered > 0) {
+        OREO_INFO(LogCategory::General, "Resuming an interrupted build (" << recovered << " journal record(s) recovered).");
+    }
+}
+
+bool BuildSystem::isNoOpBuild() {
+    const auto& recorded = manifest.getFileStates();
+    if (manifest.getRootFingerprint().empty() || recorded.empty()) {
+        return false;
+    }
+
+    // One stat per recorded file, bailing out on the first difference.
+    for (const auto& [path, state] : recorded) {
+        if (FileUtils::getFileState(path) != state) {
+            OREO_VERBOSE(LogCategory::Deps, "Changed since last build: " << path);
+            return false;
+        }
+    }
+
+    return computeRootFingerprint(recorded) == manifest.getRootFingerprint();
+}
+
+std::string BuildSystem::computeRootFingerprint(const std::vector<std::pair<std::string, FileState>>& fileStates) const {
+    Hasher hasher;
+    hasher.update(config.getFingerprint());
+
+    std::string toolchain = FileUtils::findExecutable(config.getCompiler());
+    FileState toolchainState = FileUtils::getFileState(toolchain);
+    hasher.update(compiler->getName()).update(toolchain);
+    hasher.update(static_cast<uint64_t>(toolchainState.mtimeNs)).update(toolchainState.size);
+
+    for (const auto& [path, state] : fileStates) {
+        hasher.update(path);
+        hasher.update(static_cast<uint64_t>(state.exists));
+        hasher.update(static_cast<uint64_t>(state.mtimeNs)).update(state.size);
+    }
+    return hasher.hexDigest();
+}
+
+std::string BuildSystem::commandSignature(const std::string& command) {
+    // Normalize whitespace so cosmetic differences in command assembly do not
+    // count as a flag change.
+    std::istringstream iss(command);
+    std::string token;
+    Hasher hasher;
+    while (iss >> token) {
+        hasher.update(token);
+    }
+    return hasher.hexDigest();
+}
+
+std::string BuildSystem::compileSignature(const std::string& source, const std::string& object) const {
+    std::string command = compiler->getCompileCommand(source, object, config);
+    std::string profile = compiler->getProfilePath(object, config);
+    if (!profile.empty()) {
+        // The profile is an input the command line does not show, so a TU is
+        // rebuilt exactly when its own profile changes.
+        std::ifstream file(profile, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        command += " " + Hasher().update(content.str()).hexDigest();
+    }
+    return commandSignature(command);
+}
+
+void BuildSystem::recordManifest(const std::vector<std::string>& objects, const std::string& output) {
+    std::set<std::string> paths;
+    std::vector<std::string> pending;
+    for (const auto& source : config.getSourceFiles()) {
+        resolveDependencies(source, getObjectPath(source));
+        pending.push_back(source);
+    }
+    while (!pending.empty()) {
+        std::string path = std::move(pending.back());
+        pending.pop_back();
+        if (!paths.insert(path).second) {
+            continue;
+        }
+        auto it = dependencies.find(path);
+        if (it != dependencies.end()) {
+            pending.insert(pending.end(), it->second.begin(), it->second.end());
+        }
+    }
+    std::set<std::string> generated(objects.begin(), objects.end());
+    generated.insert(output);
+    if (config.isSplitDwarfEnabled()) {
+        for (const auto& object : objects) {
+            generated.insert(Compiler::getSplitDwarfPath(object));
+        }
+    }
+    if (moduleMap) {
+        for (const auto& entry : moduleMap->bmiPaths) {
+            generated.insert(entry.second);
+        }
+    }
+    for (const auto& loaded : pluginNodes) {
+        paths.insert(loaded.node.inputs.begin(), loaded.node.inputs.end());
+        generated.insert(loaded.node.outputs.begin(), loaded.node.outputs.end());
+    }
+    if (pluginManager) {
+        for (const auto& library : pluginManager->getLibraryPaths()) {
+            paths.insert(library);
+        }
+    }
+    paths.insert(generated.begin(), generated.end());
+    for (const auto& object : objects) {
+        std::string profile = compiler->getProfilePath(object, config);
+        if (!profile.empty()) {
+            paths.insert(profile);
+        }
+    }
+
+    std::vector<std::pair<std::string, FileState>> fileStates;
+    fileStates.reserve(paths.size());
+    for (const auto& path : paths) {
+        fileStates.emplace_back(path, FileUtils::getFileState(path));
+    }
+
+    manifest.setRootFingerprint(computeRootFingerprint(fileStates));
+    manifest.updateFileStates(std::move(fileStates), generated);
+    manifest.setDependencies(dependencies);
+    saveState();
+}
+
+bool BuildSystem::build(const std::string& target, std::function<void(const std::string&)> progressCallback) {
+    buildStartTime = std::chrono::high_resolution_clock::now();
+    filesCompiled = 0;
+    buildUsage = ProcessUsage();
+    buildJobMicros = 0;
+    heaviestStep.clear();
+    selectVariant();
+    if (!variantOfParent) {
+        includeScanner.reset();
+        Process::installInterruptHandler();
+        Process::resetCancellation();
+    }
+
+    OREO_VERBOSE(LogCategory::General, "Building target: " << target << "\n"
+                 << "Build type: " << (config.getBuildType() == BuildType::Debug ? "Debug" : "Release") << "\n"
+                 << "Variant directory: " << selectedVariantDir << "\n"
+                 << "Using " << threadPool->getThreadCount() << " threads for compilation");
+
+    auto noOpCheckStart = std::chrono::high_resolution_clock::now();
+    bool noOp = isNoOpBuild();
+    auto noOpCheckDuration = std::chrono::high_resolution_clock::now() - noOpCheckStart;
+    OREO_DEBUG(LogCategory::Deps, "Time spent on no-op check: "
+               << std::chrono::duration_cast<std::chrono::microseconds>(noOpCheckDuration).count() << " us");
+    Metrics::add(Counter::Builds);
+    Metrics::observe(Histogram::NoOpCheckSeconds, std::chrono::duration<double>(noOpCheckDuration).count());
+    Metrics::set(Gauge::Workers, threadPool->getThreadCount());
+    if (noOp) {
+        Metrics::add(Counter::NoOpBuilds);
+        Metrics::add(Counter::UnitsUpToDate, config.getSourceFiles().size());
+        OREO_INFO(LogCategory::General, Color::Yellow << "Everything is up to date. Nothing to do." << Color::Reset);
+        reportTopRss();
+        Logger::flush();
+        return true;
+    }
+
+    std::vector<std::string> objects;
+    std::vector<std::string> objectsToCompile;
+
+    auto checkDependenciesStart = std::chrono::high_resolution_clock::now();
+
+    // Plugin steps may generate sources and headers, so they come first.
+    if (!runPluginNodes()) {
+        OREO_ERROR(LogCategory::General, Color::Red << "Build failed: a plugin step failed." << Color::Reset);
+        manifest.setRootFingerprint("");
+        saveState();
+        Logger::flush();
+        return false;
+    }
+
+    std::vector<std::string> sources = config.getSourceFiles();
+    for (const auto& source : sources) {
+        if (!std::filesystem::exists(source)) {
+            OREO_ERROR(LogCategory::General, Color::Red << "Error: Source file not found: " << source << Color::Reset);
+            Logger::flush();
+            return false;
+        }
+    }
+
+    prescanIncludes(sources);
+
+    // Module flags are part of the compile command, so the scan has to run
+    // before any command signature is compared.
+    if (config.areModulesEnabled() && !scanModules(sources)) {
+        OREO_ERROR(LogCategory::Deps, Color::Red << "Build failed: module dependencies could not be resolved." << Color::Reset);
+        Logger::flush();
+        return false;
+    }
+
+    std::unordered_map<std::string, std::string> reasons;
+    for (const auto& source : sources) {
+        std::string obj = getObjectPath(source);
+        std::string reason = rebuildReason(source, obj);
+        if (!reason.empty()) {
+            objectsToCompile.push_back(source);
+            reasons[source] = reason;
+        }
+        objects.push_back(obj);
+    }
+    if (moduleMap) {
+        addModuleImporters(objectsToCompile, reasons);
+    }
+    Metrics::add(Counter::UnitsUpToDate, sources.size() - objectsToCompile.size());
+    for (const auto& source : objectsToCompile) {
+        if (explain) {
+            OREO_INFO(LogCategory::Deps, "Rebuilding " << source << ": " << reasons[source]);
+        } else {
+            OREO_VERBOSE(LogCategory::Deps, "Rebuilding " << source << ": " << reasons[source]);
+        }
+    }
+
+    auto checkDependenciesEnd = std::chrono::high_resolution_clock::now();
+    auto checkDependenciesDuration = std::chrono::duration_cast<std::chrono::milliseconds>(checkDependenciesEnd - checkDependenciesStart);
+
+    OREO_DEBUG(LogCategory::Deps, "Time spent checking dependencies: " << checkDependenciesDuration.count() << " ms");
+
+    // Module interface units have to be compiled before their importers;
+    // everything else is ready straight away.
+    std::unordered_map<std::string, size_t> waitingOn;
+    std::unordered_map<std::string, std::vector<std::string>> dependents;
+    if (moduleMap && !orderModuleUnits(objectsToCompile, waitingOn, dependents)) {
+        OREO_ERROR(LogCategory::Deps, Color::Red << "Build failed: module dependencies could not be resolved." << Color::Reset);
+        manifest.setRootFingerprint("");
+        saveState();
+        Logger::flush();
+        return false;
+    }
+
+    auto compilationStart = std::chrono::high_resolution_clock::now();
+    bool compiled = compileUnits(objectsToCompile, waitingOn, dependents, progressCallback);
+    auto compilationEnd = std::chrono::high_resolution_clock::now();
+    auto compilationDuration = std::chrono::duration_cast<std::chrono::milliseconds>(compilationEnd - compilationStart);
+
+    if (!compiled) {
+        manifest.setRootFingerprint("");
+        saveState();
+        Logger::flush();
+        return false;
+    }
+
+    OREO_DEBUG(LogCategory::Compile, "Time spent on compilation: " << compilationDuration.count() << " ms");
+
+    auto linkingStart = std::chrono::high_resolution_clock::now();
+
+    std::string output = getOutputPath();
+    std::filesystem::path outputDir = std::filesystem::path(output).parent_path();
+    if (!outputDir.empty()) {
+        std::filesystem::create_directories(outputDir);
+    }
+    bool linkSucceeded = true;
+    std::string linkReason = getLinkReason(objects, output, 0);
+    if (!linkReason.empty()) {
+        if (explain) {
+            OREO_INFO(LogCategory::Link, "Linking " << output << ": " << linkReason);
+        } else {
+            OREO_VERBOSE(LogCategory::Link, "Linking " << output << ": " << linkReason);
+        }
+        // The link runs on the thread pool only so that link_pool can bound
+        // it; this thread just waits for the result.
+        std::promise<bool> linked;
+        auto linkStart = std::chrono::steady_clock::now();
+        ProcessUsage linkUsage;
+        resourcePools->submit(config.getLinkPool(), [&] {
+            Process::resetThreadUsage();
+            bool succeeded = compiler->link(objects, output, config);
+            linkUsage = Process::getThreadUsage();
+            linked.set_value(succeeded);
+        }, predictedMemory(output));
+        if (linked.get_future().get()) {
+            uint64_t linkMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - linkStart).count();
+            recordStep(output, commandSignature(compiler->getLinkCommand(objects, output, config)), linkMicros,
+                       linkUsage);
+            Metrics::add(Counter::Links);
+            Metrics::observe(Histogram::LinkSeconds, linkMicros / 1e6);
+            OREO_INFO(LogCategory::Link, Color::Green << "Build successful. Output: " << output << Color::Reset);
+            pruneLtoCache();
+        } else {
+            OREO_ERROR(LogCategory::Link, Color::Red << "Linking failed." << Color::Reset);
+            // Same as for objects: never keep a partial output around.
+            std::error_code ec;
+            std::filesystem::remove(output, ec);
+            linkSucceeded = false;
+        }
+    } else {
+        OREO_INFO(LogCategory::Link, Color::Yellow << "Output is up to date. Skipping link step." << Color::Reset);
+    }
+
+    auto linkingEnd = std::chrono::high_resolution_clock::now();
+    auto linkingDuration = std::chrono::duration_cast<std::chrono::milliseconds>(linkingEnd - linkingStart);
+
+    OREO_DEBUG(LogCategory::Link, "Time spent on linking: " << linkingDuration.count() << " ms");
+
+    if (linkSucceeded) {
+        recordManifest(objects, output);
+        if (config.isTimeTraceEnabled() && compiler->getName() == "Clang") {
+            reportTimeTraces(objects);
+        }
+    } else {
+        manifest.setRootFingerprint("");
+        saveState();
+    }
+    reportUsage();
+    reportTopRss();
+    Logger::flush();
+    return linkSucceeded;
+}
+
+bool BuildSystem::buildVariants(const std::vector<std::string>& variants,
+                                std::function<void(const std::string&)> progressCallback) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<BuildSystem>> builds;
+    std::set<std::string> variantDirs;
+    for (const auto& variant : variants) {
+        builds.push_back(std::unique_ptr<BuildSystem>(new BuildSystem(*this, variant)));
+        if (!variantDirs.insert(builds.back()->getVariantDir()).second) {
+            throw std::runtime_error("Variant " + variant + " is listed twice");
+        }
+    }
+    if (builds.empty()) {
+        return build("all", progressCallback);
+    }
+
+    // One scanner serves every variant. It only knows the macros all of them
+    // predefine alike; conditionals on the others keep both branches, so its
+    // prediction still covers each variant.
+    std::unordered_map<std::string, std::string> commonMacros = builds[0]->getPredefinedMacros();
+    for (size_t i = 1; i < builds.size(); ++i) {
+        auto macros = builds[i]->getPredefinedMacros();
+        for (auto it = commonMacros.begin(); it != commonMacros.end();) {
+            auto found = macros.find(it->first);
+            it = found != macros.end() && found->second == it->second ? std::next(it) : commonMacros.erase(it);
+        }
+    }
+    auto scanner = std::make_shared<IncludeScanner>(config.getIncludePaths(), std::move(commonMacros));
+    auto stepMutex = std::make_shared<std::mutex>();
+    for (auto& variantBuild : builds) {
+        variantBuild->includeScanner = scanner;
+        variantBuild->pluginStepMutex = stepMutex;
+    }
+    Process::installInterruptHandler();
+    Process::resetCancellation();
+
+    // Each variant is driven from its own thread; the threads only wait
+    // while the shared pool runs the actual steps.
+    std::mutex progressMutex;
+    std::function<void(const std::string&)> progress;
+    if (progressCallback) {
+        progress = [&](const std::string& file) {
+            std::lock_guard<std::mutex> lock(progressMutex);
+            progressCallback(file);
+        };
+    }
+    std::vector<char> succeeded(builds.size(), 0);
+    std::vector<std::thread> drivers;
+    for (size_t i = 0; i < builds.size(); ++i) {
+        drivers.emplace_back([&, i] {
+            try {
+                succeeded[i] = builds[i]->build("all", progress);
+            } catch (const std::exception& e) {
+                OREO_ERROR(LogCategory::General, Color::Red << "Error building " << variants[i] << ": " << e.what()
+                           << Color::Reset);
+                Process::cancelAll();
+            }
+        });
+    }
+    for (auto& driver : drivers) {
+        driver.join();
+    }
+    for (const auto& variantBuild : builds) {
+        filesCompiled += variantBuild->getFilesCompiled();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::ostringstream report;
+    size_t failed = 0;
+    report << "Variants (" << elapsed.count() << " ms):";
+    for (size_t i = 0; i < builds.size(); ++i) {
+        failed += !succeeded[i];
+        report << "\n  " << std::left << std::setw(16) << variants[i] << std::right
+               << (succeeded[i] ? "succeeded  " : "FAILED     ") << builds[i]->getOutputPath();
+    }
+    if (failed > 0) {
+        OREO_ERROR(LogCategory::General, Color::Red << report.str() << Color::Reset);
+    } else {
+        OREO_INFO(LogCategory::General, Color::Green << report.str() << Color::Reset);
+    }
+    Logger::flush();
+    return failed == 0;
+}
+
+bool BuildSystem::compileUnits(const std::vector<std::string>& sources,
+                               std::unordered_map<std::string, size_t>& waitingOn,
+                               const std::unordered_map<std::string, std::vector<std::string>>& dependents,
+                               const std::function<void(const std::string&)>& progressCallback) {
+    std::mutex outputMutex;
+    std::atomic<bool> compilationFailed(false);
+    std::atomic<size_t> failedCount(0);
+    std::atomic<int> compiledCount(0);
+    std::atomic<int> inFlight(0);
+
+    std::function<void(const std::string&)> enqueueCompile;
+    enqueueCompile = [&](const std::string& source) {
+        inFlight++;
+        resourcePools->submit(config.getSourcePool(source), [this, source, &outputMutex, &compilationFailed, &failedCount, &compiledCount,
+                                                                &inFlight, &progressCallback, &waitingOn, &dependents, &enqueueCompile] {
+            // A cancelled build drops whatever is still queued.
+            if (Process::isCancelled()) {
+                inFlight--;
+                return;
+            }
+            std::string obj = getObjectPath(source);
+            std::filesystem::create_directories(std::filesystem::path(obj).parent_path());
+            std::string signature = compileSignature(source, obj);
+            auto compileStart = std::chrono::steady_clock::now();
+            Process::resetThreadUsage();
+            if (compiler->compile(source, obj, config)) {
+                auto compileMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - compileStart).count();
+                recordStep(obj, signature, compileMicros, Process::getThreadUsage());
+                Metrics::add(Counter::Compiles);
+                Metrics::observe(Histogram::CompileSeconds, compileMicros / 1e6);
+                {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    OREO_INFO(LogCategory::Compile, Color::Green << "Compiled: " << source << " to " << obj << Color::Reset);
+                    filesCompiled++;
+                    compiledCount++;
+                    if (progressCallback) {
+                        progressCallback(source);
+                    }
+                }
+                FileUtils::updateTimestamp(obj);
+
+                recordSourceStamp(source, std::filesystem::last_write_time(source).time_since_epoch().count());
+                std::vector<std::string> ready;
+                {
+                    std::lock_guard<std::mutex> lock(outputMutex);
+                    auto it = dependents.find(source);
+                    if (it != dependents.end()) {
+                        for (const auto& dependent : it->second) {
+                            if (--waitingOn[dependent] == 0) {
+                                ready.push_back(dependent);
+                            }
+                        }
+                    }
+                }
+                for (const auto& next : ready) {
+                    if (!Process::isCancelled()) {
+                        enqueueCompile(next);
+                    }
+                }
+            } else {
+                // A killed or failed compiler may leave a truncated object
+                // that would look up to date next time.
+                std::error_code ec;
+                std::filesystem::remove(obj, ec);
+                std::filesystem::remove(Compiler::getDepfilePath(obj), ec);
+                compilationFailed = true;
+                if (!Process::isCancelled()) {
+                    Metrics::add(Counter::CompileFailures);
+                    OREO_ERROR(LogCategory::Compile, Color::Red << "Failed to compile: " << source << Color::Reset);
+                    if (++failedCount > keepGoing) {
+                        Process::cancelAll();
+                    }
+                }
+            }
+            inFlight--;
+        }, predictedMemory(getObjectPath(source)));
+    };
+    std::vector<std::string> initiallyReady;
+    for (const auto& source : sources) {
+        if (waitingOn.count(source) == 0 || waitingOn[source] == 0) {
+            initiallyReady.push_back(source);
+        }
+    }
+    for (const auto& source : initiallyReady) {
+        enqueueCompile(source);
+    }
+
+    // Jobs still running reference this frame, so wait for them even after
+    // a failure. Every job schedules its dependents before it finishes, so
+    // nothing is left once none is in flight.
+    while (inFlight > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    if (verbosityLevel >= VerbosityLevel::Verbose && !sources.empty()) {
+        Logger::flush();
+        std::cout << std::endl;  // New line after progress bar
+    }
+
+    if (compilationFailed || Process::isCancelled()) {
+        size_t notCompiled = sources.size() - compiledCount - failedCount;
+        if (Process::wasInterrupted()) {
+            OREO_ERROR(LogCategory::Compile, Color::Red << "Build interrupted." << Color::Reset);
+        } else {
+            OREO_ERROR(LogCategory::Compile, Color::Red << "Build failed due to compilation errors ("
+                       << failedCount << " failed" << (notCompiled > 0 ? ", " + std::to_string(notCompiled) + " not compiled" : "")
+                       << ")." << Color::Reset);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool BuildSystem::scanModules(const std::vector<std::string>& sources) {
+    std::filesystem::path variantDir(getVariantDir());
+    std::filesystem::create_directories(variantDir / "bmi");
+    if (!moduleScanner) {
+        moduleScanner = std::make_unique<ModuleScanner>((variantDir / "module_scan.txt").string());
+        moduleScanner->load();
+    }
+
+    auto map = std::make_shared<ModuleMap>();
+    map->bmiDir = (variantDir / "bmi").string();
+    map->mapperPath = (variantDir / "module.map").string();
+
+    // A unit's declarations can only change when it or one of its includes
+    // does, so those file states (plus the config) key the scan cache.
+    std::string configFingerprint = config.getFingerprint();
+    std::vector<std::string> keys;
+    for (const auto& source : sources) {
+        resolveDependencies(source, getObjectPath(source));
+        Hasher hasher;
+        hasher.update(configFingerprint).update(source);
+        FileState state = FileUtils::getFileState(source);
+        hasher.update(static_cast<uint64_t>(state.mtimeNs)).update(state.size);
+        for (const auto& dep : dependencies[source]) {
+            state = FileUtils::getFileState(dep);
+            hasher.update(dep).update(static_cast<uint64_t>(state.mtimeNs)).update(state.size);
+        }
+        keys.push_back(hasher.hexDigest());
+    }
+
+    std::vector<ModuleUnit> units(sources.size());
+    std::atomic<size_t> next{0};
+    std::atomic<bool> scanFailed{false};
+    std::vector<std::future<void>> scanners;
+    size_t scannerCount = std::min<size_t>(sources.size(), threadPool->getThreadCount());
+    for (size_t i = 0; i < scannerCount; ++i) {
+        scanners.push_back(std::async(std::launch::async, [&] {
+            for (size_t index = next++; index < sources.size(); index = next++) {
+                if (!moduleScanner->scan(*compiler, config, sources[index], getObjectPath(sources[index]),
+                                         keys[index], units[index])) {
+                    scanFailed = true;
+                }
+            }
+        }));
+    }
+    for (auto& scanner : scanners) {
+        scanner.get();
+    }
+    moduleScanner->save();
+    OREO_VERBOSE(LogCategory::Deps, "Module scan: " << moduleScanner->getScannedCount() << " of "
+                 << sources.size() << " source(s) scanned, the rest cached");
+    if (scanFailed) {
+        return false;
+    }
+
+    std::ostringstream mapper;
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const ModuleUnit& unit = units[i];
+        if (!unit.provides.empty()) {
+            auto inserted = map->providers.emplace(unit.provides, sources[i]);
+            if (!inserted.second) {
+                OREO_ERROR(LogCategory::Deps, "Error: Module '" << unit.provides << "' is provided by both "
+                           << inserted.first->second << " and " << sources[i]);
+                return false;
+            }
+            std::string fileName = unit.provides;
+            std::replace(fileName.begin(), fileName.end(), ':', '-');
+            std::string bmi = (std::filesystem::path(map->bmiDir) / (fileName + compiler->getModuleFileExtension())).string();
+            map->bmiPaths[unit.provides] = bmi;
+            mapper << unit.provides << ' ' << bmi << '\n';
+        }
+        for (const auto& module : unit.imports) {
+            map->importers[module].push_back(sources[i]);
+        }
+        map->units[sources[i]] = unit;
+    }
+
+    // Rewrite the mapper only when it changes; GCC reads it on every compile.
+    std::string mapperText = mapper.str();
+    std::ifstream existing(map->mapperPath);
+    std::ostringstream existingText;
+    existingText << existing.rdbuf();
+    if (existingText.str() != mapperText) {
+        std::ofstream(map->mapperPath, std::ios::trunc) << mapperText;
+    }
+
+    moduleMap = map;
+    compiler->setModuleMap(moduleMap);
+    return true;
+}
+
+void BuildSystem::addModuleImporters(std::vector<std::string>& objectsToCompile,
+                                     std::unordered_map<std::string, std::string>& reasons) const {
+    std::set<std::string> scheduled(objectsToCompile.begin(), objectsToCompile.end());
+    // An interface whose BMI has gone missing must be rebuilt even if its
+    // object is current.
+    for (const auto& [module, provider] : moduleMap->providers) {
+        if (!std::filesystem::exists(moduleMap->getBmiPath(module)) && scheduled.insert(provider).second) {
+            reasons[provider] = "missing output " + moduleMap->getBmiPath(module);
+            objectsToCompile.push_back(provider);
+        }
+    }
+    // A rebuilt interface may change its BMI, so everything importing it,
+    // directly or through another interface, is rebuilt as well.
+    for (size_t i = 0; i < objectsToCompile.size(); ++i) {
+        const ModuleUnit* unit = moduleMap->find(objectsToCompile[i]);
+        if (!unit || unit->provides.empty()) {
+            continue;
+        }
+        auto it = moduleMap->importers.find(unit->provides);
+        if (it == moduleMap->importers.end()) {
+            continue;
+        }
+        for (const auto& importer : it->second) {
+            if (scheduled.insert(importer).second) {
+                reasons[importer] = "imports module " + unit->provides + ", which is rebuilt";
+                objectsToCompile.push_back(importer);
+            }
+        }
+    }
+}
+
+bool BuildSystem::orderModuleUnits(const std::vector<std::string>& objectsToCompile,
+                                   std::unordered_map<std::string, size_t>& waitingOn,
+                                   std::unordered_map<std::string, std::vector<std::string>>& dependents) const {
+    std::set<std::string> scheduled(objectsToCompile.begin(), objectsToCompile.end());
+    for (const auto& source : objectsToCompile) {
+        waitingOn[source] = 0;
+        const ModuleUnit* unit = moduleMap->find(source);
+        if (!unit) {
+            continue;
+        }
+        for (const auto& module : unit->imports) {
+            auto provider = moduleMap->providers.find(module);
+            if (provider == moduleMap->providers.end()) {
+                OREO_ERROR(LogCategory::Deps, "Error: Module '" << module << "' imported by " << source
+                           << " is not provided by any source file.");
+                return false;
+            }
+            if (provider->second != source && scheduled.count(provider->second)) {
+                waitingOn[source]++;
+                dependents[provider->second].push_back(source);
+            }
+        }
+    }
+
+    // Kahn's algorithm: anything left over sits on an import cycle.
+    std::unordered_map<std::string, size_t> remaining = waitingOn;
+    std::vector<std::string> ready;
+    for (const auto& [source, count] : remaining) {
+        if (count == 0) {
+            ready.push_back(source);
+        }
+    }
+    size_t ordered = 0;
+    while (!ready.empty()) {
+        std::string source = ready.back();
+        ready.pop_back();
+        ordered++;
+        auto it = dependents.find(source);
+        if (it != dependents.end()) {
+            for (const auto& dependent : it->second) {
+                if (--remaining[dependent] == 0) {
+                    ready.push_back(dependent);
+                }
+            }
+        }
+    }
+    if (ordered != remaining.size()) {
+        std::string cycle;
+        for (const auto& [source, count] : remaining) {
+            if (count > 0) {
+                cycle += (cycle.empty() ? "" : ", ") + source;
+            }
+        }
+        OREO_ERROR(LogCategory::Deps, "Error: Module import cycle between: " << cycle);
+        return false;
+    }
+    return true;
+}
+
+void BuildSystem::reportTimeTraces(const std::vector<std::string>& objects) {
+    // Traces from earlier builds are kept next to up-to-date objects, so the
+    // report always covers the whole project, not just what was rebuilt.
+    TimeTraceReport report;
+    std::atomic<size_t> next{0};
+    std::vector<std::future<void>> readers;
+    size_t readerCount = std::min<size_t>(objects.size(), std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t i = 0; i < readerCount; ++i) {
+        readers.push_back(std::async(std::launch::async, [&] {
+            for (size_t index = next++; index < objects.size(); index = next++) {
+                std::string tracePath = Compiler::getTimeTracePath(objects[index]);
+                if (std::filesystem::exists(tracePath) && !report.addTrace(tracePath)) {
+                    OREO_WARN(LogCategory::Compile, "Warning: Unable to parse time trace: " << tracePath);
+                }
+            }
+        }));
+    }
+    for (auto& reader : readers) {
+        reader.get();
+    }
+    if (report.getTraceCount() == 0) {
+        return;
+    }
+
+    std::string reportPath = (std::filesystem::path(getVariantDir()) / "time_trace_report.txt").string();
+    std::ofstream file(reportPath);
+    report.write(file, 50);
+
+    std::ostringstream summary;
+    report.write(summary, 10);
+    OREO_INFO(LogCategory::Compile, summary.str() << "Full report: " << reportPath);
+}
+
+void BuildSystem::reportUsage() {
+    std::lock_guard<std::mutex> lock(usageMutex);
+    if (buildUsage.jobs == 0) {
+        return;
+    }
+    // Job wall time adds up across workers, so CPU over it says how much of
+    // the time jobs held a worker they actually computed rather than waited
+    // on I/O or page faults.
+    uint64_t cpuMicros = buildUsage.userMicros + buildUsage.systemMicros;
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2) << "Resources: " << buildUsage.jobs << " job(s), "
+            << buildJobMicros / 1e6 << " s wall, " << buildUsage.userMicros / 1e6 << " s user + "
+            << buildUsage.systemMicros / 1e6 << " s system CPU";
+    if (buildJobMicros > 0) {
+        summary << " (" << std::setprecision(0) << 100.0 * cpuMicros / buildJobMicros << "% on CPU)";
+    }
+    summary << ", " << buildUsage.majorFaults << " major fault(s); peak RSS " << std::setprecision(1)
+            << buildUsage.peakRssKb / 1024.0 << " MB (" << heaviestStep << ")";
+    OREO_INFO(LogCategory::General, summary.str());
+}
+
+void BuildSystem::reportTopRss() {
+    if (topRss == 0) {
+        return;
+    }
+    // Measured usage survives no-op builds, so the report covers every step
+    // that ever ran, not just what this build rebuilt.
+    auto usages = manifest.getStepUsages();
+    if (usages.empty()) {
+        OREO_INFO(LogCategory::General, "No resource usage recorded yet.");
+        return;
+    }
+    size_t count = std::min(topRss, usages.size());
+    std::partial_sort(usages.begin(), usages.begin() + count, usages.end(), [](const auto& a, const auto& b) {
+        return a.second.peakRssKb != b.second.peakRssKb ? a.second.peakRssKb > b.second.peakRssKb : a.first < b.first;
+    });
+    std::ostringstream report;
+    report << "Top " << count << " step(s) by peak RSS:\n"
+           << std::right << std::setw(12) << "peak RSS" << std::setw(12) << "user" << std::setw(12) << "system"
+           << std::setw(8) << "faults" << "  output";
+    report << std::fixed;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& [output, usage] = usages[i];
+        report << "\n" << std::setprecision(1) << std::setw(9) << usage.peakRssKb / 1024.0 << " MB"
+               << std::setprecision(2) << std::setw(10) << usage.userMicros / 1e6 << " s"
+               << std::setw(10) << usage.systemMicros / 1e6 << " s" << std::setw(8) << usage.majorFaults
+               << "  " << output;
+    }
+    OREO_INFO(LogCategory::General, report.str());
+}
+
+uint64_t BuildSystem::predictedMemory(const std::string& output) const {
+    return manifest.getStepUsage(output).peakRssKb * 1024;
+}
+
+std::string BuildSystem::rebuildReason(const std::string& source, const std::string& object) {
+    if (Logger::isEnabled(LogLevel::Verbose, LogCategory::Deps)) {
+        OREO_VERBOSE(LogCategory::Deps, "Checking if " << source << " needs rebuild...");
+        FileUtils::printFileInfo(source);
+        FileUtils::printFileInfo(object);
+    }
+
+    if (!std::filesystem::exists(object)) {
+        return "missing output " + object;
+    }
+
+    if (config.isSplitDwarfEnabled() && !std::filesystem::exists(Compiler::getSplitDwarfPath(object))) {
+        return "missing output " + Compiler::getSplitDwarfPath(object);
+    }
+
+    std::string signature = compileSignature(source, object);
+    if (manifest.getCommandSignature(object) != signature) {
+        return "flags changed";
+    }
+
+    std::time_t lastModified = std::filesystem::last_write_time(source).time_since_epoch().count();
+    std::time_t compiledAt = 0;
+    if (!cacheMap.find(source, compiledAt)) {
+        return "no record of an earlier compile";
+    }
+    if (lastModified > compiledAt) {
+        return "content changed";
+    }
+
+    resolveDependencies(source, object);
+    for (const auto& dep : dependencies[source]) {
+        if (Logger::isEnabled(LogLevel::Debug, LogCategory::Deps)) {
+            OREO_DEBUG(LogCategory::Deps, "Checking dependency: " << dep);
+            FileUtils::printFileInfo(dep);
+        }
+        if (!std::filesystem::exists(dep)) {
+            OREO_WARN(LogCategory::Deps, "Warning: Dependency not found: " << dep);
+            continue;
+        }
+        if (FileUtils::isNewer(dep, object)) {
+            return "dependency " + dep + " changed";
+        }
+    }
+
+    OREO_VERBOSE(LogCategory::Deps, source << " is up to date.");
+    return "";
+}
+
+std::string BuildSystem::getLinkReason(const std::vector<std::string>& objects, const std::string& output,
+                                       size_t rebuiltObjects) const {
+    if (!std::filesystem::exists(output)) {
+        return "missing output " + output;
+    }
+    if (manifest.getCommandSignature(output) != commandSignature(compiler->getLinkCommand(objects, output, config))) {
+        return "link command changed";
+    }
+    if (rebuiltObjects > 0) {
+        return std::to_string(rebuiltObjects) + " object(s) rebuilt";
+    }
+    for (const auto& object : objects) {
+        if (FileUtils::isNewer(object, output)) {
+            return "object " + object + " changed";
+        }
+    }
+    return "";
+}
+
+void BuildSystem::resolveDependencies(const std::string& source, const std::string& object) {
+    // The depfile from the last compile is authoritative; scanning the source
+    // is only a fallback for objects that were built without one.
+    if (!loadDepfile(source, object)) {
+        parseDependencies(source);
+    }
+}
+
+bool BuildSystem::loadDepfile(const std::string& source, const std::string& object) {
+    std::ifstream file(Compiler::getDepfilePath(object));
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    std::string text = content.str();
+
+    // Join continuation lines, then read "targets: prerequisites" rules. GCC
+    // adds extra rules for modules (BMI targets, phony "name.c++m" entries,
+    // CXX_IMPORTS); only the rule for the object itself lists its inputs.
+    std::vector<std::string> lines;
+    std::string logical;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size() && (text[i + 1] == '\n' || text[i + 1] == '\r')) {
+            logical += ' ';
+            ++i;
+            if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n') {
+                ++i;
+            }
+        } else if (text[i] == '\n') {
+            lines.push_back(std::move(logical));
+            logical.clear();
+        } else {
+            logical += text[i];
+        }
+    }
+    lines.push_back(std::move(logical));
+
+    auto tokenize = [](const std::string& part) {
+        std::vector<std::string> tokens;
+        std::string current;
+        for (size_t i = 0; i < part.size(); ++i) {
+            char c = part[i];
+            if (c == '\\' && i + 1 < part.size() && part[i + 1] == ' ') {
+                current += ' ';
+                ++i;
+            } else if (std::isspace(static_cast<unsigned char>(c))) {
+                if (!current.empty()) {
+                    tokens.push_back(std::move(current));
+                    current.clear();
+                }
+            } else {
+                current += c;
+            }
+        }
+        if (!current.empty()) {
+            tokens.push_back(std::move(current));
+        }
+        return tokens;
+    };
+
+    std::set<std::string> deps;
+    bool foundRule = false;
+    for (const auto& line : lines) {
+        size_t colon = line.find(": ");
+        if (colon == std::string::npos && !line.empty() && line.back() == ':') {
+            colon = line.size() - 1;
+        }
+        if (colon == std::string::npos) {
+            continue;
+        }
+        auto targets = tokenize(line.substr(0, colon));
+        if (std::find(targets.begin(), targets.end(), object) == targets.end()) {
+            continue;
+        }
+        foundRule = true;
+        for (auto& dep : tokenize(line.substr(colon + 1))) {
+            bool moduleTarget = dep.size() > 5 && dep.compare(dep.size() - 5, 5, ".c++m") == 0;
+            if (dep != source && dep != "|" && !moduleTarget) {
+                deps.insert(std::move(dep));
+            }
+        }
+    }
+    if (!foundRule) {
+        return false;
+    }
+
+    OREO_DEBUG(LogCategory::Deps, "Using depfile dependencies for " << source << " (" << deps.size() << " files)");
+    dependencies[source] = std::move(deps);
+    return true;
+}
+
+void BuildSystem::parseDependencies(const std::string& source) {
+    dependencies[source] = getIncludeScanner().getDependencies(source);
+    OREO_DEBUG(LogCategory::Deps, "Predicted " << dependencies[source].size() << " include(s) for " << source);
+}
+
+void BuildSystem::prescanIncludes(const std::vector<std::string>& sources) {
+    // Sources compiled before have a depfile; the rest are scanned up front,
+    // in parallel, so each header they share is read once.
+    std::vector<std::string> unscanned;
+    for (const auto& source : sources) {
+        if (!std::filesystem::exists(Compiler::getDepfilePath(getObjectPath(source)))) {
+            unscanned.push_back(source);
+        }
+    }
+    if (!unscanned.empty()) {
+        getIncludeScanner().scanAll(unscanned, *threadPool);
+        OREO_VERBOSE(LogCategory::Deps, "Include scan: " << getIncludeScanner().getScannedCount()
+                     << " file(s) for " << unscanned.size() << " source(s) without a depfile");
+    }
+}
+
+IncludeScanner& BuildSystem::getIncludeScanner() {
+    if (!includeScanner) {
+        // Conditionals are evaluated against the macros the compile command
+        // predefines. Macros from per-source flag overrides stay unknown, so
+        // both of their branches count.
+        includeScanner = std::make_shared<IncludeScanner>(config.getIncludePaths(), getPredefinedMacros());
+    }
+    return *includeScanner;
+}
+
+std::unordered_map<std::string, std::string> BuildSystem::getPredefinedMacros() const {
+    std::string command = config.getCompiler();
+    for (const auto& flag : config.getCompilerFlags()) {
+        command += " " + flag;
+    }
+    command += " -dM -E -x c++ /dev/null 2>/dev/null";
+    std::string output;
+    if (FILE* pipe = ::popen(command.c_str(), "r")) {
+        char buffer[4096];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+            output.append(buffer, n);
+        }
+        ::pclose(pipe);
+    }
+    return IncludeScanner::parseMacroDefinitions(output);
+}
+
+void BuildSystem::impact(size_t limit) {
+    selectVariant();
+    if (manifest.getFileStates().empty()) {
+        OREO_INFO(LogCategory::General, Color::Yellow << "No build history for the " << config.getVariantName()
+                  << " variant yet. Run a build first." << Color::Reset);
+        Logger::flush();
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::pair<std::string, uint64_t>> translationUnits;
+    uint64_t knownCost = 0;
+    size_t knownCount = 0;
+    for (const auto& source : config.getSourceFiles()) {
+        uint64_t cost = manifest.getCompileCost(getObjectPath(source));
+        translationUnits.emplace_back(source, cost);
+        if (cost > 0) {
+            knownCost += cost;
+            knownCount++;
+        }
+    }
+    // Units that were never timed (e.g. built before costs were recorded)
+    // count as an average one.
+    uint64_t fallbackCost = knownCount > 0 ? knownCost / knownCount : 1000;
+    for (auto& unit : translationUnits) {
+        if (unit.second == 0) {
+            unit.second = fallbackCost;
+        }
+    }
+
+    auto entries = ImpactAnalysis::analyze(manifest, translationUnits, limit);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    std::ostringstream report;
+    report << "Rebuild impact (" << manifest.getFileStates().size() << " files, "
+           << manifest.getRecordedBuilds() << " recorded build(s), analyzed in " << elapsed.count() << " ms)\n";
+    report << std::setw(14) << "expected/build" << std::setw(14) << "rebuild" << std::setw(8) << "fan-in"
+           << std::setw(9) << "changes" << "  file";
+    for (const auto& entry : entries) {
+        report << "\n" << std::fixed << std::setprecision(1)
+               << std::setw(11) << entry.expectedCostUs / 1000.0 << " ms"
+               << std::setw(11) << entry.rebuildCostUs / 1000.0 << " ms"
+               << std::setw(8) << entry.fanIn << std::setw(9) << entry.changes << "  " << entry.path;
+    }
+    if (entries.empty()) {
+        report << "\n  (no headers recorded)";
+    }
+    OREO_INFO(LogCategory::General, report.str());
+    Logger::flush();
+}
+
+bool BuildSystem::query(const std::string& kind, const std::vector<std::string>& files, bool json) {
+    size_t expectedFiles = kind == "path" ? 2 : 1;
+    if ((kind != "deps" && kind != "rdeps" && kind != "path") || files.size() != expectedFiles) {
+        OREO_ERROR(LogCategory::General, Color::Red << "Error: query expects deps <file>, rdeps <file> or path <from> <to>"
+                   << Color::Reset);
+        return false;
+    }
+    selectVariant();
+    if (manifest.getFileStates().empty()) {
+        OREO_ERROR(LogCategory::General, Color::Red << "Error: No build history for the " << config.getVariantName()
+                   << " variant yet. Run a build first." << Color::Reset);
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    DependencyGraph graph(manifest);
+    std::vector<uint32_t> nodes;
+    for (const auto& file : files) {
+        uint32_t node;
+        if (!graph.find(file, node)) {
+            OREO_ERROR(LogCategory::General, Color::Red << "Error: " << file << " is not part of the last "
+                       << config.getVariantName() << " build" << Color::Reset);
+            return false;
+        }
+        nodes.push_back(node);
+    }
+
+    std::vector<uint32_t> results;
+    if (kind == "deps") {
+        results = graph.getDependencies(nodes[0]);
+    } else if (kind == "rdeps") {
+        results = graph.getDependents(nodes[0]);
+    } else {
+        results = findIncludeChain(graph, nodes[0], nodes[1]);
+    }
+    auto sources = config.getSourceFiles();
+    std::set<std::string> translationUnits(sources.begin(), sources.end());
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
 
-    // After loading, print out the contents
-    if (verbosityLevel >= VerbosityLevel::Verbose) {
-        std::cout << "Loaded configuration:" << std::endl;
-        std::cout << "Compiler: " << config.getCompiler() << std::endl;
-        std::cout << "Sources: " << joinString(config.getSourceFiles(), ", ") << std::endl;
-        std::cout << "Output: " << config.getOutputFile() << std::endl;
-        std::cout << "Include paths: " << joinString(config.getIncludePaths(), ", ") << std::endl;
-        std::cout << "System Include paths: " << joinString(config.getSystemIncludePaths(), ", ") << std::endl;
-        std::cout << "Libraries: " << joinString(config.getLibraries(), ", ") << std::endl;
-        std::cout << "Build Type: " << (config.isDebug() ? "Debug" : "Release") << std::endl;
-        std::cout << "Compiler Flags: " << joinString(config.getCompilerFlags(), " ") << std::endl;
-        std::cout << "Debug Flags: " << config.getDebugFlags() << std::endl;
-        std::cout << "Release Flags: " << config.getReleaseFlags() << std::endl;
+    if (json) {
+        std::ostringstream document;
+        document << "{\"query\":\"" << kind << "\",\"variant\":\"" << Json::escape(config.getVariantName())
+                 << "\",\"files\":[";
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            document << (i ? "," : "") << "\"" << Json::escape(graph.getName(nodes[i])) << "\"";
+        }
+        document << "],\"results\":[";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const std::string& name = graph.getName(results[i]);
+            document << (i ? "," : "") << "{\"path\":\"" << Json::escape(name) << "\",\"translationUnit\":"
+                     << (translationUnits.count(name) ? "true" : "false") << "}";
+        }
+        document << "],\"elapsedUs\":" << elapsed.count() << "}";
+        Logger::flush();
+        std::cout << document.str() << std::endl;
+        return true;
     }
-}
 
-std::string OreoBuild::BuildSystem::joinString(const std::vector<std::string>& v, const std::string& delimiter) {
-    std::string result;
-    for (size_t i = 0; i < v.size(); ++i) {
-        if (i > 0) {
-            result += delimiter;
+    const std::string& subject = graph.getName(nodes[0]);
+    std::ostringstream report;
+    if (kind == "path") {
+        if (results.empty()) {
+            report << subject << " does not depend on " << graph.getName(nodes[1]);
+        } else {
+            report << "Include chain from " << subject << " to " << graph.getName(nodes[1]) << ":";
+            for (size_t i = 0; i < results.size(); ++i) {
+                report << "\n  " << (i ? "-> " : "") << graph.getName(results[i]);
+            }
+        }
+    } else {
+        size_t unitCount = 0;
+        for (uint32_t node : results) {
+            unitCount += translationUnits.count(graph.getName(node));
+        }
+        if (kind == "deps") {
+            report << subject << " depends on " << results.size() << " file(s)";
+        } else {
+            report << results.size() << " file(s) depend on " << subject << ", " << unitCount
+                   << " of them translation unit(s)";
+        }
+        report << " (" << std::fixed << std::setprecision(1) << elapsed.count() / 1000.0 << " ms)";
+        for (uint32_t node : results) {
+            const std::string& name = graph.getName(node);
+            report << "\n  " << name << (kind == "rdeps" && translationUnits.count(name) ? "  [translation unit]" : "");
         }
-        result += v[i];
     }
-    return result;
+    OREO_INFO(LogCategory::General, report.str());
+    Logger::flush();
+    return true;
 }
 
+std::vector<uint32_t> BuildSystem::findIncludeChain(const DependencyGraph& graph, uint32_t from, uint32_t to) {
+    const uint32_t unreached = std::numeric_limits<uint32_t>::max();
+    std::vector<bool> recorded(graph.size(), false);
+    recorded[from] = true;
+    for (uint32_t node : graph.getDependencies(from)) {
+        recorded[node] = true;
+    }
+    if (!recorded[to] || from == to) {
+        return {};
+    }
 
-void BuildSystem::loadCache() {
-    std::ifstream cacheFile(cacheFilePath);
-    if (cacheFile.is_open()) {
-        std::string filePath;
-        std::time_t timestamp;
-        while (cacheFile >> filePath >> timestamp) {
-            cacheMap[filePath] = timestamp;
+    // A translation unit's headers are recorded as one flat set, so the
+    // chain itself comes from the direct includes of the files in that set,
+    // which is all that gets scanned. Generated files lead on to the inputs
+    // of their step through the recorded edges. When scanning cannot link
+    // the two (e.g. the includes changed since the build), the recorded
+    // edges alone still give a chain.
+    auto sources = config.getSourceFiles();
+    std::set<std::string> translationUnits(sources.begin(), sources.end());
+    for (bool scan : {true, false}) {
+        std::vector<uint32_t> parent(graph.size(), unreached);
+        parent[from] = from;
+        std::deque<uint32_t> queue = {from};
+        while (!queue.empty() && parent[to] == unreached) {
+            uint32_t node = queue.front();
+            queue.pop_front();
+            std::vector<uint32_t> next;
+            const std::string& name = graph.getName(node);
+            if (scan) {
+                for (const auto& include : getIncludeScanner().getIncludes(name)) {
+                    uint32_t target;
+                    if (graph.find(include, target)) {
+                        next.push_back(target);
+                    }
+                }
+            }
+            if (!scan || !translationUnits.count(name)) {
+                auto direct = graph.getDirectDependencies(node);
+                next.insert(next.end(), direct.begin(), direct.end());
+            }
+            for (uint32_t target : next) {
+                if (recorded[target] && parent[target] == unreached) {
+                    parent[target] = node;
+                    queue.push_back(target);
+                }
+            }
+        }
+        if (parent[to] != unreached) {
+            std::vector<uint32_t> chain = {to};
+            while (chain.back() != from) {
+                chain.push_back(parent[chain.back()]);
+            }
+            std::reverse(chain.begin(), chain.end());
+            return chain;
         }
     }
+    return {};
 }
 
-void BuildSystem::saveCache() {
-    std::ofstream cacheFile(cacheFilePath);
-    if (cacheFile.is_open()) {
-        for (const auto& entry : cacheMap) {
-            cacheFile << entry.first << " " << entry.second << std::endl;
-        }
+bool BuildSystem::plan() {
+    selectVariant();
+    includeScanner.reset();
+    if (isNoOpBuild()) {
+        OREO_INFO(LogCategory::General, Color::Yellow << "Everything is up to date. Nothing to do." << Color::Reset);
+        Logger::flush();
+        return true;
     }
-}
 
-void BuildSystem::build(const std::string& target, std::function<void(const std::string&)> progressCallback) {
-    buildStartTime = std::chrono::high_resolution_clock::now();
-    filesCompiled = 0;
+    struct PlanEntry {
+        std::string kind;
+        std::string name;
+        std::string reason;
+        bool measured;
+        size_t task;  // index into tasks, which also holds barriers
+    };
+    std::vector<PlanTask> tasks;
+    std::vector<PlanEntry> entries;  // one per task, except barriers
+    auto addTask = [&](const std::string& kind, const std::string& name, const std::string& reason,
+                       const std::string& costKey, const std::string& pool) {
+        uint64_t cost = manifest.getCompileCost(costKey);
+        tasks.push_back(PlanTask{name, cost, pool, {}});
+        entries.push_back(PlanEntry{kind, name, reason, cost > 0, tasks.size() - 1});
+        return tasks.size() - 1;
+    };
+
+    // Plugin steps run first, a step whose input another one regenerates
+    // included.
+    std::set<std::string> regenerated;
+    std::vector<size_t> pluginTasks;
+    if (pluginManager && !pluginManager->empty()) {
+        ConfigPluginHost host(config, getVariantDir());
+        std::vector<LoadedPluginNode> nodes;
+        try {
+            nodes = pluginManager->declareNodes(host);
+        } catch (const std::exception& e) {
+            OREO_ERROR(LogCategory::General, e.what());
+            return false;
+        }
+        std::vector<std::string> nodeReasons;
+        for (const auto& loaded : nodes) {
+            nodeReasons.push_back(pluginNodeRunReason(loaded.node, pluginNodeSignature(loaded)));
+            if (!nodeReasons.back().empty()) {
+                regenerated.insert(loaded.node.outputs.begin(), loaded.node.outputs.end());
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                for (const auto& input : nodes[i].node.inputs) {
+                    if (nodeReasons[i].empty() && regenerated.count(input)) {
+                        nodeReasons[i] = "input " + input + " is regenerated";
+                        regenerated.insert(nodes[i].node.outputs.begin(), nodes[i].node.outputs.end());
+                        changed = true;
+                    }
+                }
+            }
+        }
+        std::unordered_map<std::string, size_t> producers;
+        std::vector<size_t> nodeTasks(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodeReasons[i].empty()) {
+                continue;
+            }
+            const PluginNode& node = nodes[i].node;
+            nodeTasks[i] = addTask("plugin", nodes[i].plugin->getName() + ":" + node.name, nodeReasons[i],
+                                   node.outputs.empty() ? std::string() : node.outputs.front(), node.pool);
+            pluginTasks.push_back(nodeTasks[i]);
+            for (const auto& output : node.outputs) {
+                producers[output] = nodeTasks[i];
+            }
+        }
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (const auto& input : nodes[i].node.inputs) {
+                auto it = producers.find(input);
+                if (!nodeReasons[i].empty() && it != producers.end() && it->second != nodeTasks[i]) {
+                    tasks[nodeTasks[i]].after.push_back(it->second);
+                }
+            }
+        }
+    }
+    // Compiles wait for every plugin step; a zero-length barrier stands in
+    // for all those edges.
+    std::vector<size_t> barrier;
+    if (!pluginTasks.empty()) {
+        tasks.push_back(PlanTask{"", 0, "", pluginTasks});
+        barrier.push_back(tasks.size() - 1);
+    }
 
-    if (verbosityLevel >= VerbosityLevel::Verbose) {
-        std::cout << "Building target: " << target << std::endl;
-        std::cout << "Build type: " << (config.getBuildType() == BuildType::Debug ? "Debug" : "Release") << std::endl;
-        std::cout << "Using " << threadPool->getThreadCount() << " threads for compilation" << std::endl;
+    std::vector<std::string> sources = config.getSourceFiles();
+    for (const auto& source : sources) {
+        if (!std::filesystem::exists(source) && !regenerated.count(source)) {
+            OREO_ERROR(LogCategory::General, Color::Red << "Error: Source file not found: " << source << Color::Reset);
+            Logger::flush();
+            return false;
+        }
+    }
+    prescanIncludes(sources);
+    if (config.areModulesEnabled() && !scanModules(sources)) {
+        OREO_ERROR(LogCategory::Deps, Color::Red << "Module dependencies could not be resolved." << Color::Reset);
+        Logger::flush();
+        return false;
     }
 
     std::vector<std::string> objects;
     std::vector<std::string> objectsToCompile;
-    std::mutex outputMutex;
+    std::unordered_map<std::string, std::string> reasons;
+    for (const auto& source : sources) {
+        std::string object = getObjectPath(source);
+        objects.push_back(object);
+        std::string reason = regenerated.count(source) ? "regenerated by a plugin step" : rebuildReason(source, object);
+        for (auto it = dependencies[source].begin(); reason.empty() && it != dependencies[source].end(); ++it) {
+            if (regenerated.count(*it)) {
+                reason = "dependency " + *it + " is regenerated";
+            }
+        }
+        if (!reason.empty()) {
+            objectsToCompile.push_back(source);
+            reasons[source] = reason;
+        }
+    }
+    std::unordered_map<std::string, size_t> waitingOn;
+    std::unordered_map<std::string, std::vector<std::string>> dependents;
+    if (moduleMap) {
+        addModuleImporters(objectsToCompile, reasons);
+        if (!orderModuleUnits(objectsToCompile, waitingOn, dependents)) {
+            OREO_ERROR(LogCategory::Deps, Color::Red << "Module dependencies could not be resolved." << Color::Reset);
+            Logger::flush();
+            return false;
+        }
+    }
+    std::unordered_map<std::string, size_t> compileTasks;
+    for (const auto& source : objectsToCompile) {
+        compileTasks[source] = addTask("compile", source, reasons[source], getObjectPath(source),
+                                       config.getSourcePool(source));
+        tasks[compileTasks[source]].after = barrier;
+    }
+    for (const auto& [provider, importers] : dependents) {
+        for (const auto& importer : importers) {
+            tasks[compileTasks[importer]].after.push_back(compileTasks[provider]);
+        }
+    }
 
-    auto checkDependenciesStart = std::chrono::high_resolution_clock::now();
+    std::string output = getOutputPath();
+    std::string linkReason = getLinkReason(objects, output, objectsToCompile.size());
+    if (!linkReason.empty()) {
+        std::vector<size_t> after = barrier;
+        for (const auto& source : objectsToCompile) {
+            after.push_back(compileTasks[source]);
+        }
+        size_t linkTask = addTask("link", output, linkReason, output, config.getLinkPool());
+        tasks[linkTask].after = std::move(after);
+    }
 
-    for (const auto& source : config.getSourceFiles()) {
-        if (!std::filesystem::exists(source)) {
-            std::cerr << Color::Red << "Error: Source file not found: " << source << Color::Reset << std::endl;
-            return;
+    // Steps never timed count as an average one.
+    uint64_t measuredCost = 0;
+    size_t measuredCount = 0;
+    for (const auto& entry : entries) {
+        if (entry.measured) {
+            measuredCost += tasks[entry.task].durationUs;
+            measuredCount++;
         }
-        std::string obj = std::filesystem::path(source).filename().replace_extension(".o").string();
-        if (needsRebuild(source, obj)) {
-            objectsToCompile.push_back(source);
+    }
+    for (const auto& entry : entries) {
+        if (!entry.measured) {
+            tasks[entry.task].durationUs = measuredCount > 0 ? measuredCost / measuredCount : 0;
         }
-        objects.push_back(obj);
     }
 
-    auto checkDependenciesEnd = std::chrono::high_resolution_clock::now();
-    auto checkDependenciesDuration = std::chrono::duration_cast<std::chrono::milliseconds>(checkDependenciesEnd - checkDependenciesStart);
+    auto formatTime = [](uint64_t micros) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(1);
+        if (micros >= 1000000) {
+            text << micros / 1e6 << " s";
+        } else {
+            text << micros / 1e3 << " ms";
+        }
+        return text.str();
+    };
 
-    if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-        std::cout << "Time spent checking dependencies: " << checkDependenciesDuration.count() << " ms" << std::endl;
+    std::ostringstream report;
+    report << "Plan for the " << config.getVariantName() << " variant: " << entries.size() << " step(s) to run";
+    for (const auto& entry : entries) {
+        report << "\n" << std::setw(11) << (entry.measured ? formatTime(tasks[entry.task].durationUs) : "?") << "  "
+               << std::left << std::setw(8) << entry.kind << std::right << entry.name
+               << " (" << entry.reason << ")";
+    }
+    if (entries.empty()) {
+        report << "\n  (only recorded state changed; a build would just refresh it)";
+    } else if (measuredCount == 0) {
+        report << "\nNo timing history yet; run a build to get a wall time estimate.";
+    } else {
+        size_t jobs = threadPool->getThreadCount();
+        auto pools = config.getPools();
+        uint64_t serial = 0;
+        for (const auto& task : tasks) {
+            serial += task.durationUs;
+        }
+        size_t suggested = BuildPlan::suggestJobs(tasks, pools);
+        report << "\nEstimated wall time: " << formatTime(BuildPlan::simulate(tasks, jobs, pools)) << " with "
+               << jobs << " job(s) (serial " << formatTime(serial) << ", critical path "
+               << formatTime(BuildPlan::simulate(tasks, tasks.size(), pools)) << ")";
+        report << "\nMore than " << suggested << " job(s) would save less than 5% (estimated "
+               << formatTime(BuildPlan::simulate(tasks, suggested, pools)) << " at jobs = " << suggested << ")";
+        if (measuredCount < entries.size()) {
+            report << "\n" << entries.size() - measuredCount << " step(s) without timing history count as an average one.";
+        }
     }
+    OREO_INFO(LogCategory::General, report.str());
+    Logger::flush();
+    return true;
+}
 
-    std::atomic<bool> compilationFailed(false);
-    std::atomic<int> compiledCount(0);
+bool BuildSystem::runPluginNodes() {
+    pluginNodes.clear();
+    if (!pluginManager || pluginManager->empty()) {
+        return true;
+    }
+    std::unique_lock<std::mutex> stepLock;
+    if (pluginStepMutex) {
+        stepLock = std::unique_lock<std::mutex>(*pluginStepMutex);
+    }
+    ConfigPluginHost host(config, getVariantDir());
+    try {
+        pluginNodes = pluginManager->declareNodes(host);
+    } catch (const std::exception& e) {
+        OREO_ERROR(LogCategory::General, e.what());
+        return false;
+    }
 
-    auto compilationStart = std::chrono::high_resolution_clock::now();
+    auto pools = config.getPools();
+    // A node waits for every node that produces one of its inputs.
+    size_t nodeCount = pluginNodes.size();
+    std::unordered_map<std::string, size_t> producers;
+    for (size_t i = 0; i < nodeCount; ++i) {
+        for (const auto& output : pluginNodes[i].node.outputs) {
+            producers[output] = i;
+        }
+    }
+    std::vector<size_t> waitingOn(nodeCount, 0);
+    std::vector<std::vector<size_t>> dependents(nodeCount);
+    for (size_t i = 0; i < nodeCount; ++i) {
+        std::set<size_t> producedBy;
+        for (const auto& input : pluginNodes[i].node.inputs) {
+            auto it = producers.find(input);
+            if (it != producers.end() && it->second != i) {
+                producedBy.insert(it->second);
+            }
+        }
+        waitingOn[i] = producedBy.size();
+        for (size_t producer : producedBy) {
+            dependents[producer].push_back(i);
+        }
+        for (const auto& output : pluginNodes[i].node.outputs) {
+            dependencies[output] = std::set<std::string>(pluginNodes[i].node.inputs.begin(),
+                                                         pluginNodes[i].node.inputs.end());
+        }
+        const std::string& pool = pluginNodes[i].node.pool;
+        if (!pool.empty() && pools.count(pool) == 0) {
+            OREO_WARN(LogCategory::General, "Warning: plugin node " << pluginNodes[i].node.name
+                      << " uses undeclared pool '" << pool << "'; it runs unpooled.");
+        }
+    }
 
-    size_t totalFiles = objectsToCompile.size();
-    for (const auto& source : objectsToCompile) {
-        threadPool->enqueue([this, &source, &outputMutex, &compilationFailed, &compiledCount, totalFiles, &progressCallback] {
-            std::string obj = std::filesystem::path(source).filename().replace_extension(".o").string();
-            if (compiler->compile(source, obj, config)) {
+    std::vector<size_t> remaining = waitingOn;
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < nodeCount; ++i) {
+        if (remaining[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+    std::vector<size_t> initiallyReady = ready;
+    size_t ordered = 0;
+    while (!ready.empty()) {
+        size_t index = ready.back();
+        ready.pop_back();
+        ordered++;
+        for (size_t dependent : dependents[index]) {
+            if (--remaining[dependent] == 0) {
+                ready.push_back(dependent);
+            }
+        }
+    }
+    if (ordered != nodeCount) {
+        OREO_ERROR(LogCategory::General, "Plugin nodes form a dependency cycle.");
+        return false;
+    }
+
+    std::mutex stateMutex;
+    std::atomic<bool> failed(false);
+    std::atomic<size_t> finished(0);
+    std::atomic<int> inFlight(0);
+    std::function<void(size_t)> enqueueNode;
+    enqueueNode = [&](size_t index) {
+        inFlight++;
+        resourcePools->submit(pluginNodes[index].node.pool, [&, index] {
+            if (failed || Process::isCancelled()) {
+                failed = true;
+                inFlight--;
+                return;
+            }
+            if (runPluginNode(pluginNodes[index], host)) {
+                std::vector<size_t> next;
                 {
-                    std::lock_guard<std::mutex> lock(outputMutex);
-                    if (verbosityLevel >= VerbosityLevel::Normal) {
-                        std::cout << Color::Green << "Compiled: " << source << " to " << obj << Color::Reset << std::endl;
+                    std::lock_guard<std::mutex> lock(stateMutex);
+                    finished++;
+                    for (size_t dependent : dependents[index]) {
+                        if (--waitingOn[dependent] == 0) {
+                            next.push_back(dependent);
+                        }
                     }
-                    filesCompiled++;
-                    compiledCount++;
-                    if (progressCallback) {
-                        progressCallback(source);
+                }
+                for (size_t dependent : next) {
+                    if (!failed) {
+                        enqueueNode(dependent);
                     }
                 }
-                FileUtils::updateTimestamp(obj);
-
-                std::time_t lastModified = std::filesystem::last_write_time(source).time_since_epoch().count();
-                cacheMap[source] = lastModified;
             } else {
-                {
-                    std::lock_guard<std::mutex> lock(outputMutex);
-                    std::cerr << Color::Red << "Failed to compile: " << source << Color::Reset << std::endl;
-                }
-                compilationFailed = true;
-           }
+                failed = true;
+            }
+            inFlight--;
         });
+    };
+    for (size_t index : initiallyReady) {
+        enqueueNode(index);
     }
 
-    while (compiledCount < objectsToCompile.size() && !compilationFailed) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    while ((finished < nodeCount && !failed) || inFlight > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+    return !failed;
+}
 
-    auto compilationEnd = std::chrono::high_resolution_clock::now();
-    auto compilationDuration = std::chrono::duration_cast<std::chrono::milliseconds>(compilationEnd - compilationStart);
+std::string BuildSystem::pluginNodeSignature(const LoadedPluginNode& loaded) {
+    // Like a compile command signature: everything that decides the outputs
+    // apart from the contents of the inputs.
+    const PluginNode& node = loaded.node;
+    Hasher hasher;
+    hasher.update(loaded.plugin->getName()).update(loaded.pluginDigest).update(node.name).update(node.signature);
+    for (const auto& input : node.inputs) {
+        hasher.update(input);
+    }
+    for (const auto& output : node.outputs) {
+        hasher.update(output);
+    }
+    return hasher.hexDigest();
+}
 
-    if (verbosityLevel >= VerbosityLevel::Verbose) {
-        std::cout << std::endl;  // New line after progress bar
+std::string BuildSystem::pluginNodeRunReason(const PluginNode& node, const std::string& signature) const {
+    int64_t oldestOutput = std::numeric_limits<int64_t>::max();
+    for (const auto& output : node.outputs) {
+        FileState state = FileUtils::getFileState(output);
+        if (!state.exists) {
+            return "missing output " + output;
+        }
+        oldestOutput = std::min(oldestOutput, state.mtimeNs);
+        if (manifest.getCommandSignature(output) != signature) {
+            return "step changed";
+        }
+    }
+    for (const auto& input : node.inputs) {
+        FileState state = FileUtils::getFileState(input);
+        if (!state.exists) {
+            return "input " + input + " missing";
+        }
+        if (state.mtimeNs > oldestOutput) {
+            return "input " + input + " changed";
+        }
     }
+    return "";
+}
 
-    if (compilationFailed) {
-        std::cerr << Color::Red << "Build failed due to compilation errors." << Color::Reset << std::endl;
-        return;
+bool BuildSystem::runPluginNode(const LoadedPluginNode& loaded, PluginHost& host) {
+    const PluginNode& node = loaded.node;
+    std::string label = loaded.plugin->getName() + ":" + node.name;
+    std::string signature = pluginNodeSignature(loaded);
+    std::string reason = pluginNodeRunReason(node, signature);
+    if (reason.empty()) {
+        OREO_VERBOSE(LogCategory::General, label << " is up to date.");
+        return true;
     }
 
-    if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-        std::cout << "Time spent on compilation: " << compilationDuration.count() << " ms" << std::endl;
+    OREO_VERBOSE(LogCategory::Deps, label << " is out of date: " << reason);
+
+    std::vector<CacheOutput> outputs;
+    for (const auto& output : node.outputs) {
+        std::filesystem::path parent = std::filesystem::path(output).parent_path();
+        if (!parent.empty()) {
+            std::filesystem::create_directories(parent);
+        }
+        outputs.push_back({output, output});
     }
 
-    auto linkingStart = std::chrono::high_resolution_clock::now();
+    // The run time is recorded against the first output.
+    auto recordSignature = [&](uint64_t micros) {
+        for (size_t i = 0; i < node.outputs.size(); ++i) {
+            recordStep(node.outputs[i], signature, i == 0 ? micros : 0);
+        }
+    };
 
-    std::string output = config.getOutputFile();
-    if (std::any_of(objects.begin(), objects.end(), 
-                    [&output](const std::string& obj) { return FileUtils::isNewer(obj, output); })) {
-        if (compiler->link(objects, output, config)) {
-            if (verbosityLevel >= VerbosityLevel::Normal) {
-                std::cout << Color::Green << "Build successful. Output: " << output << Color::Reset << std::endl;
-            }
-        } else {
-            std::cerr << Color::Red << "Linking failed." << Color::Reset << std::endl;
+    // The cache key adds the input contents, so equal inputs anywhere share
+    // the outputs.
+    bool cacheable = remoteCache && remoteCache->isAvailable() && node.cacheable;
+    std::string actionKey;
+    if (cacheable) {
+        Sha256 keyHasher;
+        keyHasher.update("plugin\n").update(signature).update("\n");
+        for (const auto& input : node.inputs) {
+            std::ifstream file(input, std::ios::binary);
+            std::ostringstream content;
+            content << file.rdbuf();
+            keyHasher.update(input).update("\n").update(Sha256::hash(content.str())).update("\n");
         }
-    } else {
-        if (verbosityLevel >= VerbosityLevel::Normal) {
-            std::cout << Color::Yellow << "Output is up to date. Skipping link step." << Color::Reset << std::endl;
+        actionKey = keyHasher.hexDigest();
+        if (remoteCache->fetch(actionKey, outputs)) {
+            Metrics::add(Counter::CacheHits);
+            OREO_INFO(LogCategory::Cache, "Cache hit: " << label);
+            recordSignature(0);
+            return true;
         }
+        Metrics::add(Counter::CacheMisses);
     }
 
-    auto linkingEnd = std::chrono::high_resolution_clock::now();
-    auto linkingDuration = std::chrono::duration_cast<std::chrono::milliseconds>(linkingEnd - linkingStart);
-
-    if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-        std::cout << "Time spent on linking: " << linkingDuration.count() << " ms" << std::endl;
+    OREO_INFO(LogCategory::General, "Running: " << label << (explain ? " (" + reason + ")" : std::string()));
+    bool succeeded = false;
+    auto runStart = std::chrono::steady_clock::now();
+    try {
+        succeeded = loaded.plugin->run(node, host);
+    } catch (const std::exception& e) {
+        OREO_ERROR(LogCategory::General, label << " threw: " << e.what());
+    }
+    uint64_t runMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - runStart).count();
+    for (const auto& output : node.outputs) {
+        if (succeeded && !std::filesystem::exists(output)) {
+            OREO_ERROR(LogCategory::General, label << " did not produce " << output);
+            succeeded = false;
+        }
+    }
+    if (!succeeded) {
+        OREO_ERROR(LogCategory::General, Color::Red << "Plugin step failed: " << label << Color::Reset);
+        return false;
     }
+    if (cacheable) {
+        remoteCache->storeAsync(actionKey, outputs);
+    }
+    recordSignature(runMicros);
+    return true;
 }
 
-bool BuildSystem::needsRebuild(const std::string& source, const std::string& object) {
-    if (verbosityLevel >= VerbosityLevel::Verbose) {
-        std::cout << "Checking if " << source << " needs rebuild..." << std::endl;
-        FileUtils::printFileInfo(source);
-        FileUtils::printFileInfo(object);
+std::string BuildSystem::getTestPath(const std::string& name) const {
+    return (std::filesystem::path(getVariantDir()) / "tests" / name).string();
+}
+
+std::string BuildSystem::testInputKey(const TestTarget& test,
+                                      std::unordered_map<std::string, std::string>& contentHashes) {
+    Hasher hasher;
+    hasher.update(test.args).update(manifest.getCommandSignature(getTestPath(test.name)));
+    std::set<std::string> inputs;
+    for (const auto& source : test.sources) {
+        std::string object = getObjectPath(source);
+        hasher.update(source).update(manifest.getCommandSignature(object));
+        resolveDependencies(source, object);
+        inputs.insert(source);
+        inputs.insert(dependencies[source].begin(), dependencies[source].end());
+    }
+    for (const auto& input : inputs) {
+        auto it = contentHashes.find(input);
+        if (it == contentHashes.end()) {
+            std::ifstream file(input, std::ios::binary);
+            std::ostringstream content;
+            content << file.rdbuf();
+            it = contentHashes.emplace(input, Hasher().update(content.str()).hexDigest()).first;
+        }
+        hasher.update(input).update(it->second);
     }
+    return hasher.hexDigest();
+}
 
-    static BuildType lastBuildType = BuildType::Debug;
-    if (config.getBuildType() != lastBuildType) {
-        lastBuildType = config.getBuildType();
-        if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Build type changed. Rebuilding." << std::endl;
-        return true;
+bool BuildSystem::test(size_t shardIndex, size_t shardCount) {
+    std::vector<TestTarget> tests;
+    try {
+        tests = config.getTests();
+        config.getPools();
+    } catch (const std::exception& e) {
+        OREO_ERROR(LogCategory::General, Color::Red << "Error: " << e.what() << Color::Reset);
+        return false;
+    }
+    if (tests.empty()) {
+        OREO_ERROR(LogCategory::General, Color::Red << "No tests configured; list them as \"tests = name: source...\"." << Color::Reset);
+        return false;
     }
+    if (!build("all")) {
+        return false;
+    }
+    auto testStart = std::chrono::steady_clock::now();
 
-    if (!std::filesystem::exists(object)) {
-        if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Object file doesn't exist. Rebuilding." << std::endl;
-        return true;
+    // Shards take every shardCount-th test, so each gets a similar share
+    // however the tests are ordered.
+    std::vector<TestTarget> selected;
+    for (size_t i = shardIndex; i < tests.size(); i += shardCount) {
+        selected.push_back(tests[i]);
     }
 
-    std::time_t lastModified = std::filesystem::last_write_time(source).time_since_epoch().count();
-    auto it = cacheMap.find(source);
-    if (it == cacheMap.end() || lastModified > it->second) {
-        if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Source file is newer than cached timestamp. Rebuilding." << std::endl;
-        return true;
+    // The build has compiled the project's own sources; what is left are
+    // the sources only tests use.
+    std::vector<std::string> projectSources = config.getSourceFiles();
+    std::set<std::string> seen(projectSources.begin(), projectSources.end());
+    std::vector<std::string> testSources;
+    for (const auto& test : selected) {
+        for (const auto& source : test.sources) {
+            if (!seen.insert(source).second) {
+                continue;
+            }
+            if (!std::filesystem::exists(source)) {
+                OREO_ERROR(LogCategory::General, Color::Red << "Error: Test source not found: " << source << Color::Reset);
+                Logger::flush();
+                return false;
+            }
+            testSources.push_back(source);
+        }
+    }
+    prescanIncludes(testSources);
+    std::vector<std::string> toCompile;
+    for (const auto& source : testSources) {
+        std::string reason = rebuildReason(source, getObjectPath(source));
+        if (!reason.empty()) {
+            toCompile.push_back(source);
+            if (explain) {
+                OREO_INFO(LogCategory::Deps, "Rebuilding " << source << ": " << reason);
+            }
+        }
+    }
+    std::unordered_map<std::string, size_t> waitingOn;
+    if (!compileUnits(toCompile, waitingOn, {}, nullptr)) {
+        saveState();
+        Logger::flush();
+        return false;
     }
 
-    parseDependencies(source);
-    for (const auto& dep : dependencies[source]) {
-        if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-            std::cout << "Checking dependency: " << dep << std::endl;
-            FileUtils::printFileInfo(dep);
+    std::atomic<bool> linkFailed(false);
+    std::atomic<int> inFlight(0);
+    for (const auto& test : selected) {
+        std::vector<std::string> objects;
+        for (const auto& source : test.sources) {
+            objects.push_back(getObjectPath(source));
         }
-        if (!std::filesystem::exists(dep)) {
-            std::cerr << "Warning: Dependency not found: " << dep << std::endl;
+        std::string output = getTestPath(test.name);
+        std::string reason = getLinkReason(objects, output, 0);
+        if (reason.empty()) {
             continue;
         }
-        if (FileUtils::isNewer(dep, object)) {
-            if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Dependency " << dep << " is newer than object file. Rebuilding." << std::endl;
-            return true;
+        if (explain) {
+            OREO_INFO(LogCategory::Link, "Linking " << output << ": " << reason);
         }
+        inFlight++;
+        resourcePools->submit(config.getLinkPool(), [this, objects, output, &linkFailed, &inFlight] {
+            std::filesystem::create_directories(std::filesystem::path(output).parent_path());
+            auto linkStart = std::chrono::steady_clock::now();
+            Process::resetThreadUsage();
+            if (!Process::isCancelled() && compiler->link(objects, output, config)) {
+                recordStep(output, commandSignature(compiler->getLinkCommand(objects, output, config)),
+                           std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::steady_clock::now() - linkStart).count(),
+                           Process::getThreadUsage());
+            } else {
+                linkFailed = true;
+            }
+            inFlight--;
+        }, predictedMemory(output));
+    }
+    while (inFlight > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (linkFailed) {
+        OREO_ERROR(LogCategory::Link, Color::Red << "Linking tests failed." << Color::Reset);
+        saveState();
+        Logger::flush();
+        return false;
     }
 
-    if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << source << " is up to date." << std::endl;
-    return false;
-}
-
-void BuildSystem::parseDependencies(const std::string& source) {
-    auto lastModified = std::filesystem::last_write_time(source).time_since_epoch().count();
-    if (dependencyCacheTimestamps[source] == lastModified) {
-        if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-            std::cout << "Using cached dependencies for " << source << std::endl;
+    // Passing results are remembered by input key; a test whose key has not
+    // changed since it passed is not run again.
+    std::string resultsPath = (std::filesystem::path(getVariantDir()) / "test_results.txt").string();
+    std::unordered_map<std::string, std::string> passedKeys;
+    {
+        std::ifstream file(resultsPath);
+        std::string key, name;
+        while (file >> key >> name) {
+            passedKeys[name] = key;
         }
-        return;
     }
+    std::string toolchain = FileUtils::findExecutable(config.getCompiler());
+    FileState toolchainState = FileUtils::getFileState(toolchain);
+    std::unordered_map<std::string, std::string> contentHashes;
+    struct TestRun {
+        const TestTarget* test;
+        std::string key;
+        uint64_t expectedMicros;
+    };
+    std::vector<TestRun> runs;
+    size_t upToDate = 0;
+    for (const auto& test : selected) {
+        std::string key = Hasher()
+                              .update(toolchain)
+                              .update(static_cast<uint64_t>(toolchainState.mtimeNs))
+                              .update(testInputKey(test, contentHashes))
+                              .hexDigest();
+        auto it = passedKeys.find(test.name);
+        if (it != passedKeys.end() && it->second == key) {
+            OREO_VERBOSE(LogCategory::General, "Skipping " << test.name << ": passed with the same inputs");
+            upToDate++;
+            continue;
+        }
+        runs.push_back({&test, key, manifest.getCompileCost("test:" + test.name)});
+    }
+    // Longest first, so that a slow test does not start last.
+    std::stable_sort(runs.begin(), runs.end(), [](const TestRun& a, const TestRun& b) {
+        return a.expectedMicros > b.expectedMicros;
+    });
+
+    std::mutex resultMutex;
+    size_t passed = 0;
+    size_t failed = 0;
+    size_t timedOut = 0;
+    for (const auto& run : runs) {
+        inFlight++;
+        resourcePools->submit(config.getTestPool(), [&, run] {
+            if (Process::isCancelled()) {
+                inFlight--;
+                return;
+            }
+            const TestTarget& test = *run.test;
+            std::string binary = getTestPath(test.name);
+            std::string log = binary + ".log";
+            // test_args is shell syntax on purpose; the paths are not.
+            std::string command = Process::shellQuote(binary) + (test.args.empty() ? "" : " " + test.args) + " > " +
+                                  Process::shellQuote(log) + " 2>&1";
+            bool expired = false;
+            auto runStart = std::chrono::steady_clock::now();
+            int status = Process::run(command, test.timeoutSeconds * 1000, expired);
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - runStart).count();
 
-    if (verbosityLevel >= VerbosityLevel::VeryVerbose) std::cout << "Parsing dependencies for " << source << std::endl;
-    if (dependencies.find(source) != dependencies.end()) {
-        dependencies[source].clear();
-    }
-
-    std::ifstream file(source);
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.find("#include") != std::string::npos) {
-            std::istringstream iss(line);
-            std::string include, filename;
-            iss >> include >> filename;
-            if (!filename.empty()) {
-                bool isSystemHeader = filename[0] == '<';
-                filename = filename.substr(1, filename.length() - 2);
-                
-                if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-                    std::cout << "Found include: " << filename << (isSystemHeader ? " (system header)" : "") << std::endl;
+            std::lock_guard<std::mutex> lock(resultMutex);
+            if (Process::isCancelled()) {
+                passedKeys.erase(test.name);
+            } else if (status == 0 && !expired) {
+                passed++;
+                passedKeys[test.name] = run.key;
+                manifest.recordCompileCost("test:" + test.name, micros);
+                journal.append("cost", std::to_string(micros), "test:" + test.name);
+                OREO_INFO(LogCategory::General, Color::Green << "PASS: " << test.name << " (" << micros / 1000 << " ms)" << Color::Reset);
+            } else {
+                passedKeys.erase(test.name);
+                if (expired) {
+                    timedOut++;
+                    OREO_ERROR(LogCategory::General, Color::Red << "TIMEOUT: " << test.name << " after "
+                               << test.timeoutSeconds << " s" << Color::Reset);
+                } else {
+                    failed++;
+                    OREO_ERROR(LogCategory::General, Color::Red << "FAIL: " << test.name << " (exit status "
+                               << (WIFEXITED(status) ? WEXITSTATUS(status) : status) << ")" << Color::Reset);
                 }
-                
-                if (!isSystemHeader) {
-                    for (const auto& path : config.getIncludePaths()) {
-                        std::string fullPath = std::filesystem::path(path) / filename;
-                        if (std::filesystem::exists(fullPath)) {
-                            if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Adding dependency: " << fullPath << " for " << source << std::endl;
-                            addDependency(source, fullPath);
-                            break;
-                        }
+                // The end of the output usually says what went wrong.
+                std::ifstream file(log);
+                std::deque<std::string> tail;
+                for (std::string line; std::getline(file, line);) {
+                    tail.push_back(line);
+                    if (tail.size() > 40) {
+                        tail.pop_front();
                     }
                 }
+                std::ostringstream output;
+                for (const auto& line : tail) {
+                    output << "    " << line << "\n";
+                }
+                if (!tail.empty()) {
+                    OREO_ERROR(LogCategory::General, output.str() << "    (full output in " << log << ")");
+                }
             }
-        }
+            inFlight--;
+        });
+    }
+    while (inFlight > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::ostringstream results;
+    for (const auto& [name, key] : passedKeys) {
+        results << key << " " << name << "\n";
+    }
+    if (!FileUtils::writeFileAtomically(resultsPath, results.str())) {
+        OREO_WARN(LogCategory::General, "Warning: Unable to write test results: " << resultsPath);
+    }
+    saveState();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - testStart);
+    bool succeeded = failed == 0 && timedOut == 0 && !Process::isCancelled();
+    if (Process::wasInterrupted()) {
+        OREO_ERROR(LogCategory::General, Color::Red << "Test run interrupted." << Color::Reset);
+    }
+    OREO_INFO(LogCategory::General, (succeeded ? Color::Green : Color::Red)
+              << "Tests: " << passed << " passed, " << failed << " failed, " << timedOut << " timed out, "
+              << upToDate << " up to date (" << selected.size() << " of " << tests.size() << " selected) in "
+              << elapsed.count() << " ms" << Color::Reset);
+    Logger::flush();
+    return succeeded;
+}
+
+bool BuildSystem::pgo(const std::string& trainCommand) {
+    config.setPgoPhase(PgoPhase::Instrument);
+    OREO_INFO(LogCategory::General, Color::Cyan << "PGO: building instrumented binary in " << getVariantDir() << Color::Reset);
+    if (!build("all")) {
+        OREO_ERROR(LogCategory::General, Color::Red << "PGO: instrumented build failed." << Color::Reset);
+        config.setPgoPhase(PgoPhase::None);
+        return false;
     }
+    std::vector<std::string> instrumentedObjects = getObjectFiles();
+    std::string instrumentedOutput = getOutputPath();
 
-    dependencyCacheTimestamps[source] = lastModified;
-    if (verbosityLevel >= VerbosityLevel::VeryVerbose) {
-        std::cout << "Cached dependencies for " << source << std::endl;
+    // Stale counters from an earlier training run would skew the profile.
+    compiler->clearProfiles(instrumentedObjects, config);
+    std::string command = trainCommand;
+    for (size_t pos = command.find("{output}"); pos != std::string::npos; pos = command.find("{output}", pos)) {
+        command.replace(pos, 8, instrumentedOutput);
+        pos += instrumentedOutput.size();
+    }
+    OREO_INFO(LogCategory::General, Color::Cyan << "PGO: training with: " << command << Color::Reset);
+    Logger::flush();
+    // The training run stays in the foreground so it can use the terminal.
+    int result = std::system(command.c_str());
+    if (result != 0) {
+        OREO_ERROR(LogCategory::General, Color::Red << "PGO: training command failed with error code: " << result << Color::Reset);
+        config.setPgoPhase(PgoPhase::None);
+        return false;
+    }
+
+    config.setPgoPhase(PgoPhase::Optimize);
+    std::vector<std::string> optimizedObjects = getObjectFiles();
+    std::vector<std::pair<std::string, std::string>> objectPairs;
+    for (size_t i = 0; i < instrumentedObjects.size(); ++i) {
+        objectPairs.emplace_back(instrumentedObjects[i], optimizedObjects[i]);
+    }
+    if (!compiler->mergeProfiles(objectPairs, config)) {
+        OREO_ERROR(LogCategory::General, Color::Red << "PGO: profiles could not be merged." << Color::Reset);
+        config.setPgoPhase(PgoPhase::None);
+        return false;
     }
+
+    OREO_INFO(LogCategory::General, Color::Cyan << "PGO: building optimized binary in " << getVariantDir() << Color::Reset);
+    bool succeeded = build("all");
+    config.setPgoPhase(PgoPhase::None);
+    return succeeded;
 }
 
-void BuildSystem::addDependency(const std::string& source, const std::string& dependency) {
-    dependencies[source].insert(dependency);
-    parseDependencies(dependency);
+void BuildSystem::pruneLtoCache() {
+    if (config.getLtoMode() == "off" || !std::filesystem::is_directory(config.getLtoCacheDir())) {
+        return;
+    }
+    // lld prunes on its own schedule; this keeps the bound after every link
+    // and covers linkers that have no cache policy at all.
+    size_t removed = FileUtils::pruneDirectory(config.getLtoCacheDir(), config.getLtoCacheSizeBytes());
+    if (removed > 0) {
+        OREO_VERBOSE(LogCategory::Link, "Pruned " << removed << " file(s) from the LTO cache " << config.getLtoCacheDir());
+    }
 }
 
 void BuildSystem::clean(bool forceClean) {
     if (!forceClean) {
+        Logger::flush();
         std::cout << "Are you sure you want to clean all build artifacts? This action cannot be undone. (y/N): ";
         std::string response;
         std::getline(std::cin, response);
@@ -303,7 +2219,8 @@ void BuildSystem::clean(bool forceClean) {
         }
     }
 
-    std::cout << "Cleaning build artifacts..." << std::endl;
+    selectVariant();
+    OREO_INFO(LogCategory::General, "Cleaning build artifacts in " << selectedVariantDir << "...");
     
     int removedCount = 0;
     int failedCount = 0;
@@ -311,11 +2228,11 @@ void BuildSystem::clean(bool forceClean) {
     auto removeFile = [this, &removedCount, &failedCount](const std::string& file) {
         try {
             if (std::filesystem::exists(file) && std::filesystem::remove(file)) {
-                if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Removed: " << file << std::endl;
+                OREO_VERBOSE(LogCategory::General, "Removed: " << file);
                 removedCount++;
             }
         } catch (const std::filesystem::filesystem_error& e) {
-            std::cerr << "Error removing " << file << ": " << e.what() << std::endl;
+            OREO_ERROR(LogCategory::General, "Error removing " << file << ": " << e.what());
             failedCount++;
         }
     };
@@ -323,31 +2240,80 @@ void BuildSystem::clean(bool forceClean) {
     // Remove object files and output file
     for (const auto& obj : getObjectFiles()) {
         removeFile(obj);
+        removeFile(Compiler::getSplitDwarfPath(obj));
+        removeFile(Compiler::getDepfilePath(obj));
+    }
+    removeFile(getOutputPath());
+    removeFile(getOutputPath() + ".dwp");
+
+    try {
+        for (const auto& test : config.getTests()) {
+            for (const auto& source : test.sources) {
+                std::string obj = getObjectPath(source);
+                removeFile(obj);
+                removeFile(Compiler::getSplitDwarfPath(obj));
+                removeFile(Compiler::getDepfilePath(obj));
+            }
+            removeFile(getTestPath(test.name));
+            removeFile(getTestPath(test.name) + ".log");
+        }
+    } catch (const std::exception& e) {
+        OREO_ERROR(LogCategory::General, "Unable to list tests: " << e.what());
+        failedCount++;
+    }
+    removeFile((std::filesystem::path(selectedVariantDir) / "test_results.txt").string());
+
+    if (pluginManager && !pluginManager->empty()) {
+        ConfigPluginHost host(config, getVariantDir());
+        try {
+            for (const auto& loaded : pluginManager->declareNodes(host)) {
+                for (const auto& output : loaded.node.outputs) {
+                    removeFile(output);
+                }
+            }
+        } catch (const std::exception& e) {
+            OREO_ERROR(LogCategory::General, "Unable to list plugin outputs: " << e.what());
+            failedCount++;
+        }
+    }
+
+    // Module artifacts: BMIs, the GCC mapper and the scan cache.
+    std::filesystem::path variantDir(selectedVariantDir);
+    if (std::filesystem::is_directory(variantDir / "bmi")) {
+        for (const auto& entry : std::filesystem::directory_iterator(variantDir / "bmi")) {
+            removeFile(entry.path().string());
+        }
     }
-    removeFile(config.getOutputFile());
+    removeFile((variantDir / "module.map").string());
+    removeFile((variantDir / "module_scan.txt").string());
+    moduleScanner.reset();
+    moduleMap.reset();
     
     // Clear cache file and map
     try {
         std::ofstream(cacheFilePath, std::ios::trunc).close();
         cacheMap.clear();
-        dependencyCacheTimestamps.clear();
-        if (verbosityLevel >= VerbosityLevel::Verbose) std::cout << "Cleared build cache" << std::endl;
+        manifest.clear();
+        removeFile(manifest.getPath());
+        journal.reset();
+        OREO_VERBOSE(LogCategory::General, "Cleared build cache");
     } catch (const std::exception& e) {
-        std::cerr << "Error clearing cache: " << e.what() << std::endl;
+        OREO_ERROR(LogCategory::General, "Error clearing cache: " << e.what());
         failedCount++;
     }
     
-    std::cout << "Clean complete. Removed " << removedCount << " file(s)." << std::endl;
+    OREO_INFO(LogCategory::General, "Clean complete. Removed " << removedCount << " file(s).");
     if (failedCount > 0) {
-        std::cout << "Failed to remove " << failedCount << " file(s)." << std::endl;
+        OREO_INFO(LogCategory::General, "Failed to remove " << failedCount << " file(s).");
     }
+    Logger::flush();
 }
 
 std::vector<std::string> BuildSystem::getObjectFiles() const {
     std::vector<std::string> objects;
     objects.reserve(config.getSourceFiles().size());
     for (const auto& source : config.getSourceFiles()) {
-        objects.push_back(std::filesystem::path(source).filename().replace_extension(".o").string());
+        objects.push_back(getObjectPath(source));
     }
     return objects;
 }
@@ -358,6 +2324,18 @@ std::string BuildSystem::getBuildFlags() const {
 
 void BuildSystem::setVerbosityLevel(VerbosityLevel level) {
     verbosityLevel = level;
+    switch (level) {
+        case VerbosityLevel::Quiet: Logger::setLevel(LogLevel::Warning); break;
+        case VerbosityLevel::Normal: Logger::setLevel(LogLevel::Info); break;
+        case VerbosityLevel::Verbose: Logger::setLevel(LogLevel::Verbose); break;
+        case VerbosityLevel::VeryVerbose: Logger::setLevel(LogLevel::Debug); break;
+        case VerbosityLevel::ExtremelyVerbose: Logger::setLevel(LogLevel::Trace); break;
+    }
+}
+
+void BuildSystem::configurePools() {
+    resourcePools->setDepths(config.getPools());
+    resourcePools->setMemoryBudget(config.getMemoryBudgetBytes());
 }
 
 }
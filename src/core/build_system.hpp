@@ -2,6 +2,14 @@
 #include "config.hpp"
 #include "compiler.hpp"
 #include "thread_pool.hpp"
+#include "build_manifest.hpp"
+#include "build_journal.hpp"
+#include "sharded_map.hpp"
+#include "module_scanner.hpp"
+#include "plugin_manager.hpp"
+#include "resource_pool.hpp"
+#include "include_scanner.hpp"
+#include "dependency_graph.hpp"
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -9,6 +17,7 @@
 #include <set>
 #include <fstream>
 #include <chrono>
+#include <mutex>
 
 namespace OreoBuild {
 
@@ -17,12 +26,53 @@ public:
     BuildSystem();
     ~BuildSystem();
     void loadConfig(const std::string& configFile);
-    void build(const std::string& target, std::function<void(const std::string&)> progressCallback = nullptr);
+    // Returns false when a compile or the link failed.
+    bool build(const std::string& target, std::function<void(const std::string&)> progressCallback = nullptr);
+    // Builds several variants ("debug", "release" or any declared with
+    // variant_flags[name]) in one pass. Configuration, plugin loading and the
+    // include scan happen once, and every variant's compiles and links share
+    // the thread pool, so one variant's link overlaps the others' compiles.
+    // A failure stops all of them unless -k allows more. False when any
+    // variant failed.
+    bool buildVariants(const std::vector<std::string>& variants,
+                       std::function<void(const std::string&)> progressCallback = nullptr);
+    // Profile-guided optimisation: builds an instrumented variant, runs
+    // trainCommand ("{output}" is replaced by the instrumented binary),
+    // merges the profiles and rebuilds the optimized variant with them.
+    bool pgo(const std::string& trainCommand);
     void clean(bool forceClean = false);
+    // Ranks headers by the expected rebuild cost of touching them, using the
+    // dependency graph, compile times and change history in the manifest.
+    void impact(size_t limit);
+    // Answers from the dependency graph the last build recorded:
+    // "deps <file>" lists what file depends on, "rdeps <file>" what depends
+    // on it and "path <from> <to>" an include chain leading from one to the
+    // other. Prints text, or a JSON document on stdout when json is set.
+    // False when the query is malformed or names a file the build never saw.
+    bool query(const std::string& kind, const std::vector<std::string>& files, bool json);
+    // Builds, then builds and runs the configured tests whose inputs changed
+    // since they last passed, keeping only every shardCount-th test starting
+    // at shardIndex. False when the build or a test failed.
+    bool test(size_t shardIndex = 0, size_t shardCount = 1);
+    // Runs the up-to-date analysis without building: lists every step that
+    // would run and why, and estimates the wall time from recorded step
+    // durations by simulating the schedule. False when analysis fails.
+    bool plan();
+    // Logs why each step runs during build().
+    void setExplain(bool enabled) { explain = enabled; }
+    // Number of failed compiles the build tolerates before it cancels the
+    // rest; 0 stops at the first failure.
+    void setKeepGoing(size_t failures) { keepGoing = failures; }
+    // Lists the count steps with the largest peak RSS after build(); 0 for
+    // none.
+    void setTopRss(size_t count) { topRss = count; }
     const Config& getConfig() const { return config; }
     Config& getConfig() { return config; }
     std::string getBuildFlags() const;
     int getFilesCompiled() const { return filesCompiled; }
+    std::string getVariantDir() const;
+    std::string getObjectPath(const std::string& source) const;
+    std::string getOutputPath() const;
 
     enum class VerbosityLevel {
         Quiet,
@@ -38,17 +88,121 @@ private:
     Config config;
     std::unique_ptr<Compiler> compiler;
     std::unordered_map<std::string, std::set<std::string>> dependencies;
-    std::unique_ptr<ThreadPool> threadPool;
+    // Declared before the thread pool so it outlives the workers' last tasks.
+    // Both are shared with the variants buildVariants() builds.
+    std::shared_ptr<ResourcePools> resourcePools;
+    std::shared_ptr<ThreadPool> threadPool;
     std::string cacheFilePath;
-    std::unordered_map<std::string, std::time_t> cacheMap;
-    std::unordered_map<std::string, std::time_t> dependencyCacheTimestamps;
+    std::string selectedVariantDir;
+    // Source modification time at its last successful compile.
+    ShardedMap<std::time_t> cacheMap;
+    BuildManifest manifest;
+    // Steps finished since cacheMap and the manifest were last saved.
+    BuildJournal journal;
+    std::unique_ptr<ModuleScanner> moduleScanner;
+    std::shared_ptr<ModuleMap> moduleMap;
+    std::shared_ptr<RemoteCache> remoteCache;
+    std::shared_ptr<PluginManager> pluginManager;
+    std::shared_ptr<IncludeScanner> includeScanner;
+    // Set for the variants buildVariants() builds: the scanner is shared and
+    // the interrupt handling belongs to the parent.
+    bool variantOfParent = false;
+    // Variants built together may declare the same generated files, so their
+    // plugin steps take turns.
+    std::shared_ptr<std::mutex> pluginStepMutex;
+    bool explain = false;
+    size_t keepGoing = 0;
+    size_t topRss = 0;
+    std::vector<LoadedPluginNode> pluginNodes;
+    // What the jobs of the current build used, for its summary line.
+    std::mutex usageMutex;
+    ProcessUsage buildUsage;
+    uint64_t buildJobMicros = 0;
+    std::string heaviestStep;
 
-    bool needsRebuild(const std::string& source, const std::string& object);
+    // Why source has to be recompiled ("flags changed", "dependency x.h
+    // changed", ...); empty when its object is up to date.
+    std::string rebuildReason(const std::string& source, const std::string& object);
+    // Why output has to be relinked, counting rebuiltObjects objects about to
+    // be recompiled; empty when it is up to date.
+    std::string getLinkReason(const std::vector<std::string>& objects, const std::string& output,
+                              size_t rebuiltObjects) const;
+    void resolveDependencies(const std::string& source, const std::string& object);
+    bool loadDepfile(const std::string& source, const std::string& object);
     void parseDependencies(const std::string& source);
+    // Variant of parent built alongside it; shares its pools and plugins.
+    BuildSystem(const BuildSystem& parent, const std::string& variant);
+    // The configured compiler wrapped for distribution and the remote cache.
+    std::unique_ptr<Compiler> createConfiguredCompiler() const;
     std::vector<std::string> getObjectFiles() const; 
-    void addDependency(const std::string& source, const std::string& dependency);
+    void selectVariant();
     void loadCache();
-    void saveCache();
+    bool saveCache();
+    // Saves the cache and the manifest, then empties the journal.
+    void saveState();
+    // Records a finished step in the manifest and the journal; micros 0
+    // leaves its recorded time alone, and so does usage without jobs for
+    // its recorded usage.
+    void recordStep(const std::string& output, const std::string& signature, uint64_t micros,
+                    const ProcessUsage& usage = {});
+    void recordSourceStamp(const std::string& source, std::time_t lastModified);
+    // Applies the journal left by an interrupted build.
+    void recoverJournal();
+    bool isNoOpBuild();
+    std::string computeRootFingerprint(const std::vector<std::pair<std::string, FileState>>& fileStates) const;
+    static std::string commandSignature(const std::string& command);
+    // Signature of the compile command plus any profile it reads.
+    std::string compileSignature(const std::string& source, const std::string& object) const;
+    void recordManifest(const std::vector<std::string>& objects, const std::string& output);
+    // Scans every source for module declarations and hands the resulting
+    // map to the compiler. Returns false on scan errors or duplicate modules.
+    bool scanModules(const std::vector<std::string>& sources);
+    // Adds importers of every module whose interface is being rebuilt, with
+    // the reason for each addition.
+    void addModuleImporters(std::vector<std::string>& objectsToCompile,
+                            std::unordered_map<std::string, std::string>& reasons) const;
+    // For each unit to compile, how many of its module providers must be
+    // compiled first, and who waits on whom. False on unknown modules or cycles.
+    bool orderModuleUnits(const std::vector<std::string>& objectsToCompile,
+                          std::unordered_map<std::string, size_t>& waitingOn,
+                          std::unordered_map<std::string, std::vector<std::string>>& dependents) const;
+    // Compiles sources on the thread pool, a unit only once waitingOn says
+    // its module providers are done, and reports failures. False when a
+    // compile failed or the build was cancelled.
+    bool compileUnits(const std::vector<std::string>& sources,
+                      std::unordered_map<std::string, size_t>& waitingOn,
+                      const std::unordered_map<std::string, std::vector<std::string>>& dependents,
+                      const std::function<void(const std::string&)>& progressCallback);
+    // Aggregates clang -ftime-trace output for all objects into a ranked report.
+    void reportTimeTraces(const std::vector<std::string>& objects);
+    // Logs the totals of buildUsage, when any job ran.
+    void reportUsage();
+    // Logs the topRss recorded steps with the largest peak RSS.
+    void reportTopRss();
+    // Peak RSS of the last measured run of the step producing output, as the
+    // memory estimate the pools admit it by; 0 when never measured.
+    uint64_t predictedMemory(const std::string& output) const;
+    // Runs the out-of-date plugin nodes on the thread pool, producers before
+    // consumers. False when a node failed or the nodes form a cycle.
+    bool runPluginNodes();
+    bool runPluginNode(const LoadedPluginNode& loaded, PluginHost& host);
+    // Everything that decides a node's outputs apart from its input contents.
+    static std::string pluginNodeSignature(const LoadedPluginNode& loaded);
+    // Why the node has to run; empty when its outputs are up to date.
+    std::string pluginNodeRunReason(const PluginNode& node, const std::string& signature) const;
+    std::string getTestPath(const std::string& name) const;
+    // Hash over everything a test's outcome follows from: the commands that
+    // built it, its arguments, and the contents of its sources and of every
+    // header they include. contentHashes memoizes file hashes across tests.
+    std::string testInputKey(const TestTarget& test, std::unordered_map<std::string, std::string>& contentHashes);
+    // Keeps the ThinLTO cache directory within lto_cache_size_mb.
+    void pruneLtoCache();
+    void configurePools();
+    IncludeScanner& getIncludeScanner();
+    // Macros the compile command predefines, flags and -D options included.
+    std::unordered_map<std::string, std::string> getPredefinedMacros() const;
+    std::vector<uint32_t> findIncludeChain(const DependencyGraph& graph, uint32_t from, uint32_t to);
+    void prescanIncludes(const std::vector<std::string>& sources);
     VerbosityLevel verbosityLevel;
     std::chrono::high_resolution_clock::time_point buildStartTime;
     int filesCompiled;
@@ -0,0 +1,49 @@
+#include "compiler.hpp"
+#include "logger.hpp"
+#include "process.hpp"
+#include "module_scanner.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace OreoBuild {
+
+bool Compiler::usesModules(const std::string& source) const {
+    const ModuleUnit* unit = moduleMap ? moduleMap->find(source) : nullptr;
+    return unit && unit->usesModules();
+}
+
+std::string Compiler::getTimeTracePath(const std::string& object) {
+    return std::filesystem::path(object).replace_extension(".json").string();
+}
+
+std::string Compiler::getSplitDwarfPath(const std::string& object) {
+    return std::filesystem::path(object).replace_extension(".dwo").string();
+}
+
+bool Compiler::preprocess(const std::string& source, const std::string& object, const Config& config,
+                          bool writeDepfile, std::string& preprocessed) const {
+    std::string scratchPath = object + ".ii";
+    std::string command = getPreprocessCommand(source, scratchPath, config);
+    if (writeDepfile) {
+        command += " " + getDepfileFlags(object);
+    }
+
+    int result = Process::run(command);
+    if (result != 0) {
+        OREO_ERROR(LogCategory::Compile, "Preprocessing failed with error code: " << result);
+        std::filesystem::remove(scratchPath);
+        return false;
+    }
+
+    std::ifstream file(scratchPath, std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    preprocessed = content.str();
+    file.close();
+    std::filesystem::remove(scratchPath);
+    return true;
+}
+
+}
@@ -3,17 +3,81 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <utility>
 
 namespace OreoBuild {
 
+class RemoteCache;
+struct ModuleMap;
+
 class Compiler {
 public:
     virtual ~Compiler() = default;
     virtual std::string getName() const = 0;
+    // Exact command lines run by compile()/link(); hashed to detect flag changes.
+    virtual std::string getCompileCommand(const std::string& source, const std::string& output, const Config& config) const = 0;
+    virtual std::string getLinkCommand(const std::vector<std::string>& objects, const std::string& output, const Config& config) const = 0;
+    // Preprocess-only command; its output is what gets shipped to remote workers.
+    virtual std::string getPreprocessCommand(const std::string& source, const std::string& output, const Config& config) const = 0;
+    // Flags that make the compiler write a make-style depfile next to the object.
+    virtual std::string getDepfileFlags(const std::string& object) const = 0;
+    // Flags the compile command adds on top of config.getCompilerFlags() that
+    // change the object (LTO, debug info layout). Part of remote cache keys.
+    virtual std::vector<std::string> getCodeGenFlags(const Config& config) const { return {}; }
     virtual bool compile(const std::string& source, const std::string& output, const Config& config) = 0;
     virtual bool link(const std::vector<std::string>& objects, const std::string& output, const Config& config) = 0;
+
+    // C++20 modules. The scan command writes a P1689 dependency file to
+    // scanOutput; an empty command means the driver cannot scan by itself.
+    virtual std::string getModuleScanCommand(const std::string& source, const std::string& object,
+                                             const std::string& scanOutput, const Config& config) const { return ""; }
+    virtual std::string getModuleFileExtension() const { return ".bmi"; }
+    // Tells the compiler which sources provide and import which modules and
+    // where their BMIs live. Decorators forward this to the wrapped compiler.
+    virtual void setModuleMap(std::shared_ptr<const ModuleMap> map) { moduleMap = std::move(map); }
+
+    // Profile-guided optimisation. The profile an optimized compile of object
+    // reads, empty outside the optimize phase.
+    virtual std::string getProfilePath(const std::string& object, const Config& config) const { return ""; }
+    // Removes raw profiles left by earlier training runs.
+    virtual void clearProfiles(const std::vector<std::string>& instrumentedObjects, const Config& config) const {}
+    // Turns the training run's raw profiles into the files getProfilePath()
+    // names. Pairs are (instrumented object, optimized object).
+    virtual bool mergeProfiles(const std::vector<std::pair<std::string, std::string>>& objects,
+                               const Config& config) const { return false; }
+
+    static std::string getDepfilePath(const std::string& object) { return object + ".d"; }
+    // Where clang -ftime-trace leaves the JSON trace for an object.
+    static std::string getTimeTracePath(const std::string& object);
+    // Where -gsplit-dwarf writes the debug info for an object.
+    static std::string getSplitDwarfPath(const std::string& object);
+
+    // Runs the preprocessor for source and returns its output. The scratch
+    // file lives next to object and is removed afterwards.
+    bool preprocess(const std::string& source, const std::string& object, const Config& config,
+                    bool writeDepfile, std::string& preprocessed) const;
+
+protected:
+    std::shared_ptr<const ModuleMap> moduleMap;
+
+    // True when source provides or imports a named module; such units
+    // need their BMIs and are always compiled locally.
+    bool usesModules(const std::string& source) const;
 };
 
 std::unique_ptr<Compiler> createCompiler(const std::string& name);
+std::unique_ptr<Compiler> createClangCompiler();
+
+// Wraps a local compiler and dispatches compile jobs to oreobuild-worker
+// processes at the given host:port addresses, compiling locally whenever no
+// worker can take a job. Linking always runs locally.
+std::unique_ptr<Compiler> createDistributedCompiler(std::unique_ptr<Compiler> local,
+                                                    const std::vector<std::string>& workers,
+                                                    int timeoutMs);
+
+// Serves compiles from a shared remote cache keyed by the preprocessed TU,
+// falling through to the wrapped compiler on a miss and uploading the result.
+std::unique_ptr<Compiler> createCachingCompiler(std::unique_ptr<Compiler> inner,
+                                                std::shared_ptr<RemoteCache> cache);
 
 }
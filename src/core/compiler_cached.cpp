@@ -0,0 +1,124 @@
+#include "compiler.hpp"
+#include "config.hpp"
+#include "remote_cache.hpp"
+#include "distributed_protocol.hpp"
+#include "hash.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+namespace OreoBuild {
+
+class CachingCompiler : public Compiler {
+public:
+    CachingCompiler(std::unique_ptr<Compiler> inner, std::shared_ptr<RemoteCache> cache)
+        : inner(std::move(inner)), cache(std::move(cache)) {}
+
+    std::string getName() const override { return inner->getName(); }
+
+    std::string getCompileCommand(const std::string& source, const std::string& output, const Config& config) const override {
+        return inner->getCompileCommand(source, output, config);
+    }
+
+    std::string getLinkCommand(const std::vector<std::string>& objects, const std::string& output, const Config& config) const override {
+        return inner->getLinkCommand(objects, output, config);
+    }
+
+    std::string getPreprocessCommand(const std::string& source, const std::string& output, const Config& config) const override {
+        return inner->getPreprocessCommand(source, output, config);
+    }
+
+    std::string getDepfileFlags(const std::string& object) const override {
+        return inner->getDepfileFlags(object);
+    }
+
+    std::vector<std::string> getCodeGenFlags(const Config& config) const override {
+        return inner->getCodeGenFlags(config);
+    }
+
+    std::string getModuleScanCommand(const std::string& source, const std::string& object,
+                                     const std::string& scanOutput, const Config& config) const override {
+        return inner->getModuleScanCommand(source, object, scanOutput, config);
+    }
+
+    std::string getModuleFileExtension() const override { return inner->getModuleFileExtension(); }
+
+    std::string getProfilePath(const std::string& object, const Config& config) const override {
+        return inner->getProfilePath(object, config);
+    }
+
+    void clearProfiles(const std::vector<std::string>& instrumentedObjects, const Config& config) const override {
+        inner->clearProfiles(instrumentedObjects, config);
+    }
+
+    bool mergeProfiles(const std::vector<std::pair<std::string, std::string>>& objects,
+                       const Config& config) const override {
+        return inner->mergeProfiles(objects, config);
+    }
+
+    void setModuleMap(std::shared_ptr<const ModuleMap> map) override {
+        Compiler::setModuleMap(map);
+        inner->setModuleMap(std::move(map));
+    }
+
+    bool compile(const std::string& source, const std::string& output, const Config& config) override {
+        // Module units also depend on BMIs and PGO builds on profiles, neither
+        // of which the key covers.
+        if (!cache->isAvailable() || usesModules(source) || config.getPgoPhase() != PgoPhase::None) {
+            return inner->compile(source, output, config);
+        }
+
+        std::string preprocessed;
+        if (!inner->preprocess(source, output, config, false, preprocessed)) {
+            return false;
+        }
+
+        // The key covers everything that determines the object besides its
+        // location: toolchain, code generation flags, and the expanded TU.
+        Sha256 keyHasher;
+        keyHasher.update(DistributedProtocol::toolchainFingerprint(config.getCompiler())).update("\n");
+        for (const auto& flag : config.getCompilerFlags(source)) {
+            keyHasher.update(flag).update("\n");
+        }
+        for (const auto& flag : inner->getCodeGenFlags(config)) {
+            keyHasher.update(flag).update("\n");
+        }
+        keyHasher.update(source).update("\n").update(preprocessed);
+        std::string actionKey = keyHasher.hexDigest();
+
+        std::vector<CacheOutput> outputs = {
+            {"object", output},
+            {"depfile", getDepfilePath(output)}
+        };
+        if (config.isSplitDwarfEnabled()) {
+            // The .dwo is as much an output of the compile as the object.
+            outputs.push_back({"dwo", getSplitDwarfPath(output)});
+        }
+        if (cache->fetch(actionKey, outputs)) {
+            Metrics::add(Counter::CacheHits);
+            OREO_INFO(LogCategory::Cache, "Cache hit: " << source);
+            return true;
+        }
+        Metrics::add(Counter::CacheMisses);
+
+        if (!inner->compile(source, output, config)) {
+            return false;
+        }
+        cache->storeAsync(actionKey, outputs);
+        return true;
+    }
+
+    bool link(const std::vector<std::string>& objects, const std::string& output, const Config& config) override {
+        return inner->link(objects, output, config);
+    }
+
+private:
+    std::unique_ptr<Compiler> inner;
+    std::shared_ptr<RemoteCache> cache;
+};
+
+std::unique_ptr<Compiler> createCachingCompiler(std::unique_ptr<Compiler> inner,
+                                                std::shared_ptr<RemoteCache> cache) {
+    return std::make_unique<CachingCompiler>(std::move(inner), std::move(cache));
+}
+
+}
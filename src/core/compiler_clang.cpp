@@ -0,0 +1,156 @@
+#include "compiler_gcc.hpp"
+#include "config.hpp"
+#include "logger.hpp"
+#include "process.hpp"
+#include "module_scanner.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+namespace OreoBuild {
+
+class ClangCompiler : public GCCCompiler {
+public:
+    std::string getName() const override { return "Clang"; }
+
+    std::string getCompileCommand(const std::string& source, const std::string& output, const Config& config) const override {
+        std::string command = GCCCompiler::getCompileCommand(source, output, config);
+        if (config.isTimeTraceEnabled()) {
+            // Clang writes the trace next to the object, see getTimeTracePath().
+            command += " -ftime-trace -ftime-trace-granularity=" + std::to_string(config.getTimeTraceGranularity());
+        }
+        return command;
+    }
+
+    std::string getModuleScanCommand(const std::string& source, const std::string& object,
+                                     const std::string& scanOutput, const Config& config) const override {
+        std::ostringstream command;
+        command << config.getClangScanDeps() << " -format=p1689 -- " << config.getCompiler() << " ";
+        for (const auto& flag : config.getCompilerFlags(source)) {
+            command << flag << " ";
+        }
+        for (const auto& path : config.getIncludePaths()) {
+            command << "-I" << path << " ";
+        }
+        command << (hasModuleExtension(source) ? "-x c++-module " : "")
+                << "-c " << source << " -o " << object << " > " << scanOutput << " 2>/dev/null";
+        return command.str();
+    }
+
+    std::string getModuleFileExtension() const override { return ".pcm"; }
+
+    std::string getProfilePath(const std::string& object, const Config& config) const override {
+        // One merged profile covers the whole program.
+        return config.getPgoPhase() == PgoPhase::Optimize ? getMergedProfilePath(config) : "";
+    }
+
+    void clearProfiles(const std::vector<std::string>& instrumentedObjects, const Config& config) const override {
+        std::error_code ec;
+        std::filesystem::remove_all(config.getPgoProfileDir(), ec);
+    }
+
+    bool mergeProfiles(const std::vector<std::pair<std::string, std::string>>& objects,
+                       const Config& config) const override {
+        std::string command = config.getLlvmProfdata() + " merge -o " + getMergedProfilePath(config) + " " +
+                              config.getPgoProfileDir() + "/*.profraw";
+        OREO_VERBOSE(LogCategory::General, "Merging profiles: " << command);
+        if (Process::run(command) != 0) {
+            OREO_ERROR(LogCategory::General, "Unable to merge profiles with " << config.getLlvmProfdata());
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    std::string getDebugInfoFlags(const Config& config) const override {
+        std::string flags;
+        if (config.isSplitDwarfEnabled()) {
+            flags += "-gsplit-dwarf ";
+        }
+        if (config.isGdbIndexEnabled()) {
+            flags += "-ggnu-pubnames ";
+        }
+        return flags;
+    }
+
+    std::string getDebugInfoLinkFlags(const Config& config) const override {
+        return config.isGdbIndexEnabled() ? "-fuse-ld=lld -Wl,--gdb-index " : "";
+    }
+
+    bool namesFilesAfterObject(const Config& config) const override {
+        // Profiles live in the profile directory, but the .dwo and the
+        // -ftime-trace JSON are named after the object.
+        return config.isSplitDwarfEnabled() || config.isTimeTraceEnabled();
+    }
+
+    std::string getDwpCommand(const std::string& output, const Config& config) const override {
+        std::string tool = config.getDwpTool().empty() ? "llvm-dwp" : config.getDwpTool();
+        return tool + " -e " + output + " -o " + output + ".dwp";
+    }
+
+    std::string getProfileFlags(const Config& config) const override {
+        switch (config.getPgoPhase()) {
+            case PgoPhase::Instrument:
+                return "-fprofile-generate=" + config.getPgoProfileDir() + " ";
+            case PgoPhase::Optimize:
+                return "-fprofile-use=" + getMergedProfilePath(config) + " -Wno-profile-instr-unprofiled ";
+            default:
+                return "";
+        }
+    }
+
+    std::string getLtoCompileFlags(const Config& config) const override {
+        std::string mode = config.getLtoMode();
+        return mode == "off" ? "" : "-flto=" + mode + " ";
+    }
+
+    std::string getLtoLinkFlags(const Config& config) const override {
+        std::string mode = config.getLtoMode();
+        if (mode == "off") {
+            return "";
+        }
+        // The cache and job options below are lld's; BFD ld cannot read
+        // LLVM bitcode without the gold plugin anyway.
+        std::ostringstream flags;
+        flags << "-flto=" << mode << " -fuse-ld=lld ";
+        int jobs = config.getLtoJobs();
+        if (mode == "thin") {
+            flags << "-Wl,--thinlto-cache-dir=" << config.getLtoCacheDir() << " "
+                  << "-Wl,--thinlto-cache-policy=cache_size_bytes=" << config.getLtoCacheSizeBytes() << " ";
+            if (jobs > 0) {
+                flags << "-Wl,--thinlto-jobs=" << jobs << " ";
+            }
+        } else if (jobs > 0) {
+            flags << "-Wl,--lto-partitions=" << jobs << " ";
+        }
+        return flags.str();
+    }
+
+    std::string getModuleFlags(const std::string& source) const override {
+        const ModuleUnit* unit = moduleMap ? moduleMap->find(source) : nullptr;
+        if (!unit || !unit->usesModules()) {
+            return "";
+        }
+        // BMIs are named after their module, so importers find them through
+        // the prebuilt path without one -fmodule-file per import.
+        std::string flags = "-fprebuilt-module-path=" + moduleMap->bmiDir + " ";
+        if (!unit->provides.empty()) {
+            flags += "-fmodule-output=" + moduleMap->getBmiPath(unit->provides) + " ";
+            if (std::filesystem::path(source).extension() != ".cppm") {
+                flags += "-x c++-module ";
+            }
+        }
+        return flags;
+    }
+
+private:
+    static std::string getMergedProfilePath(const Config& config) {
+        return config.getPgoProfileDir() + "/merged.profdata";
+    }
+};
+
+std::unique_ptr<Compiler> createClangCompiler() {
+    return std::make_unique<ClangCompiler>();
+}
+
+}
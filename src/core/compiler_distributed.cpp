@@ -0,0 +1,315 @@
+#include "compiler.hpp"
+#include "config.hpp"
+#include "distributed_protocol.hpp"
+#include "socket_utils.hpp"
+#include "hash.hpp"
+#include "file_utils.hpp"
+#include "logger.hpp"
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace OreoBuild {
+
+class DistributedCompiler : public Compiler {
+public:
+    DistributedCompiler(std::unique_ptr<Compiler> local, const std::vector<std::string>& addresses, int timeoutMs)
+        : local(std::move(local)), timeoutMs(timeoutMs) {
+        for (const auto& address : addresses) {
+            Worker worker;
+            if (!parseHostPort(address, worker.host, worker.port)) {
+                throw std::runtime_error("Invalid distributed worker address: " + address);
+            }
+            workers.push_back(worker);
+        }
+    }
+
+    std::string getName() const override { return local->getName(); }
+
+    std::string getCompileCommand(const std::string& source, const std::string& output, const Config& config) const override {
+        return local->getCompileCommand(source, output, config);
+    }
+
+    std::string getLinkCommand(const std::vector<std::string>& objects, const std::string& output, const Config& config) const override {
+        return local->getLinkCommand(objects, output, config);
+    }
+
+    std::string getPreprocessCommand(const std::string& source, const std::string& output, const Config& config) const override {
+        return local->getPreprocessCommand(source, output, config);
+    }
+
+    std::string getDepfileFlags(const std::string& object) const override {
+        return local->getDepfileFlags(object);
+    }
+
+    std::vector<std::string> getCodeGenFlags(const Config& config) const override {
+        return local->getCodeGenFlags(config);
+    }
+
+    std::string getModuleScanCommand(const std::string& source, const std::string& object,
+                                     const std::string& scanOutput, const Config& config) const override {
+        return local->getModuleScanCommand(source, object, scanOutput, config);
+    }
+
+    std::string getModuleFileExtension() const override { return local->getModuleFileExtension(); }
+
+    std::string getProfilePath(const std::string& object, const Config& config) const override {
+        return local->getProfilePath(object, config);
+    }
+
+    void clearProfiles(const std::vector<std::string>& instrumentedObjects, const Config& config) const override {
+        local->clearProfiles(instrumentedObjects, config);
+    }
+
+    bool mergeProfiles(const std::vector<std::pair<std::string, std::string>>& objects,
+                       const Config& config) const override {
+        return local->mergeProfiles(objects, config);
+    }
+
+    void setModuleMap(std::shared_ptr<const ModuleMap> map) override {
+        Compiler::setModuleMap(map);
+        local->setModuleMap(std::move(map));
+    }
+
+    bool compile(const std::string& source, const std::string& output, const Config& config) override {
+        if (usesModules(source) || config.isSplitDwarfEnabled() || config.getPgoPhase() != PgoPhase::None) {
+            // Workers have no access to the BMIs or profiles this unit reads,
+            // and .dwo and .gcda paths built remotely would name the
+            // worker's scratch directory.
+            return local->compile(source, output, config);
+        }
+        std::string fingerprint = DistributedProtocol::toolchainFingerprint(config.getCompiler());
+        if (fingerprint.empty() || !handshake(config.getCompiler(), fingerprint)) {
+            return local->compile(source, output, config);
+        }
+
+        RemoteCompileJob job;
+        job.compiler = config.getCompiler();
+        job.toolchainFingerprint = fingerprint;
+        job.flags = config.getCompilerFlags(source);
+        for (const auto& flag : local->getCodeGenFlags(config)) {
+            job.flags.push_back(flag);
+        }
+        for (const auto& flag : job.flags) {
+            if (!DistributedProtocol::isAllowedFlag(flag)) {
+                // Workers refuse it; asking one would only get it backed off.
+                OREO_VERBOSE(LogCategory::Distributed, "Compiling " << source << " locally: workers do not accept " << flag);
+                return local->compile(source, output, config);
+            }
+        }
+        job.sourceName = source;
+        if (!local->preprocess(source, output, config, true, job.preprocessedSource)) {
+            return false;
+        }
+
+        Hasher keyHasher;
+        keyHasher.update(job.compiler).update(job.toolchainFingerprint);
+        for (const auto& flag : job.flags) {
+            keyHasher.update(flag);
+        }
+        keyHasher.update(job.preprocessedSource);
+
+        RemoteCompileResult result = dispatchOnce(keyHasher.hexDigest(), job);
+        switch (result.status) {
+            case JobStatus::Ok:
+                if (!result.diagnostics.empty()) {
+                    OREO_WARN(LogCategory::Compile, trimTrailingNewlines(result.diagnostics));
+                }
+                return writeObject(output, result.object);
+            case JobStatus::CompileError:
+                OREO_ERROR(LogCategory::Compile, trimTrailingNewlines(result.diagnostics));
+                OREO_ERROR(LogCategory::Distributed, "Compilation failed on remote worker: " << source);
+                return false;
+            default:
+                // No worker could take the job; build it here instead.
+                return local->compile(source, output, config);
+        }
+    }
+
+    bool link(const std::vector<std::string>& objects, const std::string& output, const Config& config) override {
+        return local->link(objects, output, config);
+    }
+
+private:
+    struct Worker {
+        std::string host;
+        uint16_t port = 0;
+        uint32_t slots = 0;
+        uint32_t inFlight = 0;
+        int consecutiveFailures = 0;
+        bool compatible = false;
+        std::chrono::steady_clock::time_point retryAfter;
+    };
+
+    static const int maxConsecutiveFailures = 3;
+
+    std::unique_ptr<Compiler> local;
+    int timeoutMs;
+
+    std::mutex workersMutex;
+    std::vector<Worker> workers;
+    bool handshakeDone = false;
+
+    std::mutex inFlightMutex;
+    std::unordered_map<std::string, std::shared_future<RemoteCompileResult>> inFlightJobs;
+
+    bool handshake(const std::string& compilerName, const std::string& fingerprint) {
+        std::lock_guard<std::mutex> lock(workersMutex);
+        if (!handshakeDone) {
+            handshakeDone = true;
+            for (auto& worker : workers) {
+                HelloReply reply;
+                Socket socket = Socket::connectTo(worker.host, worker.port, timeoutMs);
+                std::string payload;
+                if (!socket.isValid() ||
+                    !socket.sendFrame(DistributedProtocol::encode(HelloRequest{compilerName, fingerprint})) ||
+                    !socket.recvFrame(payload) || !DistributedProtocol::decode(payload, reply)) {
+                    OREO_WARN(LogCategory::Distributed, "Warning: Distributed worker " << worker.host << ":" << worker.port
+                              << " is unreachable.");
+                    continue;
+                }
+                if (reply.status != JobStatus::Ok) {
+                    OREO_WARN(LogCategory::Distributed, "Warning: Distributed worker " << worker.host << ":" << worker.port
+                              << " has a different toolchain; not using it.");
+                    continue;
+                }
+                worker.compatible = true;
+                worker.slots = std::max<uint32_t>(1, reply.slots);
+            }
+        }
+        for (const auto& worker : workers) {
+            if (worker.compatible) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Identical jobs that are already in flight share the first job's result
+    // instead of being compiled a second time.
+    RemoteCompileResult dispatchOnce(const std::string& key, const RemoteCompileJob& job) {
+        std::promise<RemoteCompileResult> promise;
+        std::shared_future<RemoteCompileResult> future;
+        bool owner = false;
+        {
+            std::lock_guard<std::mutex> lock(inFlightMutex);
+            auto it = inFlightJobs.find(key);
+            if (it != inFlightJobs.end()) {
+                future = it->second;
+            } else {
+                future = promise.get_future().share();
+                inFlightJobs.emplace(key, future);
+                owner = true;
+            }
+        }
+        if (!owner) {
+            return future.get();
+        }
+
+        RemoteCompileResult result = dispatch(job);
+        promise.set_value(result);
+        std::lock_guard<std::mutex> lock(inFlightMutex);
+        inFlightJobs.erase(key);
+        return result;
+    }
+
+    RemoteCompileResult dispatch(const RemoteCompileJob& job) {
+        std::string request = DistributedProtocol::encode(job);
+        for (size_t attempt = 0; attempt < workers.size(); ++attempt) {
+            Worker* worker = acquireWorker();
+            if (!worker) {
+                break;
+            }
+
+            OREO_INFO(LogCategory::Distributed, "Compiling: " << job.sourceName << " on " << worker->host << ":" << worker->port);
+            RemoteCompileResult result;
+            std::string payload;
+            Socket socket = Socket::connectTo(worker->host, worker->port, timeoutMs);
+            bool delivered = socket.isValid() && socket.sendFrame(request) &&
+                             socket.recvFrame(payload) && DistributedProtocol::decode(payload, result);
+            releaseWorker(worker, delivered && result.status != JobStatus::InternalError,
+                          delivered && result.status == JobStatus::ToolchainMismatch);
+
+            if (delivered && (result.status == JobStatus::Ok || result.status == JobStatus::CompileError)) {
+                return result;
+            }
+            OREO_WARN(LogCategory::Distributed, "Warning: Distributed worker " << worker->host << ":" << worker->port
+                      << " failed to compile " << job.sourceName << "; retrying elsewhere.");
+        }
+        return RemoteCompileResult();
+    }
+
+    // Picks the compatible, healthy worker with the lowest load relative to its
+    // slot count. Returns nullptr when every worker is saturated or down, in
+    // which case the caller compiles locally.
+    Worker* acquireWorker() {
+        std::lock_guard<std::mutex> lock(workersMutex);
+        auto now = std::chrono::steady_clock::now();
+        Worker* best = nullptr;
+        for (auto& worker : workers) {
+            if (!worker.compatible || worker.inFlight >= worker.slots || worker.retryAfter > now) {
+                continue;
+            }
+            if (!best || worker.inFlight * best->slots < best->inFlight * worker.slots) {
+                best = &worker;
+            }
+        }
+        if (best) {
+            best->inFlight++;
+        }
+        return best;
+    }
+
+    void releaseWorker(Worker* worker, bool succeeded, bool toolchainMismatch) {
+        std::lock_guard<std::mutex> lock(workersMutex);
+        worker->inFlight--;
+        if (toolchainMismatch) {
+            worker->compatible = false;
+        } else if (succeeded) {
+            worker->consecutiveFailures = 0;
+        } else if (++worker->consecutiveFailures >= maxConsecutiveFailures) {
+            // Back off from a flaky worker for a while instead of retrying it on every job.
+            worker->retryAfter = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+            worker->consecutiveFailures = 0;
+        }
+    }
+
+    static std::string trimTrailingNewlines(std::string text) {
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+            text.pop_back();
+        }
+        return text;
+    }
+
+    static bool writeObject(const std::string& output, const std::string& object) {
+        // Renamed into place once complete, like objects compiled locally.
+        std::string scratch = FileUtils::getScratchPath(output);
+        std::ofstream file(scratch, std::ios::binary | std::ios::trunc);
+        file.write(object.data(), object.size());
+        file.close();
+        std::error_code ec;
+        if (file.fail()) {
+            OREO_ERROR(LogCategory::Distributed, "Unable to write object file: " << output);
+            std::filesystem::remove(scratch, ec);
+            return false;
+        }
+        std::filesystem::rename(scratch, output, ec);
+        if (ec) {
+            OREO_ERROR(LogCategory::Distributed, "Unable to write object file: " << output);
+            std::filesystem::remove(scratch, ec);
+            return false;
+        }
+        return true;
+    }
+};
+
+std::unique_ptr<Compiler> createDistributedCompiler(std::unique_ptr<Compiler> local,
+                                                    const std::vector<std::string>& workers,
+                                                    int timeoutMs) {
+    return std::make_unique<DistributedCompiler>(std::move(local), workers, timeoutMs);
+}
+
+}
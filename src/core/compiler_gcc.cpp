@@ -1,72 +1,329 @@
-#include "compiler.hpp"
+#include "compiler_gcc.hpp"
 #include "config.hpp"
-#include <iostream>
+#include "file_utils.hpp"
+#include "logger.hpp"
+#include "process.hpp"
+#include "module_scanner.hpp"
 #include <sstream>
 #include <cstdlib>
+#include <filesystem>
 
 namespace OreoBuild {
 
-class GCCCompiler : public Compiler {
-public:
-    std::string getName() const override { return "GCC"; }
+std::string GCCCompiler::getName() const {
+    return "GCC";
+}
 
-    bool compile(const std::string& source, const std::string& output, const Config& config) override {
-        std::ostringstream command;
-        command << config.getCompiler() << " ";
-        
-        for (const auto& flag : config.getCompilerFlags()) {
-            command << flag << " ";
-        }
-        
-        for (const auto& path : config.getIncludePaths()) {
-            command << "-I" << path << " ";
-        }
-        
-        command << "-c " << source << " -o " << output;
-
-        std::cout << "Compiling: " << source << " to " << output << std::endl;
-        std::cout << "Command: " << command.str() << std::endl;
-        
-        int result = std::system(command.str().c_str());
-        if (result != 0) {
-            std::cerr << "Compilation failed with error code: " << result << std::endl;
+std::string GCCCompiler::getCompileCommand(const std::string& source, const std::string& output, const Config& config) const {
+    std::string command = getCompilePrefix(source, config);
+    command += getDepfileFlags(output) + " ";
+    command += getModuleFlags(source);
+    command += "-c " + source + " -o " + output;
+    return command;
+}
+
+std::string GCCCompiler::getCompilePrefix(const std::string& source, const Config& config) const {
+    // The variant name covers the build type and PGO phase, the only
+    // settings that change while a config is loaded.
+    std::string key = config.getVariantName() + ":" + config.getFlagOverrideKey(source);
+    {
+        std::lock_guard<std::mutex> lock(prefixMutex);
+        auto it = compilePrefixes.find(key);
+        if (it != compilePrefixes.end()) {
+            return it->second;
         }
-        return result == 0;
     }
 
-    bool link(const std::vector<std::string>& objects, const std::string& output, const Config& config) override {
-        std::ostringstream command;
-        command << config.getCompiler() << " ";
-        
-        for (const auto& flag : config.getCompilerFlags()) {
-            command << flag << " ";
+    std::ostringstream prefix;
+    prefix << config.getCompiler() << " ";
+    
+    for (const auto& flag : config.getCompilerFlags(source)) {
+        prefix << flag << " ";
+    }
+    
+    for (const auto& path : config.getIncludePaths()) {
+        prefix << "-I" << path << " ";
+    }
+    
+    prefix << getLtoCompileFlags(config);
+    prefix << getDebugInfoFlags(config);
+    prefix << getProfileFlags(config);
+
+    std::lock_guard<std::mutex> lock(prefixMutex);
+    return compilePrefixes.emplace(key, prefix.str()).first->second;
+}
+
+std::string GCCCompiler::getModuleFlags(const std::string& source) const {
+    const ModuleUnit* unit = moduleMap ? moduleMap->find(source) : nullptr;
+    if (!unit || !unit->usesModules()) {
+        return "";
+    }
+    // The mapper file tells GCC where every module's BMI is read from and
+    // where an interface unit writes its own.
+    std::string flags = "-fmodules-ts -fmodule-mapper=" + moduleMap->mapperPath + " ";
+    if (hasModuleExtension(source)) {
+        flags += "-x c++ ";
+    }
+    return flags;
+}
+
+std::string GCCCompiler::getLtoCompileFlags(const Config& config) const {
+    return config.getLtoMode() == "off" ? "" : "-flto ";
+}
+
+std::string GCCCompiler::getLtoLinkFlags(const Config& config) const {
+    if (config.getLtoMode() == "off") {
+        return "";
+    }
+    // GCC always partitions the program (WHOPR), so full and thin are the
+    // same here. "auto" joins a make jobserver when one is passed down and
+    // otherwise runs one LTRANS job per core.
+    int jobs = config.getLtoJobs();
+    return "-flto=" + (jobs > 0 ? std::to_string(jobs) : std::string("auto")) + " ";
+}
+
+std::string GCCCompiler::getDebugInfoFlags(const Config& config) const {
+    std::string flags;
+    if (config.isSplitDwarfEnabled()) {
+        // GNU dwp and gold's --gdb-index only handle DWARF 4 split units;
+        // GCC 11 and later default to DWARF 5.
+        flags += "-gsplit-dwarf -gdwarf-4 ";
+    }
+    if (config.isGdbIndexEnabled()) {
+        flags += "-ggnu-pubnames ";
+    }
+    return flags;
+}
+
+std::string GCCCompiler::getDebugInfoLinkFlags(const Config& config) const {
+    // BFD ld cannot build a gdb index; gold can.
+    return config.isGdbIndexEnabled() ? "-fuse-ld=gold -Wl,--gdb-index " : "";
+}
+
+std::string GCCCompiler::getDwpCommand(const std::string& output, const Config& config) const {
+    std::string tool = config.getDwpTool().empty() ? "dwp" : config.getDwpTool();
+    return tool + " -e " + output + " -o " + output + ".dwp";
+}
+
+std::string GCCCompiler::getProfileFlags(const Config& config) const {
+    switch (config.getPgoPhase()) {
+        case PgoPhase::Instrument:
+            // Atomic counters keep profiles of multithreaded workloads sane.
+            return "-fprofile-generate -fprofile-update=prefer-atomic ";
+        case PgoPhase::Optimize:
+            return "-fprofile-use -fprofile-correction -Wno-missing-profile ";
+        default:
+            return "";
+    }
+}
+
+std::string GCCCompiler::getProfilePath(const std::string& object, const Config& config) const {
+    // GCC keeps one .gcda per object and looks for it next to the object.
+    if (config.getPgoPhase() != PgoPhase::Optimize) {
+        return "";
+    }
+    return std::filesystem::path(object).replace_extension(".gcda").string();
+}
+
+void GCCCompiler::clearProfiles(const std::vector<std::string>& instrumentedObjects, const Config& config) const {
+    std::error_code ec;
+    for (const auto& object : instrumentedObjects) {
+        std::filesystem::remove(std::filesystem::path(object).replace_extension(".gcda"), ec);
+    }
+}
+
+bool GCCCompiler::mergeProfiles(const std::vector<std::pair<std::string, std::string>>& objects,
+                                const Config& config) const {
+    // Counters from several runs of one binary already accumulate in the
+    // .gcda, so merging is copying each one next to its optimized object.
+    size_t profiled = 0;
+    for (const auto& [instrumented, optimized] : objects) {
+        std::filesystem::path from = std::filesystem::path(instrumented).replace_extension(".gcda");
+        std::filesystem::path to = getProfilePath(optimized, config);
+        std::error_code ec;
+        if (!std::filesystem::exists(from)) {
+            std::filesystem::remove(to, ec);
+            continue;
         }
-        
-        for (const auto& obj : objects) {
-            command << obj << " ";
+        std::filesystem::create_directories(to.parent_path(), ec);
+        if (!std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing, ec)) {
+            OREO_ERROR(LogCategory::General, "Unable to copy profile " << from.string() << ": " << ec.message());
+            return false;
         }
-        
-        command << "-o " << output << " ";
-        
-        for (const auto& lib : config.getLibraries()) {
-            command << "-l" << lib << " ";
+        profiled++;
+    }
+    OREO_INFO(LogCategory::General, "Profiles recorded for " << profiled << " of " << objects.size() << " translation unit(s)");
+    return true;
+}
+
+std::vector<std::string> GCCCompiler::getCodeGenFlags(const Config& config) const {
+    std::istringstream iss(getLtoCompileFlags(config) + getDebugInfoFlags(config) + getProfileFlags(config));
+    std::vector<std::string> flags;
+    std::string flag;
+    while (iss >> flag) {
+        flags.push_back(flag);
+    }
+    return flags;
+}
+
+bool GCCCompiler::hasModuleExtension(const std::string& source) {
+    std::string extension = std::filesystem::path(source).extension().string();
+    return extension == ".cppm" || extension == ".ixx" || extension == ".mpp" ||
+           extension == ".cxxm" || extension == ".c++m" || extension == ".ccm";
+}
+
+std::string GCCCompiler::getModuleScanCommand(const std::string& source, const std::string& object,
+                                              const std::string& scanOutput, const Config& config) const {
+    // P1689 output needs GCC 14 or later; older releases reject the flags and
+    // the scanner falls back to its textual scan.
+    std::ostringstream command;
+    command << config.getCompiler() << " ";
+    for (const auto& flag : config.getCompilerFlags(source)) {
+        command << flag << " ";
+    }
+    for (const auto& path : config.getIncludePaths()) {
+        command << "-I" << path << " ";
+    }
+    command << "-fmodules-ts -E -x c++ " << source
+            << " -MD -MF " << scanOutput << ".d -MT " << scanOutput
+            << " -fdeps-format=p1689r5 -fdeps-file=" << scanOutput << " -fdeps-target=" << object
+            << " -o /dev/null 2>/dev/null && rm -f " << scanOutput << ".d";
+    return command.str();
+}
+
+std::string GCCCompiler::getPreprocessCommand(const std::string& source, const std::string& output, const Config& config) const {
+    std::ostringstream command;
+    command << config.getCompiler() << " ";
+
+    for (const auto& flag : config.getCompilerFlags(source)) {
+        command << flag << " ";
+    }
+
+    for (const auto& path : config.getIncludePaths()) {
+        command << "-I" << path << " ";
+    }
+
+    command << "-E " << source << " -o " << output;
+    return command.str();
+}
+
+std::string GCCCompiler::getDepfileFlags(const std::string& object) const {
+    return "-MMD -MF " + getDepfilePath(object) + " -MT " + object;
+}
+
+bool GCCCompiler::namesFilesAfterObject(const Config& config) const {
+    return config.isSplitDwarfEnabled() || config.getPgoPhase() != PgoPhase::None;
+}
+
+std::string GCCCompiler::redirectOutput(const std::string& command, const std::string& output) {
+    std::string flag = " -o " + output;
+    size_t position = command.rfind(flag);
+    if (position == std::string::npos) {
+        return command;
+    }
+    return command.substr(0, position) + " -o " + FileUtils::getScratchPath(output) +
+           command.substr(position + flag.size());
+}
+
+bool GCCCompiler::compile(const std::string& source, const std::string& output, const Config& config) {
+    std::string command = getCompileCommand(source, output, config);
+    // The object appears under its real name only once complete, so a killed
+    // compiler cannot leave a truncated object that looks up to date.
+    bool scratch = !namesFilesAfterObject(config);
+    if (scratch) {
+        command = redirectOutput(command, output);
+    }
+
+    OREO_INFO(LogCategory::Compile, "Compiling: " << source << " to " << output);
+    OREO_VERBOSE(LogCategory::Compile, "Command: " << command);
+    
+    int result = Process::run(command);
+    if (result != 0 && !Process::isCancelled()) {
+        OREO_ERROR(LogCategory::Compile, "Compilation failed with error code: " << result);
+    }
+    if (scratch) {
+        std::error_code ec;
+        if (result == 0) {
+            std::filesystem::rename(FileUtils::getScratchPath(output), output, ec);
+            if (ec) {
+                OREO_ERROR(LogCategory::Compile, "Unable to move object into place: " << output << ": " << ec.message());
+                result = -1;
+            }
         }
+        std::filesystem::remove(FileUtils::getScratchPath(output), ec);
+    }
+    return result == 0;
+}
+
+std::string GCCCompiler::getLinkCommand(const std::vector<std::string>& objects, const std::string& output, const Config& config) const {
+    std::ostringstream command;
+    command << config.getCompiler() << " ";
+    
+    for (const auto& flag : config.getCompilerFlags()) {
+        command << flag << " ";
+    }
+    
+    command << getLtoLinkFlags(config);
+    command << getDebugInfoLinkFlags(config);
+    command << getProfileFlags(config);
+
+    for (const auto& obj : objects) {
+        command << obj << " ";
+    }
+    
+    command << "-o " << output << " ";
+    
+    for (const auto& lib : config.getLibraries()) {
+        command << "-l" << lib << " ";
+    }
+
+    command << "-lstdc++ ";
+    return command.str();
+}
+
+bool GCCCompiler::link(const std::vector<std::string>& objects, const std::string& output, const Config& config) {
+    // Like objects, the output is linked under a scratch name and renamed.
+    std::string command = redirectOutput(getLinkCommand(objects, output, config), output);
+    std::string scratch = FileUtils::getScratchPath(output);
 
-        command << "-lstdc++ ";
+    OREO_INFO(LogCategory::Link, "Linking: " << output);
+    OREO_VERBOSE(LogCategory::Link, "Command: " << command);
+    
+    int result = Process::run(command);
+    std::error_code ec;
+    if (result != 0) {
+        if (!Process::isCancelled()) {
+            OREO_ERROR(LogCategory::Link, "Linking failed with error code: " << result);
+        }
+        std::filesystem::remove(scratch, ec);
+        return false;
+    }
+    std::filesystem::rename(scratch, output, ec);
+    if (ec) {
+        OREO_ERROR(LogCategory::Link, "Unable to move output into place: " << output << ": " << ec.message());
+        std::filesystem::remove(scratch, ec);
+        return false;
+    }
 
-        std::cout << "Linking: " << output << std::endl;
-        std::cout << "Command: " << command.str() << std::endl;
-        
-        int result = std::system(command.str().c_str());
-        if (result != 0) {
-            std::cerr << "Linking failed with error code: " << result << std::endl;
+    if (config.isDwpEnabled()) {
+        std::string dwpCommand = getDwpCommand(output, config);
+        OREO_VERBOSE(LogCategory::Link, "Packaging debug info: " << dwpCommand);
+        if (Process::run(dwpCommand) != 0) {
+            OREO_WARN(LogCategory::Link, "Warning: Unable to package split debug info into " << output << ".dwp");
         }
-        return result == 0;
     }
-};
+    return true;
+}
 
 std::unique_ptr<Compiler> createCompiler(const std::string& name) {
-    if (name == "gcc" || name == "g++") {
+    // Match on the driver's file name so that paths, target prefixes and
+    // version suffixes (/usr/bin/clang++-17, x86_64-linux-gnu-g++) work.
+    std::string driver = std::filesystem::path(name).filename().string();
+    if (driver.find("clang") != std::string::npos) {
+        return createClangCompiler();
+    }
+    if (driver == "gcc" || driver == "g++" || driver == "cc" || driver == "c++" ||
+        driver.find("gcc") != std::string::npos || driver.find("g++") != std::string::npos) {
         return std::make_unique<GCCCompiler>();
     }
     throw std::runtime_error("Unsupported compiler: " + name);
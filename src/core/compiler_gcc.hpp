@@ -0,0 +1,59 @@
+#pragma once
+#include "compiler.hpp"
+#include <mutex>
+#include <unordered_map>
+
+namespace OreoBuild {
+
+// GCC-compatible driver. Other drivers that accept the same command line
+// (Clang) derive from this and only add their own flags.
+class GCCCompiler : public Compiler {
+public:
+    std::string getName() const override;
+    std::string getCompileCommand(const std::string& source, const std::string& output, const Config& config) const override;
+    std::string getLinkCommand(const std::vector<std::string>& objects, const std::string& output, const Config& config) const override;
+    std::string getPreprocessCommand(const std::string& source, const std::string& output, const Config& config) const override;
+    std::string getDepfileFlags(const std::string& object) const override;
+    std::vector<std::string> getCodeGenFlags(const Config& config) const override;
+    bool compile(const std::string& source, const std::string& output, const Config& config) override;
+    bool link(const std::vector<std::string>& objects, const std::string& output, const Config& config) override;
+    std::string getModuleScanCommand(const std::string& source, const std::string& object,
+                                     const std::string& scanOutput, const Config& config) const override;
+    std::string getModuleFileExtension() const override { return ".gcm"; }
+    std::string getProfilePath(const std::string& object, const Config& config) const override;
+    void clearProfiles(const std::vector<std::string>& instrumentedObjects, const Config& config) const override;
+    bool mergeProfiles(const std::vector<std::pair<std::string, std::string>>& objects,
+                       const Config& config) const override;
+
+protected:
+    // Flags placed before "-c <source>" for units that use modules.
+    virtual std::string getModuleFlags(const std::string& source) const;
+    // .cppm, .ixx and friends, which drivers do not recognise as C++ by default.
+    static bool hasModuleExtension(const std::string& source);
+    // LTO flags for the compile and link commands; empty when LTO is off.
+    virtual std::string getLtoCompileFlags(const Config& config) const;
+    virtual std::string getLtoLinkFlags(const Config& config) const;
+    // Split DWARF and gdb-index flags for the compile and link commands.
+    virtual std::string getDebugInfoFlags(const Config& config) const;
+    virtual std::string getDebugInfoLinkFlags(const Config& config) const;
+    // Instrumentation or profile-use flags for the current PGO phase.
+    virtual std::string getProfileFlags(const Config& config) const;
+    // Compiler, flags, include paths and code generation options: everything
+    // in the compile command before the per-unit depfile, module and file
+    // arguments. Built once per variant and set of flag overrides and shared
+    // by every unit with the same flags.
+    std::string getCompilePrefix(const std::string& source, const Config& config) const;
+    // Packages the split DWARF of output into output.dwp.
+    virtual std::string getDwpCommand(const std::string& output, const Config& config) const;
+    // True when the compile derives other file names from the object path
+    // (.dwo, .gcda), so the object cannot be written under a scratch name.
+    virtual bool namesFilesAfterObject(const Config& config) const;
+    // command with "-o output" pointed at the scratch path instead.
+    static std::string redirectOutput(const std::string& command, const std::string& output);
+
+private:
+    mutable std::mutex prefixMutex;
+    mutable std::unordered_map<std::string, std::string> compilePrefixes;
+};
+
+}
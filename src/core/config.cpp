@@ -1,9 +1,14 @@
 #include "config.hpp"
+#include "logger.hpp"
+#include "hash.hpp"
+#include "build_description.hpp"
 #include <fstream>
-#include <iostream>
 #include <sstream>
 #include <filesystem>
 #include <algorithm>
+#include <limits>
+#include <fnmatch.h>
+#include <unistd.h>
 
 namespace OreoBuild {
 
@@ -29,22 +34,29 @@ void Config::initializeSystemIncludePaths() {
 void Config::loadFromFile(const std::string& filename) {
     lastLoadedConfigFile = filename;
     std::filesystem::path fullPath = std::filesystem::absolute(filename);
-    std::cout << "Loading config file: " << fullPath << std::endl;
+    OREO_INFO(LogCategory::Config, "Loading config file: " << fullPath);
 
-    std::ifstream file(fullPath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Unable to open config file: " + fullPath.string());
-    }
+    if (BuildDescription::isDescription(filename)) {
+        for (const auto& [key, value] : BuildDescription::evaluate(filename)) {
+            set(trim(key), trim(value));
+            OREO_INFO(LogCategory::Config, "Config: " << trim(key) << " = " << trim(value));
+        }
+    } else {
+        std::ifstream file(fullPath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to open config file: " + fullPath.string());
+        }
 
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string key, value;
-        if (std::getline(iss, key, '=') && std::getline(iss, value)) {
-            key = trim(key);
-            value = trim(value);
-            set(key, value);
-            std::cout << "Config: " << key << " = " << value << std::endl;
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream iss(line);
+            std::string key, value;
+            if (std::getline(iss, key, '=') && std::getline(iss, value)) {
+                key = trim(key);
+                value = trim(value);
+                set(key, value);
+                OREO_INFO(LogCategory::Config, "Config: " << key << " = " << value);
+            }
         }
     }
 
@@ -53,14 +65,66 @@ void Config::loadFromFile(const std::string& filename) {
     if (!debugValue.empty()) {
         BuildType fileConfigBuildType = (debugValue == "true" ? BuildType::Debug : BuildType::Release);
         if (buildType != fileConfigBuildType) {
-            std::cout << "Note: Build type in config file differs from saved build type. Using saved build type: "
-                      << (buildType == BuildType::Debug ? "Debug" : "Release") << std::endl;
+            OREO_INFO(LogCategory::Config, "Note: Build type in config file differs from saved build type. Using saved build type: "
+                      << (buildType == BuildType::Debug ? "Debug" : "Release"));
         }
     }
 
     // Load debug and release flags
     debugFlags = get("debug_flags", "-g -O0 -Wall -Wextra");
     releaseFlags = get("release_flags", "-O2 -DNDEBUG -march=native");
+
+    flagOverrides.clear();
+    for (const auto& [key, value] : configEntries) {
+        size_t open = key.find('[');
+        if (open == std::string::npos || key.back() != ']') {
+            continue;
+        }
+        std::string kind = key.substr(0, open);
+        FlagOverride rule;
+        rule.pattern = trim(key.substr(open + 1, key.size() - open - 2));
+        if (kind == "debug_flags" || kind == "release_flags") {
+            rule.restricted = true;
+            rule.buildType = kind == "debug_flags" ? BuildType::Debug : BuildType::Release;
+        } else if (kind != "flags") {
+            continue;
+        }
+        if (rule.pattern.empty()) {
+            throw std::runtime_error("Flag override " + key + " has no glob");
+        }
+        std::istringstream iss(value);
+        std::string flag;
+        while (iss >> flag) {
+            rule.flags.push_back(flag);
+        }
+        flagOverrides.push_back(std::move(rule));
+    }
+}
+
+void Config::selectVariant(const std::string& name) {
+    variantFlags.clear();
+    if (name == "debug" || name == "release") {
+        variant.clear();
+        buildType = name == "debug" ? BuildType::Debug : BuildType::Release;
+        return;
+    }
+    std::string flags = get("variant_flags[" + name + "]");
+    std::string type = get("variant_build_type[" + name + "]");
+    if (name.empty() || (flags.empty() && type.empty())) {
+        throw std::runtime_error("Unknown variant '" + name + "' (declare it with variant_flags[" + name + "])");
+    }
+    if (type.empty()) {
+        type = "debug";
+    } else if (type != "debug" && type != "release") {
+        throw std::runtime_error("variant_build_type[" + name + "] must be debug or release");
+    }
+    variant = name;
+    buildType = type == "debug" ? BuildType::Debug : BuildType::Release;
+    std::istringstream iss(flags);
+    std::string flag;
+    while (iss >> flag) {
+        variantFlags.push_back(flag);
+    }
 }
 
 void Config::setBuildType(BuildType type) {
@@ -70,6 +134,11 @@ void Config::setBuildType(BuildType type) {
     // Update the config file
     set("debug", (type == BuildType::Debug) ? "true" : "false");
     
+    // A C++ build description is source code; build_type.txt is enough.
+    if (BuildDescription::isDescription(lastLoadedConfigFile)) {
+        return;
+    }
+
     // Save the updated config to file
     std::ofstream configFile(lastLoadedConfigFile);
     if (configFile.is_open()) {
@@ -77,7 +146,7 @@ void Config::setBuildType(BuildType type) {
             configFile << entry.first << " = " << entry.second << std::endl;
         }
     } else {
-        std::cerr << "Warning: Unable to update config file." << std::endl;
+        OREO_WARN(LogCategory::Config, "Warning: Unable to update config file.");
     }
 }
 
@@ -86,7 +155,7 @@ void Config::saveBuildType() const {
     if (file.is_open()) {
         file << (buildType == BuildType::Debug ? "Debug" : "Release");
     } else {
-        std::cerr << "Warning: Unable to save build type to file: " << buildTypeFile << std::endl;
+        OREO_WARN(LogCategory::Config, "Warning: Unable to save build type to file: " << buildTypeFile);
     }
 }
 
@@ -97,7 +166,7 @@ void Config::loadBuildType() {
         file >> type;
         buildType = (type == "Debug" ? BuildType::Debug : BuildType::Release);
     } else {
-        std::cout << "No saved build type found. Using default (Debug)." << std::endl;
+        OREO_INFO(LogCategory::Config, "No saved build type found. Using default (Debug).");
     }
 }
 
@@ -136,7 +205,7 @@ std::vector<std::string> Config::getList(const std::string& key, bool allowEmpty
 
 std::vector<std::string> Config::getCompilerFlags() const {
     std::vector<std::string> flags;
-    flags.push_back("-std=c++17");  // Always use C++17
+    flags.push_back(areModulesEnabled() ? "-std=c++20" : "-std=c++17");
     
     std::string flagsStr = (buildType == BuildType::Debug) ? debugFlags : releaseFlags;
     std::istringstream iss(flagsStr);
@@ -146,9 +215,35 @@ std::vector<std::string> Config::getCompilerFlags() const {
             flags.push_back(flag);
         }
     }
+    flags.insert(flags.end(), variantFlags.begin(), variantFlags.end());
     return flags;
 }
 
+std::vector<std::string> Config::getCompilerFlags(const std::string& source) const {
+    std::vector<std::string> flags = getCompilerFlags();
+    for (const auto& rule : flagOverrides) {
+        if (appliesTo(rule, source)) {
+            flags.insert(flags.end(), rule.flags.begin(), rule.flags.end());
+        }
+    }
+    return flags;
+}
+
+std::string Config::getFlagOverrideKey(const std::string& source) const {
+    std::string key;
+    for (size_t i = 0; i < flagOverrides.size(); ++i) {
+        if (appliesTo(flagOverrides[i], source)) {
+            key += std::to_string(i) + ",";
+        }
+    }
+    return key;
+}
+
+bool Config::appliesTo(const FlagOverride& rule, const std::string& source) const {
+    return (!rule.restricted || rule.buildType == buildType) &&
+           fnmatch(rule.pattern.c_str(), source.c_str(), 0) == 0;
+}
+
 std::string Config::getCompiler() const {
     std::string compiler = get("compiler");
     if (compiler == "gcc") {
@@ -165,4 +260,159 @@ std::string Config::getReleaseFlags() const {
     return releaseFlags;
 }
 
+int Config::getJobs() const {
+    std::string value = get("jobs");
+    return value.empty() ? 0 : std::max(1, std::stoi(value));
+}
+
+int Config::getDistributedTimeoutMs() const {
+    return std::stoi(get("distributed_timeout_ms", "120000"));
+}
+
+int Config::getRemoteCacheTimeoutMs() const {
+    return std::stoi(get("remote_cache_timeout_ms", "5000"));
+}
+
+int Config::getTimeTraceGranularity() const {
+    return std::max(0, std::stoi(get("time_trace_granularity", "500")));
+}
+
+std::string Config::getLtoMode() const {
+    std::string mode = get("lto", "off");
+    if (buildType == BuildType::Debug || mode == "off" || mode == "false") {
+        return "off";
+    }
+    if (mode == "true") {
+        return "thin";
+    }
+    if (mode != "full" && mode != "thin") {
+        throw std::runtime_error("Invalid lto mode: " + mode + " (expected off, full or thin)");
+    }
+    return mode;
+}
+
+int Config::getLtoJobs() const {
+    std::string value = get("lto_jobs");
+    if (value.empty()) {
+        // Follow an explicit local job count, but not one that was sized for
+        // distributed workers: LTRANS always runs on this machine.
+        return getDistributedWorkers().empty() ? getJobs() : 0;
+    }
+    return std::max(0, std::stoi(value));
+}
+
+std::string Config::getLtoCacheDir() const {
+    return get("lto_cache_dir", getBuildDir() + "/" + getVariantName() + "/lto_cache");
+}
+
+uint64_t Config::getLtoCacheSizeBytes() const {
+    return static_cast<uint64_t>(std::max(0, std::stoi(get("lto_cache_size_mb", "1024")))) * 1024 * 1024;
+}
+
+std::map<std::string, int> Config::getPools() const {
+    std::map<std::string, int> pools;
+    for (const auto& entry : getList("pools", true)) {
+        size_t colon = entry.rfind(':');
+        int depth = colon == std::string::npos ? 0 : std::atoi(entry.c_str() + colon + 1);
+        if (depth < 1) {
+            throw std::runtime_error("Invalid pool '" + entry + "' (expected name:depth with depth >= 1)");
+        }
+        pools[trim(entry.substr(0, colon))] = depth;
+    }
+    std::vector<std::string> referenced = {getLinkPool(), getTestPool()};
+    for (const auto& entry : getList("source_pools", true)) {
+        referenced.push_back(trim(entry.substr(entry.rfind(':') + 1)));
+    }
+    for (const auto& pool : referenced) {
+        if (!pool.empty() && pools.count(pool) == 0) {
+            throw std::runtime_error("Pool '" + pool + "' is used but not declared in pools");
+        }
+    }
+    return pools;
+}
+
+std::string Config::getSourcePool(const std::string& source) const {
+    for (const auto& entry : getList("source_pools", true)) {
+        size_t colon = entry.rfind(':');
+        if (colon != std::string::npos && fnmatch(trim(entry.substr(0, colon)).c_str(), source.c_str(), 0) == 0) {
+            return trim(entry.substr(colon + 1));
+        }
+    }
+    return "";
+}
+
+uint64_t Config::getMemoryBudgetBytes() const {
+    std::string value = get("memory_budget_mb");
+    if (!value.empty()) {
+        return static_cast<uint64_t>(std::max(0, std::stoi(value))) * 1024 * 1024;
+    }
+    // MemAvailable counts reclaimable page cache, which free memory does not.
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    uint64_t kilobytes = 0;
+    while (meminfo >> key >> kilobytes) {
+        if (key == "MemAvailable:") {
+            return kilobytes * 1024;
+        }
+        meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pages > 0 && pageSize > 0 ? static_cast<uint64_t>(pages) * pageSize : 0;
+}
+
+std::vector<TestTarget> Config::getTests() const {
+    std::vector<TestTarget> tests;
+    int defaultTimeout = std::stoi(get("test_timeout", "60"));
+    for (const auto& entry : getList("tests", true)) {
+        if (entry.empty()) {
+            continue;
+        }
+        size_t colon = entry.find(':');
+        TestTarget test;
+        test.name = trim(entry.substr(0, colon));
+        if (colon != std::string::npos) {
+            std::istringstream iss(entry.substr(colon + 1));
+            std::string source;
+            while (iss >> source) {
+                test.sources.push_back(source);
+            }
+        }
+        if (test.name.empty() || test.sources.empty() ||
+            test.name.find_first_of("/ \t\r\n\v\f") != std::string::npos) {
+            throw std::runtime_error("Invalid test '" + entry + "' (expected name: source...)");
+        }
+        test.args = get("test_args[" + test.name + "]");
+        test.timeoutSeconds = std::stoi(get("test_timeout[" + test.name + "]", std::to_string(defaultTimeout)));
+        tests.push_back(std::move(test));
+    }
+    return tests;
+}
+
+std::string Config::getVariantName() const {
+    std::string name = !variant.empty() ? variant : buildType == BuildType::Debug ? "debug" : "release";
+    switch (pgoPhase) {
+        case PgoPhase::Instrument: return name + "-pgo-instrumented";
+        case PgoPhase::Optimize: return name + "-pgo";
+        default: return name;
+    }
+}
+
+std::string Config::getPgoProfileDir() const {
+    std::string name = buildType == BuildType::Debug ? "debug" : "release";
+    return getBuildDir() + "/" + name + "-pgo-instrumented/profiles";
+}
+
+std::string Config::getFingerprint() const {
+    Hasher hasher;
+    for (const auto& entry : configEntries) {
+        hasher.update(entry.first).update(entry.second);
+    }
+    hasher.update(static_cast<uint64_t>(buildType));
+    hasher.update(static_cast<uint64_t>(pgoPhase));
+    hasher.update(variant);
+    hasher.update(debugFlags).update(releaseFlags);
+    return hasher.hexDigest();
+}
+
 }
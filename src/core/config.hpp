@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <map>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -10,6 +12,23 @@ enum class BuildType {
     Release
 };
 
+// Stage of the pgo command; each one builds into its own variant directory.
+enum class PgoPhase {
+    None,
+    Instrument,
+    Optimize
+};
+
+// A test binary built from its own sources and run by the test command.
+struct TestTarget {
+    std::string name;
+    std::vector<std::string> sources;
+    // Appended to the command line, from "test_args[name]".
+    std::string args;
+    // From "test_timeout[name]", else "test_timeout" (60 s by default).
+    int timeoutSeconds = 60;
+};
+
 class Config {
 public:
     Config();
@@ -22,16 +41,94 @@ public:
     std::string getCompiler() const;
     std::vector<std::string> getSourceFiles() const { return getList("sources"); }
     std::string getOutputFile() const { return get("output", "a.out"); }
+    std::string getBuildDir() const { return get("build_dir", "build"); }
+    std::string getVariantName() const;
     std::vector<std::string> getIncludePaths() const { return getList("include_paths"); }
     std::vector<std::string> getSystemIncludePaths() const { return systemIncludePaths; }
     std::vector<std::string> getLibraries() const { return getList("libraries", true); }
+    // Number of parallel compile jobs; 0 when not set in the config.
+    int getJobs() const;
+    std::vector<std::string> getDistributedWorkers() const { return getList("distributed_workers", true); }
+    int getDistributedTimeoutMs() const;
+    std::string getRemoteCacheUrl() const { return get("remote_cache"); }
+    bool isRemoteCacheReadOnly() const { return get("remote_cache_read_only") == "true"; }
+    int getRemoteCacheTimeoutMs() const;
+    // Clang -ftime-trace collection; granularity is in microseconds.
+    bool isTimeTraceEnabled() const { return get("time_trace") == "true"; }
+    int getTimeTraceGranularity() const;
+    // C++20 modules: switches to -std=c++20 and orders module units first.
+    bool areModulesEnabled() const { return get("modules") == "true"; }
+    // "compiler" (P1689 scan by the driver, the default) or "builtin".
+    std::string getModuleScanner() const { return get("module_scanner", "compiler"); }
+    // Named resource pools and their depths, "pools = link:2, codegen:4".
+    // Throws when link_pool, test_pool or source_pools names an undeclared
+    // pool.
+    std::map<std::string, int> getPools() const;
+    // Pool the link step runs in; empty for none.
+    std::string getLinkPool() const { return get("link_pool"); }
+    // Pool test runs go through; empty for none.
+    std::string getTestPool() const { return get("test_pool"); }
+    // Pool of the first "source_pools" entry (glob:pool) matching source.
+    std::string getSourcePool(const std::string& source) const;
+    // Memory the running jobs may use together, judged by each job's peak
+    // RSS from the last build. "memory_budget_mb"; 0 turns the bound off.
+    // Defaults to the memory available when the build starts.
+    uint64_t getMemoryBudgetBytes() const;
+    // "tests = name: a_test.cpp util.cpp, other: other_test.cpp", each test
+    // listing every source linked into it. Throws on a malformed entry.
+    std::vector<TestTarget> getTests() const;
+    // Build-step plugin libraries, loaded with dlopen.
+    std::vector<std::string> getPlugins() const { return getList("plugins", true); }
+    // Raw config entry, empty when not set; lets plugins read their own keys.
+    std::string getValue(const std::string& key) const { return get(key); }
+    std::string getClangScanDeps() const { return get("clang_scan_deps", "clang-scan-deps"); }
+    // Link-time optimisation: "off", "full" or "thin" ("true" means thin).
+    // Release builds only; debug builds always return "off".
+    std::string getLtoMode() const;
+    // Parallel LTRANS/ThinLTO backend jobs; 0 leaves it to the toolchain.
+    // Defaults to "jobs" when the build is not distributed.
+    int getLtoJobs() const;
+    // ThinLTO cache, kept below getLtoCacheSizeBytes() after every link.
+    std::string getLtoCacheDir() const;
+    uint64_t getLtoCacheSizeBytes() const;
+    // Split DWARF for debug builds: each object's debug info goes to a .dwo
+    // next to it, so links only move the skeleton units.
+    bool isSplitDwarfEnabled() const { return buildType == BuildType::Debug && get("split_dwarf") == "true"; }
+    // Packages the .dwo files into <output>.dwp after every link.
+    bool isDwpEnabled() const { return isSplitDwarfEnabled() && get("dwp") == "true"; }
+    // Empty means the compiler's usual tool (dwp for GCC, llvm-dwp for Clang).
+    std::string getDwpTool() const { return get("dwp_tool"); }
+    // Prebuilt .gdb_index section so gdb does not index symbols on startup.
+    bool isGdbIndexEnabled() const { return buildType == BuildType::Debug && get("gdb_index") == "true"; }
     bool isDebug() const { return buildType == BuildType::Debug; }
     BuildType getBuildType() const { return buildType; }
+    PgoPhase getPgoPhase() const { return pgoPhase; }
+    void setPgoPhase(PgoPhase phase) { pgoPhase = phase; }
+    // Where the instrumented binary leaves its raw profiles.
+    std::string getPgoProfileDir() const;
+    std::string getLlvmProfdata() const { return get("llvm_profdata", "llvm-profdata"); }
     void setBuildType(BuildType type);
+    // Switches this copy of the config to a named variant without saving it
+    // as the default: "debug", "release", or a name declared with
+    // "variant_flags[name]" (extra compile and link flags) and optionally
+    // "variant_build_type[name]" (debug, the default, or release). Throws on
+    // an unknown name.
+    void selectVariant(const std::string& name);
     std::vector<std::string> getCompilerFlags() const;
+    // getCompilerFlags() followed by the flags of every override matching
+    // source, in config order: "flags[glob] = ..." for both build types,
+    // "debug_flags[glob]" and "release_flags[glob]" for one. Globs use
+    // fnmatch without FNM_PATHNAME, so "gen/*" covers a whole directory.
+    std::vector<std::string> getCompilerFlags(const std::string& source) const;
+    // Names the overrides that apply to source; sources with equal keys get
+    // equal flags. Empty when none applies.
+    std::string getFlagOverrideKey(const std::string& source) const;
     std::string getDebugFlags() const;
     std::string getReleaseFlags() const;
 
+    // Hash over every config entry and the effective build type.
+    std::string getFingerprint() const;
+
     void saveBuildType() const;
     void loadBuildType();
 
@@ -39,8 +136,22 @@ private:
     std::vector<std::pair<std::string, std::string>> configEntries;
     std::vector<std::string> systemIncludePaths;
     BuildType buildType;
+    PgoPhase pgoPhase = PgoPhase::None;
+    // Named variant from selectVariant(); empty for the plain build type.
+    std::string variant;
+    std::vector<std::string> variantFlags;
     std::string debugFlags;
     std::string releaseFlags;
+
+    struct FlagOverride {
+        std::string pattern;
+        std::vector<std::string> flags;
+        // Applies to every build type when false.
+        bool restricted = false;
+        BuildType buildType = BuildType::Debug;
+    };
+    std::vector<FlagOverride> flagOverrides;
+    bool appliesTo(const FlagOverride& rule, const std::string& source) const;
     std::string lastLoadedConfigFile;
     
     std::string get(const std::string& key, const std::string& defaultValue = "") const;
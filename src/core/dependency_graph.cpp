@@ -0,0 +1,115 @@
+#include "dependency_graph.hpp"
+#include <algorithm>
+#include <filesystem>
+
+namespace OreoBuild {
+
+DependencyGraph::DependencyGraph(const BuildManifest& manifest) {
+    const auto& files = manifest.getFileStates();
+    const auto& edges = manifest.getDependencyEdges();
+    const uint32_t nodeCount = static_cast<uint32_t>(files.size());
+
+    names.reserve(nodeCount);
+    indices.reserve(nodeCount * 2);
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        names.push_back(files[i].first);
+        indices.emplace(files[i].first, i);
+    }
+    forward = index(nodeCount, edges, false);
+    reverse = index(nodeCount, edges, true);
+}
+
+DependencyGraph::Adjacency DependencyGraph::index(uint32_t nodeCount,
+                                                  const std::vector<std::pair<uint32_t, uint32_t>>& edges,
+                                                  bool reversed) {
+    Adjacency adjacency;
+    // Counting sort by source node, so the manifest's edge order does not
+    // matter.
+    adjacency.offsets.assign(nodeCount + 1, 0);
+    for (const auto& [from, to] : edges) {
+        if (from < nodeCount && to < nodeCount) {
+            adjacency.offsets[(reversed ? to : from) + 1]++;
+        }
+    }
+    for (uint32_t i = 0; i < nodeCount; ++i) {
+        adjacency.offsets[i + 1] += adjacency.offsets[i];
+    }
+    // fill tracks the next free slot of each node.
+    adjacency.targets.resize(adjacency.offsets[nodeCount]);
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for (const auto& [from, to] : edges) {
+        if (from < nodeCount && to < nodeCount) {
+            adjacency.targets[fill[reversed ? to : from]++] = reversed ? from : to;
+        }
+    }
+    return adjacency;
+}
+
+bool DependencyGraph::find(const std::string& path, uint32_t& node) const {
+    auto it = indices.find(path);
+    if (it != indices.end()) {
+        node = it->second;
+        return true;
+    }
+    // An exact match always wins; normalized spellings are only a fallback,
+    // and most walks never need them.
+    std::call_once(normalizedOnce, [this] {
+        normalizedIndices.reserve(names.size());
+        for (uint32_t i = 0; i < names.size(); ++i) {
+            normalizedIndices.emplace(std::filesystem::path(names[i]).lexically_normal().string(), i);
+        }
+    });
+    std::string normalized = std::filesystem::path(path).lexically_normal().string();
+    it = indices.find(normalized);
+    if (it != indices.end()) {
+        node = it->second;
+        return true;
+    }
+    auto normalizedIt = normalizedIndices.find(normalized);
+    if (normalizedIt == normalizedIndices.end()) {
+        return false;
+    }
+    node = normalizedIt->second;
+    return true;
+}
+
+std::vector<uint32_t> DependencyGraph::reach(const Adjacency& adjacency, uint32_t node) const {
+    std::vector<bool> visited(names.size(), false);
+    std::vector<uint32_t> reached;
+    std::vector<uint32_t> stack = {node};
+    visited[node] = true;
+    while (!stack.empty()) {
+        uint32_t current = stack.back();
+        stack.pop_back();
+        for (uint32_t e = adjacency.offsets[current]; e < adjacency.offsets[current + 1]; ++e) {
+            uint32_t target = adjacency.targets[e];
+            if (!visited[target]) {
+                visited[target] = true;
+                reached.push_back(target);
+                stack.push_back(target);
+            }
+        }
+    }
+    std::sort(reached.begin(), reached.end(), [this](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+    return reached;
+}
+
+std::vector<uint32_t> DependencyGraph::getDependencies(uint32_t node) const {
+    return reach(forward, node);
+}
+
+std::vector<uint32_t> DependencyGraph::getDependents(uint32_t node) const {
+    return reach(reverse, node);
+}
+
+std::vector<uint32_t> DependencyGraph::getDirectDependencies(uint32_t node) const {
+    Range range = directDependencies(node);
+    return std::vector<uint32_t>(range.begin(), range.end());
+}
+
+DependencyGraph::Range DependencyGraph::directDependencies(uint32_t node) const {
+    const uint32_t* targets = forward.targets.data();
+    return Range{targets + forward.offsets[node], targets + forward.offsets[node + 1]};
+}
+
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "build_manifest.hpp"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OreoBuild {
+
+// Forward and reverse index over the dependency edges a build manifest
+// recorded, so "what does this file pull in" and "what is affected by this
+// file" are answered without scanning the tree. Nodes are the recorded file
+// paths; a translation unit has an edge to every header it includes, directly
+// or not, and a generated file to the inputs of the step producing it.
+class DependencyGraph {
+public:
+    // Neighbours of a node, pointing into the graph's own storage.
+    struct Range {
+        const uint32_t* first;
+        const uint32_t* last;
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+    };
+
+    explicit DependencyGraph(const BuildManifest& manifest);
+
+    size_t size() const { return names.size(); }
+    const std::string& getName(uint32_t node) const { return names[node]; }
+    // False when path names no recorded file. Tries the path as given, then
+    // lexically normalized.
+    bool find(const std::string& path, uint32_t& node) const;
+
+    // Files node depends on, and files depending on it, directly or
+    // transitively; sorted by path, node itself excluded.
+    std::vector<uint32_t> getDependencies(uint32_t node) const;
+    std::vector<uint32_t> getDependents(uint32_t node) const;
+    std::vector<uint32_t> getDirectDependencies(uint32_t node) const;
+    // Same without copying, for walks over the whole graph.
+    Range directDependencies(uint32_t node) const;
+
+private:
+    // Compressed adjacency lists: the neighbours of node n are
+    // targets[offsets[n]] up to targets[offsets[n + 1]].
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> targets;
+    };
+
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> indices;
+    // Normalized spellings, built on the first lookup that needs them.
+    mutable std::once_flag normalizedOnce;
+    mutable std::unordered_map<std::string, uint32_t> normalizedIndices;
+    Adjacency forward;
+    Adjacency reverse;
+
+    std::vector<uint32_t> reach(const Adjacency& adjacency, uint32_t node) const;
+    static Adjacency index(uint32_t nodeCount, const std::vector<std::pair<uint32_t, uint32_t>>& edges, bool reversed);
+};
+
+}
@@ -0,0 +1,224 @@
+#include "distributed_protocol.hpp"
+#include "hash.hpp"
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+namespace OreoBuild {
+
+namespace {
+
+class MessageWriter {
+public:
+    explicit MessageWriter(MessageType type) { buffer.push_back(static_cast<char>(type)); }
+
+    MessageWriter& putByte(uint8_t value) {
+        buffer.push_back(static_cast<char>(value));
+        return *this;
+    }
+
+    MessageWriter& putNumber(uint64_t value) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            buffer.push_back(static_cast<char>((value >> shift) & 0xff));
+        }
+        return *this;
+    }
+
+    MessageWriter& putString(const std::string& value) {
+        putNumber(value.size());
+        buffer += value;
+        return *this;
+    }
+
+    const std::string& str() const { return buffer; }
+
+private:
+    std::string buffer;
+};
+
+class MessageReader {
+public:
+    MessageReader(const std::string& payload, MessageType expected) : payload(payload) {
+        ok = !payload.empty() && static_cast<MessageType>(payload[0]) == expected;
+        offset = 1;
+    }
+
+    bool getByte(uint8_t& value) {
+        if (!ok || offset + 1 > payload.size()) {
+            return ok = false;
+        }
+        value = static_cast<uint8_t>(payload[offset++]);
+        return true;
+    }
+
+    bool getNumber(uint64_t& value) {
+        if (!ok || offset + 8 > payload.size()) {
+            return ok = false;
+        }
+        value = 0;
+        for (int i = 0; i < 8; ++i) {
+            value = (value << 8) | static_cast<uint8_t>(payload[offset++]);
+        }
+        return true;
+    }
+
+    bool getString(std::string& value) {
+        uint64_t size = 0;
+        if (!getNumber(size) || size > payload.size() - offset) {
+            return ok = false;
+        }
+        value.assign(payload, offset, static_cast<size_t>(size));
+        offset += static_cast<size_t>(size);
+        return true;
+    }
+
+    bool valid() const { return ok; }
+
+private:
+    const std::string& payload;
+    size_t offset = 0;
+    bool ok = false;
+};
+
+}
+
+std::string DistributedProtocol::encode(const HelloRequest& request) {
+    return MessageWriter(MessageType::Hello)
+        .putNumber(version)
+        .putString(request.compiler)
+        .putString(request.toolchainFingerprint)
+        .str();
+}
+
+std::string DistributedProtocol::encode(const HelloReply& reply) {
+    return MessageWriter(MessageType::Hello)
+        .putByte(static_cast<uint8_t>(reply.status))
+        .putNumber(reply.slots)
+        .str();
+}
+
+std::string DistributedProtocol::encode(const RemoteCompileJob& job) {
+    MessageWriter writer(MessageType::Job);
+    writer.putNumber(version).putString(job.compiler).putString(job.toolchainFingerprint);
+    writer.putNumber(job.flags.size());
+    for (const auto& flag : job.flags) {
+        writer.putString(flag);
+    }
+    writer.putString(job.sourceName).putString(job.preprocessedSource);
+    return writer.str();
+}
+
+std::string DistributedProtocol::encode(const RemoteCompileResult& result) {
+    return MessageWriter(MessageType::Job)
+        .putByte(static_cast<uint8_t>(result.status))
+        .putString(result.diagnostics)
+        .putString(result.object)
+        .str();
+}
+
+bool DistributedProtocol::peekType(const std::string& payload, MessageType& type) {
+    if (payload.empty()) {
+        return false;
+    }
+    type = static_cast<MessageType>(payload[0]);
+    return type == MessageType::Hello || type == MessageType::Job;
+}
+
+bool DistributedProtocol::decode(const std::string& payload, HelloRequest& request) {
+    MessageReader reader(payload, MessageType::Hello);
+    uint64_t peerVersion = 0;
+    reader.getNumber(peerVersion);
+    reader.getString(request.compiler);
+    reader.getString(request.toolchainFingerprint);
+    return reader.valid() && peerVersion == version;
+}
+
+bool DistributedProtocol::decode(const std::string& payload, HelloReply& reply) {
+    MessageReader reader(payload, MessageType::Hello);
+    uint8_t status = 0;
+    uint64_t slots = 0;
+    reader.getByte(status);
+    reader.getNumber(slots);
+    reply.status = static_cast<JobStatus>(status);
+    reply.slots = static_cast<uint32_t>(slots);
+    return reader.valid();
+}
+
+bool DistributedProtocol::decode(const std::string& payload, RemoteCompileJob& job) {
+    MessageReader reader(payload, MessageType::Job);
+    uint64_t peerVersion = 0;
+    uint64_t flagCount = 0;
+    reader.getNumber(peerVersion);
+    reader.getString(job.compiler);
+    reader.getString(job.toolchainFingerprint);
+    reader.getNumber(flagCount);
+    if (!reader.valid() || flagCount > 65536) {
+        return false;
+    }
+    job.flags.resize(static_cast<size_t>(flagCount));
+    for (auto& flag : job.flags) {
+        reader.getString(flag);
+    }
+    reader.getString(job.sourceName);
+    reader.getString(job.preprocessedSource);
+    return reader.valid() && peerVersion == version;
+}
+
+bool DistributedProtocol::decode(const std::string& payload, RemoteCompileResult& result) {
+    MessageReader reader(payload, MessageType::Job);
+    uint8_t status = 0;
+    reader.getByte(status);
+    reader.getString(result.diagnostics);
+    reader.getString(result.object);
+    result.status = static_cast<JobStatus>(status);
+    return reader.valid();
+}
+
+bool DistributedProtocol::isAllowedFlag(const std::string& flag) {
+    auto startsWith = [&](const char* prefix) { return flag.rfind(prefix, 0) == 0; };
+    // -f options naming a path or a plugin are refused too; the worker runs
+    // the compiler in its scratch directory, so whatever relative file an
+    // allowed option writes stays there. -D and -U no longer matter after
+    // preprocessing but are harmless.
+    if (startsWith("-f")) {
+        size_t equals = flag.find('=');
+        return !startsWith("-fplugin") && !startsWith("-fpass-plugin") && !startsWith("-fdump") &&
+               (equals == std::string::npos || flag.find_first_of("/.", equals) == std::string::npos);
+    }
+    if (startsWith("-W")) {
+        return !startsWith("-Wl,") && !startsWith("-Wa,") && !startsWith("-Wp,");
+    }
+    if (startsWith("-m")) {
+        return flag != "-mllvm";
+    }
+    return startsWith("-O") || startsWith("-g") || startsWith("-std=") || startsWith("-D") || startsWith("-U") ||
+           flag == "-pthread";
+}
+
+std::string DistributedProtocol::toolchainFingerprint(const std::string& compiler) {
+    static std::mutex cacheMutex;
+    static std::map<std::string, std::string> cache;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(compiler);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    std::string banner;
+    std::string quoted = "'" + compiler + "'";
+    std::string command = quoted + " --version 2>/dev/null; " + quoted + " -dumpmachine 2>/dev/null";
+    if (FILE* pipe = ::popen(command.c_str(), "r")) {
+        char buffer[512];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+            banner.append(buffer, n);
+        }
+        ::pclose(pipe);
+    }
+
+    std::string fingerprint = banner.empty() ? std::string() : Hasher().update(banner).hexDigest();
+    cache[compiler] = fingerprint;
+    return fingerprint;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace OreoBuild {
+
+// Wire format shared by the distributed compiler client and oreobuild-worker.
+// Every message is one length-prefixed frame (see Socket::sendFrame) whose
+// payload starts with a MessageType byte followed by length-prefixed fields.
+
+enum class MessageType : uint8_t {
+    Hello = 'H',
+    Job = 'J'
+};
+
+enum class JobStatus : uint8_t {
+    Ok = 0,
+    CompileError = 1,
+    ToolchainMismatch = 2,
+    InternalError = 3
+};
+
+struct HelloRequest {
+    std::string compiler;
+    std::string toolchainFingerprint;
+};
+
+struct HelloReply {
+    JobStatus status = JobStatus::InternalError;
+    uint32_t slots = 0;
+};
+
+struct RemoteCompileJob {
+    std::string compiler;
+    std::string toolchainFingerprint;
+    std::vector<std::string> flags;
+    std::string sourceName;
+    std::string preprocessedSource;
+};
+
+struct RemoteCompileResult {
+    JobStatus status = JobStatus::InternalError;
+    std::string diagnostics;
+    std::string object;
+};
+
+class DistributedProtocol {
+public:
+    static const uint32_t version = 1;
+
+    static std::string encode(const HelloRequest& request);
+    static std::string encode(const HelloReply& reply);
+    static std::string encode(const RemoteCompileJob& job);
+    static std::string encode(const RemoteCompileResult& result);
+
+    static bool peekType(const std::string& payload, MessageType& type);
+    static bool decode(const std::string& payload, HelloRequest& request);
+    static bool decode(const std::string& payload, HelloReply& reply);
+    static bool decode(const std::string& payload, RemoteCompileJob& job);
+    static bool decode(const std::string& payload, RemoteCompileResult& result);
+
+    // Hash of the compiler's version banner and target triple. Both sides
+    // compute it the same way, so a mismatch means objects would differ.
+    static std::string toolchainFingerprint(const std::string& compiler);
+
+    // Whether a worker accepts flag. Only code generation and warning flags
+    // do: anything else may make the driver load or run a program (-wrapper,
+    // -fplugin=, -B, @file) or read and write files outside the job
+    // (-include, -fdump-*=), and a denylist could never be complete.
+    static bool isAllowedFlag(const std::string& flag);
+};
+
+}
@@ -1,7 +1,15 @@
 #include "file_utils.hpp"
-#include <iostream>
+#include "logger.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <ctime>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace OreoBuild {
 
@@ -9,24 +17,24 @@ std::filesystem::file_time_type FileUtils::getLastModifiedTime(const std::string
     try {
         return std::filesystem::last_write_time(filename);
     } catch (const std::filesystem::filesystem_error& e) {
-        std::cerr << "Warning: Unable to get last modified time for " << filename << ": " << e.what() << std::endl;
+        OREO_WARN(LogCategory::Deps, "Warning: Unable to get last modified time for " << filename << ": " << e.what());
         return std::filesystem::file_time_type::min();
     }
 }
 
 bool FileUtils::isNewer(const std::string& file1, const std::string& file2) {
     if (!std::filesystem::exists(file2)) {
-        std::cout << file2 << " does not exist. Considering " << file1 << " as newer." << std::endl;
+        OREO_DEBUG(LogCategory::Deps, file2 << " does not exist. Considering " << file1 << " as newer.");
         return true;
     }
     if (!std::filesystem::exists(file1)) {
-        std::cout << file1 << " does not exist. It's not newer than " << file2 << "." << std::endl;
+        OREO_DEBUG(LogCategory::Deps, file1 << " does not exist. It's not newer than " << file2 << ".");
         return false;
     }
     auto time1 = getLastModifiedTime(file1);
     auto time2 = getLastModifiedTime(file2);
     bool newer = time1 > time2;
-    std::cout << file1 << " is " << (newer ? "newer" : "older") << " than " << file2 << std::endl;
+    OREO_DEBUG(LogCategory::Deps, file1 << " is " << (newer ? "newer" : "older") << " than " << file2);
     return newer;
 }
 
@@ -34,21 +42,113 @@ void FileUtils::updateTimestamp(const std::string& filename) {
     try {
         std::filesystem::last_write_time(filename, std::filesystem::file_time_type::clock::now());
     } catch (const std::filesystem::filesystem_error& e) {
-        std::cerr << "Warning: Unable to update timestamp for " << filename << ": " << e.what() << std::endl;
+        OREO_WARN(LogCategory::General, "Warning: Unable to update timestamp for " << filename << ": " << e.what());
     }
 }
 
 void FileUtils::printFileInfo(const std::string& filename) {
-    std::cout << "File info for " << filename << ":" << std::endl;
     if (std::filesystem::exists(filename)) {
         auto lastModTime = getLastModifiedTime(filename);
         auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(lastModTime - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now());
         std::time_t cftime = std::chrono::system_clock::to_time_t(sctp);
-        std::cout << "  Last modified: " << std::put_time(std::localtime(&cftime), "%F %T") << std::endl;
-        std::cout << "  Size: " << std::filesystem::file_size(filename) << " bytes" << std::endl;
+        OREO_VERBOSE(LogCategory::Deps, "File info for " << filename << ":\n"
+                     << "  Last modified: " << std::put_time(std::localtime(&cftime), "%F %T") << "\n"
+                     << "  Size: " << std::filesystem::file_size(filename) << " bytes");
     } else {
-        std::cout << "  File does not exist" << std::endl;
+        OREO_VERBOSE(LogCategory::Deps, "File info for " << filename << ":\n  File does not exist");
     }
 }
 
+FileState FileUtils::getFileState(const std::string& filename) {
+    FileState state;
+    struct stat st;
+    if (::stat(filename.c_str(), &st) == 0) {
+        state.exists = true;
+        state.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        state.size = static_cast<uint64_t>(st.st_size);
+    }
+    return state;
+}
+
+std::string FileUtils::findExecutable(const std::string& name) {
+    if (name.find('/') != std::string::npos) {
+        return name;
+    }
+    const char* pathEnv = std::getenv("PATH");
+    if (!pathEnv) {
+        return "";
+    }
+    std::istringstream paths(pathEnv);
+    std::string dir;
+    while (std::getline(paths, dir, ':')) {
+        std::string candidate = (dir.empty() ? std::string(".") : dir) + "/" + name;
+        if (::access(candidate.c_str(), X_OK) == 0) {
+            return candidate;
+        }
+    }
+    return "";
+}
+
+size_t FileUtils::pruneDirectory(const std::string& dir, uint64_t maxBytes) {
+    struct Entry {
+        std::filesystem::path path;
+        int64_t mtimeNs;
+        uint64_t size;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(dir, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+        if (!it->is_regular_file(ec)) {
+            continue;
+        }
+        FileState state = getFileState(it->path().string());
+        if (state.exists) {
+            entries.push_back({it->path(), state.mtimeNs, state.size});
+            total += state.size;
+        }
+    }
+    if (total <= maxBytes) {
+        return 0;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.mtimeNs < b.mtimeNs; });
+    size_t removed = 0;
+    for (const auto& entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, ec)) {
+            total -= entry.size;
+            removed++;
+        }
+    }
+    return removed;
+}
+
+bool FileUtils::writeFileAtomically(const std::string& path, const std::string& content) {
+    std::string scratch = getScratchPath(path);
+    int fd = ::open(scratch.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = true;
+    for (size_t offset = 0; written && offset < content.size();) {
+        ssize_t count = ::write(fd, content.data() + offset, content.size() - offset);
+        if (count < 0 && errno != EINTR) {
+            written = false;
+        } else if (count > 0) {
+            offset += static_cast<size_t>(count);
+        }
+    }
+    written = ::fsync(fd) == 0 && written;
+    written = ::close(fd) == 0 && written;
+    if (!written || ::rename(scratch.c_str(), path.c_str()) != 0) {
+        ::unlink(scratch.c_str());
+        return false;
+    }
+    return true;
+}
+
 }
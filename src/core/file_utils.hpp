@@ -1,15 +1,39 @@
 #pragma once
 #include <string>
 #include <filesystem>
+#include <cstdint>
 
 namespace OreoBuild {
 
+// Result of a single stat() call; a missing file has exists == false.
+struct FileState {
+    bool exists = false;
+    int64_t mtimeNs = 0;
+    uint64_t size = 0;
+
+    bool operator==(const FileState& other) const {
+        return exists == other.exists && mtimeNs == other.mtimeNs && size == other.size;
+    }
+    bool operator!=(const FileState& other) const { return !(*this == other); }
+};
+
 class FileUtils {
 public:
     static std::filesystem::file_time_type getLastModifiedTime(const std::string& filename);
     static bool isNewer(const std::string& file1, const std::string& file2);
     static void updateTimestamp(const std::string& filename);
     static void printFileInfo(const std::string& filename);
+    static FileState getFileState(const std::string& filename);
+    static std::string findExecutable(const std::string& name);
+    // Deletes the least recently modified files under dir until the total
+    // size is at most maxBytes. Returns the number of files removed.
+    static size_t pruneDirectory(const std::string& dir, uint64_t maxBytes);
+    // Replaces path with content so that a crash leaves either the old or
+    // the new file, never a mix: writes a scratch file, syncs it and renames
+    // it over path. False on any I/O error.
+    static bool writeFileAtomically(const std::string& path, const std::string& content);
+    // Where a tool writes an output before it is renamed into place.
+    static std::string getScratchPath(const std::string& path) { return path + ".tmp"; }
 };
 
 }
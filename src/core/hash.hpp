@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace OreoBuild {
+
+// Incremental 64-bit FNV-1a hasher used for build fingerprints.
+class Hasher {
+public:
+    Hasher& update(const void* data, size_t size);
+    Hasher& update(const std::string& value);
+    Hasher& update(uint64_t value);
+
+    uint64_t digest() const { return state; }
+    std::string hexDigest() const;
+
+    static std::string toHex(uint64_t value);
+
+private:
+    uint64_t state = 14695981039346656037ull;
+};
+
+// SHA-256, used where digests must match other tools (remote cache CAS keys).
+class Sha256 {
+public:
+    Sha256();
+    Sha256& update(const void* data, size_t size);
+    Sha256& update(const std::string& value) { return update(value.data(), value.size()); }
+    std::string hexDigest();
+
+    static std::string hash(const std::string& value) { return Sha256().update(value).hexDigest(); }
+
+private:
+    uint32_t state[8];
+    unsigned char block[64];
+    size_t blockSize = 0;
+    uint64_t totalBytes = 0;
+
+    void transform(const unsigned char* chunk);
+};
+
+}
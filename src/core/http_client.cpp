@@ -0,0 +1,154 @@
+#include "http_client.hpp"
+#include "socket_utils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace OreoBuild {
+
+namespace {
+
+std::string toLower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return std::tolower(c); });
+    return value;
+}
+
+bool decodeChunked(const std::string& encoded, std::string& decoded) {
+    size_t offset = 0;
+    decoded.clear();
+    while (true) {
+        size_t lineEnd = encoded.find("\r\n", offset);
+        if (lineEnd == std::string::npos) {
+            return false;
+        }
+        size_t chunkSize = 0;
+        try {
+            chunkSize = std::stoul(encoded.substr(offset, lineEnd - offset), nullptr, 16);
+        } catch (const std::exception&) {
+            return false;
+        }
+        offset = lineEnd + 2;
+        if (chunkSize == 0) {
+            return true;
+        }
+        if (chunkSize > encoded.size() - offset) {
+            return false;
+        }
+        decoded.append(encoded, offset, chunkSize);
+        offset += chunkSize + 2;
+    }
+}
+
+}
+
+HttpClient::HttpClient(const std::string& baseUrl, int timeoutMs) : timeoutMs(timeoutMs) {
+    const std::string scheme = "http://";
+    if (baseUrl.compare(0, scheme.size(), scheme) != 0) {
+        throw std::runtime_error("Only http:// URLs are supported: " + baseUrl);
+    }
+    std::string rest = baseUrl.substr(scheme.size());
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    pathPrefix = slash == std::string::npos ? "" : rest.substr(slash);
+    while (!pathPrefix.empty() && pathPrefix.back() == '/') {
+        pathPrefix.pop_back();
+    }
+    if (authority.find(':') == std::string::npos) {
+        host = authority;
+    } else if (!parseHostPort(authority, host, port)) {
+        throw std::runtime_error("Invalid host in URL: " + baseUrl);
+    }
+    if (host.empty()) {
+        throw std::runtime_error("Invalid host in URL: " + baseUrl);
+    }
+}
+
+bool HttpClient::request(const std::string& method, const std::string& path, const std::string& body, HttpResponse& response) const {
+    Socket socket = Socket::connectTo(host, port, timeoutMs);
+    if (!socket.isValid()) {
+        return false;
+    }
+
+    std::ostringstream head;
+    head << method << ' ' << pathPrefix << path << " HTTP/1.1\r\n"
+         << "Host: " << host << ':' << port << "\r\n"
+         << "Connection: close\r\n";
+    if (method == "PUT" || method == "POST") {
+        head << "Content-Type: application/octet-stream\r\n"
+             << "Content-Length: " << body.size() << "\r\n";
+    }
+    head << "\r\n";
+    std::string headText = head.str();
+    if (!socket.sendAll(headText.data(), headText.size()) || !socket.sendAll(body.data(), body.size())) {
+        return false;
+    }
+
+    std::string raw;
+    char buffer[65536];
+    long received;
+    while ((received = socket.recvSome(buffer, sizeof(buffer))) > 0) {
+        raw.append(buffer, static_cast<size_t>(received));
+    }
+    if (received < 0) {
+        return false;
+    }
+
+    size_t headerEnd = raw.find("\r\n\r\n");
+    if (headerEnd == std::string::npos || raw.compare(0, 5, "HTTP/") != 0) {
+        return false;
+    }
+    std::istringstream headers(raw.substr(0, headerEnd));
+    std::string statusLine;
+    std::getline(headers, statusLine);
+    std::istringstream statusStream(statusLine);
+    std::string version;
+    statusStream >> version >> response.status;
+    if (response.status == 0) {
+        return false;
+    }
+
+    bool chunked = false;
+    long long contentLength = -1;
+    std::string line;
+    while (std::getline(headers, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = toLower(line.substr(0, colon));
+        std::string value = line.substr(colon + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t\r") + 1);
+        if (name == "content-length") {
+            // Runs on the uploader thread too, where an exception would end
+            // the build; a bad length fails the response instead.
+            char* end = nullptr;
+            errno = 0;
+            long long length = std::strtoll(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || errno == ERANGE || length < 0) {
+                return false;
+            }
+            contentLength = length;
+        } else if (name == "transfer-encoding" && toLower(value).find("chunked") != std::string::npos) {
+            chunked = true;
+        }
+    }
+
+    std::string payload = raw.substr(headerEnd + 4);
+    if (chunked) {
+        return decodeChunked(payload, response.body);
+    }
+    if (contentLength >= 0) {
+        if (payload.size() < static_cast<size_t>(contentLength)) {
+            return false;
+        }
+        payload.resize(static_cast<size_t>(contentLength));
+    }
+    response.body = std::move(payload);
+    return true;
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace OreoBuild {
+
+struct HttpResponse {
+    int status = 0;
+    std::string body;
+};
+
+// Minimal blocking HTTP/1.1 client (plain http only), one connection per request.
+class HttpClient {
+public:
+    // Throws std::runtime_error when baseUrl is not of the form http://host[:port][/prefix].
+    HttpClient(const std::string& baseUrl, int timeoutMs);
+
+    // Returns false on connection, timeout or protocol errors; HTTP error
+    // statuses are reported through response.status instead.
+    bool request(const std::string& method, const std::string& path, const std::string& body, HttpResponse& response) const;
+
+    const std::string& getHost() const { return host; }
+    uint16_t getPort() const { return port; }
+
+private:
+    std::string host;
+    uint16_t port = 80;
+    std::string pathPrefix;
+    int timeoutMs;
+};
+
+}
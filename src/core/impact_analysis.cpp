@@ -0,0 +1,97 @@
+#include "impact_analysis.hpp"
+#include "dependency_graph.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace OreoBuild {
+
+std::vector<ImpactEntry> ImpactAnalysis::analyze(const BuildManifest& manifest,
+                                                 const std::vector<std::pair<std::string, uint64_t>>& translationUnits,
+                                                 size_t limit) {
+    DependencyGraph graph(manifest);
+    const uint32_t nodeCount = static_cast<uint32_t>(graph.size());
+
+    std::vector<std::pair<uint32_t, uint64_t>> roots;
+    for (const auto& [path, cost] : translationUnits) {
+        uint32_t node;
+        if (graph.find(path, node)) {
+            roots.emplace_back(node, cost);
+        }
+    }
+
+    // Walk forward from every translation unit; each file reached gets the
+    // unit's cost added once. Threads keep private totals and merge at the end.
+    struct Totals {
+        std::vector<uint32_t> fanIn;
+        std::vector<uint64_t> cost;
+    };
+    size_t threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), roots.size() / 64 + 1));
+    std::vector<Totals> totals(threadCount);
+    std::atomic<size_t> next{0};
+    auto walk = [&](Totals& local) {
+        local.fanIn.assign(nodeCount, 0);
+        local.cost.assign(nodeCount, 0);
+        std::vector<uint32_t> visited(nodeCount, 0);
+        std::vector<uint32_t> stack;
+        uint32_t epoch = 0;
+        for (size_t index = next++; index < roots.size(); index = next++) {
+            ++epoch;
+            auto [root, cost] = roots[index];
+            visited[root] = epoch;
+            stack.push_back(root);
+            while (!stack.empty()) {
+                uint32_t node = stack.back();
+                stack.pop_back();
+                for (uint32_t target : graph.directDependencies(node)) {
+                    if (visited[target] != epoch) {
+                        visited[target] = epoch;
+                        local.fanIn[target]++;
+                        local.cost[target] += cost;
+                        stack.push_back(target);
+                    }
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(walk, std::ref(totals[i]));
+    }
+    walk(totals[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double builds = std::max<uint32_t>(1, manifest.getRecordedBuilds());
+    std::vector<ImpactEntry> entries;
+    for (uint32_t node = 0; node < nodeCount; ++node) {
+        ImpactEntry entry;
+        for (const auto& local : totals) {
+            entry.fanIn += local.fanIn[node];
+            entry.rebuildCostUs += local.cost[node];
+        }
+        if (entry.fanIn == 0) {
+            continue;
+        }
+        entry.path = graph.getName(node);
+        entry.changes = manifest.getChangeCount(entry.path);
+        entry.expectedCostUs = entry.rebuildCostUs * (entry.changes / builds);
+        entries.push_back(std::move(entry));
+    }
+
+    size_t count = std::min(limit, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), [](const ImpactEntry& a, const ImpactEntry& b) {
+        if (a.expectedCostUs != b.expectedCostUs) {
+            return a.expectedCostUs > b.expectedCostUs;
+        }
+        if (a.rebuildCostUs != b.rebuildCostUs) {
+            return a.rebuildCostUs > b.rebuildCostUs;
+        }
+        return a.path < b.path;
+    });
+    entries.resize(count);
+    return entries;
+}
+
+}
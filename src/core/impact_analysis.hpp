@@ -0,0 +1,31 @@
+#pragma once
+#include "build_manifest.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace OreoBuild {
+
+struct ImpactEntry {
+    std::string path;
+    // Translation units that include the file, directly or transitively.
+    uint32_t fanIn = 0;
+    // Sum of the compile times of those translation units.
+    uint64_t rebuildCostUs = 0;
+    uint32_t changes = 0;
+    // rebuildCostUs weighted by how often the file changed per build.
+    double expectedCostUs = 0;
+};
+
+// Ranks the files recorded in a build manifest by what touching them costs.
+class ImpactAnalysis {
+public:
+    // translationUnits pairs each source with its compile time in
+    // microseconds. Returns at most limit entries, most expensive first.
+    static std::vector<ImpactEntry> analyze(const BuildManifest& manifest,
+                                            const std::vector<std::pair<std::string, uint64_t>>& translationUnits,
+                                            size_t limit);
+};
+
+}
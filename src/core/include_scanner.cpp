@@ -0,0 +1,818 @@
+#include "include_scanner.hpp"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace OreoBuild {
+
+namespace {
+
+// Macro values that are not replacement text: function-like macros, which
+// the scanner does not expand, macros a file has #undef'd, and macros whose
+// state depends on a branch that could not be decided.
+const std::string functionLikeValue = "\x01";
+const std::string undefinedValue = "\x02";
+const std::string unknownValue = "\x03";
+
+bool isIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+std::string trimText(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r\f\v");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r\f\v");
+    return text.substr(begin, end - begin + 1);
+}
+
+std::string leadingIdentifier(const std::string& text) {
+    size_t end = 0;
+    while (end < text.size() && isIdentifierChar(text[end])) {
+        ++end;
+    }
+    return text.substr(0, end);
+}
+
+bool isSpecial(char c) {
+    return c == '#' || c == '/' || c == '"' || c == '\'';
+}
+
+// Offset of the next character that may start a directive, a comment or a
+// literal. Everything else is skipped sixteen bytes at a time.
+size_t findSpecial(const char* data, size_t size, size_t from) {
+#if defined(__SSE2__)
+    const __m128i hash = _mm_set1_epi8('#');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i apostrophe = _mm_set1_epi8('\'');
+    while (from + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+        __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, hash), _mm_cmpeq_epi8(chunk, slash)),
+                                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, apostrophe)));
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) {
+            return from + __builtin_ctz(static_cast<unsigned>(mask));
+        }
+        from += 16;
+    }
+#endif
+    while (from < size && !isSpecial(data[from])) {
+        ++from;
+    }
+    return from;
+}
+
+// Offset just past the literal that opens at data[start].
+size_t skipLiteral(const char* data, size_t size, size_t start) {
+    char quote = data[start];
+    if (quote == '"') {
+        size_t prefix = start;
+        while (prefix > 0 && isIdentifierChar(data[prefix - 1])) {
+            --prefix;
+        }
+        std::string encoding(data + prefix, start - prefix);
+        if (encoding == "R" || encoding == "uR" || encoding == "UR" || encoding == "LR" || encoding == "u8R") {
+            size_t open = start + 1;
+            while (open < size && open - start <= 17 && data[open] != '(') {
+                ++open;
+            }
+            if (open < size && data[open] == '(') {
+                std::string terminator = ")" + std::string(data + start + 1, open - start - 1) + "\"";
+                const char* end = static_cast<const char*>(
+                    memmem(data + open, size - open, terminator.data(), terminator.size()));
+                return end ? end - data + terminator.size() : size;
+            }
+        }
+    } else if (start > 0 && std::isxdigit(static_cast<unsigned char>(data[start - 1]))) {
+        return start + 1;  // digit separator, as in 1'000
+    }
+    size_t i = start + 1;
+    while (i < size && data[i] != quote && data[i] != '\n') {
+        i += data[i] == '\\' ? 2 : 1;
+    }
+    return i < size && data[i] == quote ? i + 1 : i;
+}
+
+// Calls onDirective with the text after the '#' of every directive, with
+// continuation lines joined and comments removed.
+void forEachDirective(const char* data, size_t size, const std::function<void(const std::string&)>& onDirective) {
+    size_t i = 0;
+    while ((i = findSpecial(data, size, i)) < size) {
+        char c = data[i];
+        if (c == '/') {
+            if (i + 1 < size && data[i + 1] == '/') {
+                const void* end = std::memchr(data + i, '\n', size - i);
+                i = end ? static_cast<const char*>(end) - data : size;
+            } else if (i + 1 < size && data[i + 1] == '*') {
+                const char* end = static_cast<const char*>(memmem(data + i + 2, size - i - 2, "*/", 2));
+                i = end ? end - data + 2 : size;
+            } else {
+                ++i;
+            }
+            continue;
+        }
+        if (c != '#') {
+            i = skipLiteral(data, size, i);
+            continue;
+        }
+
+        size_t lineStart = i;
+        while (lineStart > 0 && (data[lineStart - 1] == ' ' || data[lineStart - 1] == '\t' ||
+                                 data[lineStart - 1] == '\r' || data[lineStart - 1] == '\f' ||
+                                 data[lineStart - 1] == '\v')) {
+            --lineStart;
+        }
+        if (lineStart > 0 && data[lineStart - 1] != '\n') {
+            ++i;
+            continue;
+        }
+
+        std::string text;
+        size_t j = i + 1;
+        while (j < size && data[j] != '\n') {
+            if (data[j] == '\\' && j + 1 < size && (data[j + 1] == '\n' || data[j + 1] == '\r')) {
+                j += data[j + 1] == '\r' && j + 2 < size && data[j + 2] == '\n' ? 3 : 2;
+            } else if (data[j] == '/' && j + 1 < size && data[j + 1] == '/') {
+                while (j < size && data[j] != '\n') {
+                    ++j;
+                }
+            } else if (data[j] == '/' && j + 1 < size && data[j + 1] == '*') {
+                const char* end = static_cast<const char*>(memmem(data + j + 2, size - j - 2, "*/", 2));
+                j = end ? end - data + 2 : size;
+                text += ' ';
+            } else if (data[j] == '"') {
+                size_t end = skipLiteral(data, size, j);
+                text.append(data + j, end - j);
+                j = end;
+            } else {
+                text += data[j++];
+            }
+        }
+        onDirective(text);
+        i = j;
+    }
+}
+
+enum class Truth { False, True, Unknown };
+
+Truth negate(Truth truth) {
+    return truth == Truth::Unknown ? truth : truth == Truth::True ? Truth::False : Truth::True;
+}
+
+// Conditional groups and macros of the file being scanned.
+class DirectiveState {
+public:
+    DirectiveState(const std::unordered_map<std::string, std::string>& predefined,
+                   std::function<bool(const std::string&, bool)> hasInclude)
+        : predefined(predefined), hasInclude(std::move(hasInclude)) {}
+
+    bool isActive() const { return groups.empty() || groups.back().active; }
+    // Whether the next #elif/#else could still be taken, i.e. is worth evaluating.
+    bool canTakeBranch() const { return !groups.empty() && groups.back().parentActive && !groups.back().decided; }
+
+    void push(Truth truth) {
+        Group group;
+        group.parentActive = isActive();
+        group.parentCertain = groups.empty() || groups.back().certain;
+        enter(group, truth);
+        groups.push_back(group);
+    }
+
+    void branch(Truth truth) {
+        if (!groups.empty()) {
+            enter(groups.back(), truth);
+        }
+    }
+
+    void pop() {
+        if (!groups.empty()) {
+            groups.pop_back();
+        }
+    }
+
+    void define(const std::string& name, const std::string& value) {
+        local[name] = groups.empty() || groups.back().certain ? value : unknownValue;
+    }
+
+    // Replacement text, or one of the marker values above. Names the
+    // implementation reserves can only come from the compiler, so they are
+    // undefined when it does not predefine them; any other name might be
+    // defined by an includer.
+    std::string lookup(const std::string& name) const {
+        auto it = local.find(name);
+        if (it != local.end()) {
+            return it->second;
+        }
+        auto predefinedIt = predefined.find(name);
+        if (predefinedIt != predefined.end()) {
+            return predefinedIt->second;
+        }
+        bool reserved = name.size() > 1 && name[0] == '_' &&
+                        (name[1] == '_' || std::isupper(static_cast<unsigned char>(name[1])));
+        return reserved ? undefinedValue : unknownValue;
+    }
+
+    Truth isDefined(const std::string& name) const {
+        std::string value = lookup(name);
+        return value == undefinedValue ? Truth::False : value == unknownValue ? Truth::Unknown : Truth::True;
+    }
+
+    Truth evaluate(const std::string& expression) const;
+
+    bool includes(const std::string& header, bool next) const { return hasInclude(header, next); }
+
+private:
+    struct Group {
+        bool parentActive = true;
+        bool parentCertain = true;
+        bool active = false;
+        // Whether the group is taken whatever the includers define.
+        bool certain = false;
+        // Whether an earlier branch was taken for sure.
+        bool decided = false;
+        // Whether an earlier branch may have been taken.
+        bool maybeTaken = false;
+    };
+
+    const std::unordered_map<std::string, std::string>& predefined;
+    std::function<bool(const std::string&, bool)> hasInclude;
+    std::unordered_map<std::string, std::string> local;
+    std::vector<Group> groups;
+
+    static void enter(Group& group, Truth truth) {
+        if (!group.parentActive || group.decided || truth == Truth::False) {
+            group.active = false;
+            group.certain = false;
+            return;
+        }
+        group.active = true;
+        group.certain = group.parentCertain && truth == Truth::True && !group.maybeTaken;
+        if (truth == Truth::True) {
+            group.decided = true;
+        } else {
+            group.maybeTaken = true;
+        }
+    }
+};
+
+struct Value {
+    bool known;
+    long long number;
+};
+
+const Value unknown{false, 0};
+
+// Evaluates #if expressions. Anything the scanner cannot decide, such as a
+// function-like macro or __has_builtin, yields an unknown value, which only
+// short-circuiting operators can turn back into a known one.
+class ExpressionParser {
+public:
+    ExpressionParser(const DirectiveState& state, const std::string& text, int depth) : state(state), depth(depth) {
+        tokenize(text);
+    }
+
+    Value parse() {
+        try {
+            Value value = parseConditional();
+            return peek().kind == End ? value : unknown;
+        } catch (const std::runtime_error&) {
+            return unknown;
+        }
+    }
+
+private:
+    enum Kind { Number, Identifier, Punctuator, HasInclude, Opaque, End };
+
+    struct Token {
+        Kind kind;
+        std::string text;
+        long long number = 0;
+    };
+
+    const DirectiveState& state;
+    int depth;
+    std::vector<Token> tokens;
+    size_t position = 0;
+
+    void tokenize(const std::string& text) {
+        static const char* const longPunctuators[] = {"||", "&&", "==", "!=", "<=", ">=", "<<", ">>"};
+        size_t i = 0;
+        while (i < text.size()) {
+            char c = text[i];
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                ++i;
+            } else if (std::isdigit(static_cast<unsigned char>(c))) {
+                size_t end = i;
+                std::string digits;
+                while (end < text.size() && (isIdentifierChar(text[end]) || text[end] == '\'')) {
+                    if (text[end] != '\'') {
+                        digits += text[end];
+                    }
+                    ++end;
+                }
+                while (!digits.empty() && (digits.back() == 'u' || digits.back() == 'U' ||
+                                           digits.back() == 'l' || digits.back() == 'L')) {
+                    digits.pop_back();
+                }
+                int base = 10;
+                size_t skip = 0;
+                if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+                    base = 16;
+                    skip = 2;
+                } else if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'b' || digits[1] == 'B')) {
+                    base = 2;
+                    skip = 2;
+                } else if (digits.size() > 1 && digits[0] == '0') {
+                    base = 8;
+                }
+                char* parsedEnd = nullptr;
+                unsigned long long number = std::strtoull(digits.c_str() + skip, &parsedEnd, base);
+                Token token{parsedEnd && *parsedEnd == '\0' ? Number : Opaque, text.substr(i, end - i)};
+                token.number = static_cast<long long>(number);
+                tokens.push_back(token);
+                i = end;
+            } else if (isIdentifierChar(c)) {
+                size_t end = i;
+                while (end < text.size() && isIdentifierChar(text[end])) {
+                    ++end;
+                }
+                std::string name = text.substr(i, end - i);
+                size_t open = text.find_first_not_of(" \t", end);
+                if ((name == "__has_include" || name == "__has_include_next") && open != std::string::npos &&
+                    text[open] == '(') {
+                    size_t close = text.find(')', open);
+                    if (close == std::string::npos) {
+                        throw std::runtime_error("unterminated __has_include");
+                    }
+                    tokens.push_back(Token{HasInclude, trimText(text.substr(open + 1, close - open - 1))});
+                    tokens.back().number = name == "__has_include_next";
+                    i = close + 1;
+                } else {
+                    tokens.push_back(Token{Identifier, name});
+                    i = end;
+                }
+            } else if (c == '\'') {
+                size_t close = text.find('\'', i + 1);
+                if (close == i + 2) {
+                    Token token{Number, text.substr(i, 3)};
+                    token.number = static_cast<unsigned char>(text[i + 1]);
+                    tokens.push_back(token);
+                } else {
+                    tokens.push_back(Token{Opaque, "'"});
+                }
+                i = close == std::string::npos ? text.size() : close + 1;
+            } else {
+                std::string punctuator(1, c);
+                for (const char* candidate : longPunctuators) {
+                    if (text.compare(i, 2, candidate) == 0) {
+                        punctuator = candidate;
+                        break;
+                    }
+                }
+                tokens.push_back(Token{Punctuator, punctuator});
+                i += punctuator.size();
+            }
+        }
+    }
+
+    const Token& peek() const {
+        static const Token end{End, ""};
+        return position < tokens.size() ? tokens[position] : end;
+    }
+
+    bool accept(const char* punctuator) {
+        if (peek().kind == Punctuator && peek().text == punctuator) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(const char* punctuator) {
+        if (!accept(punctuator)) {
+            throw std::runtime_error("malformed expression");
+        }
+    }
+
+    Value parseConditional() {
+        Value condition = parseBinary(1);
+        if (!accept("?")) {
+            return condition;
+        }
+        Value whenTrue = parseConditional();
+        expect(":");
+        Value whenFalse = parseConditional();
+        if (condition.known) {
+            return condition.number ? whenTrue : whenFalse;
+        }
+        if (whenTrue.known && whenFalse.known && whenTrue.number == whenFalse.number) {
+            return whenTrue;
+        }
+        return unknown;
+    }
+
+    static int precedence(const Token& token) {
+        if (token.kind != Punctuator) {
+            return 0;
+        }
+        static const std::pair<const char*, int> table[] = {
+            {"*", 10}, {"/", 10}, {"%", 10}, {"+", 9}, {"-", 9}, {"<<", 8}, {">>", 8},
+            {"<", 7}, {">", 7}, {"<=", 7}, {">=", 7}, {"==", 6}, {"!=", 6},
+            {"&", 5}, {"^", 4}, {"|", 3}, {"&&", 2}, {"||", 1}};
+        for (const auto& entry : table) {
+            if (token.text == entry.first) {
+                return entry.second;
+            }
+        }
+        return 0;
+    }
+
+    Value parseBinary(int minimumPrecedence) {
+        Value left = parseUnary();
+        while (true) {
+            int operatorPrecedence = precedence(peek());
+            if (operatorPrecedence == 0 || operatorPrecedence < minimumPrecedence) {
+                return left;
+            }
+            std::string op = tokens[position++].text;
+            Value right = parseBinary(operatorPrecedence + 1);
+            left = apply(op, left, right);
+        }
+    }
+
+    static Value apply(const std::string& op, Value left, Value right) {
+        if (op == "&&") {
+            if ((left.known && !left.number) || (right.known && !right.number)) {
+                return {true, 0};
+            }
+            return left.known && right.known ? Value{true, 1} : unknown;
+        }
+        if (op == "||") {
+            if ((left.known && left.number) || (right.known && right.number)) {
+                return {true, 1};
+            }
+            return left.known && right.known ? Value{true, 0} : unknown;
+        }
+        if (!left.known || !right.known) {
+            return unknown;
+        }
+        long long a = left.number;
+        long long b = right.number;
+        auto wrap = [](unsigned long long value) { return Value{true, static_cast<long long>(value)}; };
+        if (op == "*") return wrap(static_cast<unsigned long long>(a) * static_cast<unsigned long long>(b));
+        if (op == "+") return wrap(static_cast<unsigned long long>(a) + static_cast<unsigned long long>(b));
+        if (op == "-") return wrap(static_cast<unsigned long long>(a) - static_cast<unsigned long long>(b));
+        if (op == "/" || op == "%") {
+            if (b == 0 || (a == std::numeric_limits<long long>::min() && b == -1)) {
+                return unknown;
+            }
+            return {true, op == "/" ? a / b : a % b};
+        }
+        if (op == "<<" || op == ">>") {
+            if (b < 0 || b >= 64) {
+                return unknown;
+            }
+            return op == "<<" ? wrap(static_cast<unsigned long long>(a) << b) : Value{true, a >> b};
+        }
+        if (op == "<") return {true, a < b};
+        if (op == ">") return {true, a > b};
+        if (op == "<=") return {true, a <= b};
+        if (op == ">=") return {true, a >= b};
+        if (op == "==") return {true, a == b};
+        if (op == "!=") return {true, a != b};
+        if (op == "&") return {true, a & b};
+        if (op == "^") return {true, a ^ b};
+        return {true, a | b};
+    }
+
+    Value parseUnary() {
+        for (const char* op : {"!", "~", "-", "+"}) {
+            if (accept(op)) {
+                Value operand = parseUnary();
+                if (!operand.known) {
+                    return unknown;
+                }
+                switch (op[0]) {
+                    case '!': return {true, !operand.number};
+                    case '~': return {true, ~operand.number};
+                    case '-': return {true, static_cast<long long>(0ULL - static_cast<unsigned long long>(operand.number))};
+                    default: return operand;
+                }
+            }
+        }
+        return parsePrimary();
+    }
+
+    Value parsePrimary() {
+        if (accept("(")) {
+            Value value = parseConditional();
+            expect(")");
+            return value;
+        }
+        Token token = peek();
+        ++position;
+        switch (token.kind) {
+            case Number:
+                return {true, token.number};
+            case HasInclude:
+                // A header missing from the include paths may still be a
+                // system header.
+                return state.includes(token.text, token.number != 0) ? Value{true, 1} : unknown;
+            case Opaque:
+                return unknown;
+            case Identifier:
+                break;
+            default:
+                throw std::runtime_error("malformed expression");
+        }
+
+        if (token.text == "defined") {
+            bool parenthesized = accept("(");
+            if (peek().kind != Identifier) {
+                throw std::runtime_error("malformed defined");
+            }
+            Truth defined = state.isDefined(tokens[position++].text);
+            if (parenthesized) {
+                expect(")");
+            }
+            return defined == Truth::Unknown ? unknown : Value{true, defined == Truth::True};
+        }
+        if (token.text == "true" || token.text == "false") {
+            return {true, token.text == "true"};
+        }
+        if (peek().kind == Punctuator && peek().text == "(") {
+            // Function-like macro or feature test; skip its arguments.
+            int nesting = 0;
+            do {
+                if (peek().kind == End) {
+                    throw std::runtime_error("unbalanced parentheses");
+                }
+                if (peek().text == "(") {
+                    ++nesting;
+                } else if (peek().text == ")") {
+                    --nesting;
+                }
+                ++position;
+            } while (nesting > 0);
+            return unknown;
+        }
+
+        std::string value = state.lookup(token.text);
+        if (value == undefinedValue) {
+            return {true, 0};
+        }
+        if (value == unknownValue || value == functionLikeValue || value.empty() || depth >= 16) {
+            return unknown;
+        }
+        return ExpressionParser(state, value, depth + 1).parse();
+    }
+};
+
+Truth DirectiveState::evaluate(const std::string& expression) const {
+    Value value = ExpressionParser(*this, expression, 0).parse();
+    return !value.known ? Truth::Unknown : value.number ? Truth::True : Truth::False;
+}
+
+// Splits a header-name ("name" or <name>) into its name and form.
+bool parseHeaderName(const std::string& text, std::string& name, bool& angled) {
+    if (text.empty() || (text[0] != '"' && text[0] != '<')) {
+        return false;
+    }
+    angled = text[0] == '<';
+    size_t end = text.find(angled ? '>' : '"', 1);
+    if (end == std::string::npos) {
+        return false;
+    }
+    name = text.substr(1, end - 1);
+    return !name.empty();
+}
+
+}
+
+IncludeScanner::IncludeScanner(const std::vector<std::string>& paths,
+                               std::unordered_map<std::string, std::string> predefinedMacros)
+    : predefinedMacros(std::move(predefinedMacros)) {
+    for (const auto& path : paths) {
+        std::string normal = std::filesystem::path(path).lexically_normal().string();
+        while (normal.size() > 1 && normal.back() == '/') {
+            normal.pop_back();
+        }
+        includePaths.push_back(normal);
+    }
+}
+
+std::unordered_map<std::string, std::string> IncludeScanner::parseMacroDefinitions(const std::string& text) {
+    std::unordered_map<std::string, std::string> macros;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.rfind("#define ", 0) != 0) {
+            continue;
+        }
+        std::string name = leadingIdentifier(line.substr(8));
+        size_t end = 8 + name.size();
+        if (name.empty()) {
+            continue;
+        }
+        macros[name] = end < line.size() && line[end] == '(' ? functionLikeValue : trimText(line.substr(end));
+    }
+    return macros;
+}
+
+bool IncludeScanner::isFile(const std::string& path) const {
+    {
+        std::lock_guard<std::mutex> lock(existsMutex);
+        auto it = existsCache.find(path);
+        if (it != existsCache.end()) {
+            return it->second;
+        }
+    }
+    std::error_code ec;
+    bool exists = std::filesystem::is_regular_file(path, ec);
+    std::lock_guard<std::mutex> lock(existsMutex);
+    existsCache[path] = exists;
+    return exists;
+}
+
+std::string IncludeScanner::resolve(const std::string& name, bool angled, bool next, const std::string& includer) const {
+    size_t first = 0;
+    if (next) {
+        // Resume after the include path the includer lives in, the most
+        // specific one when several contain it. Outside all of them
+        // #include_next searches like #include.
+        size_t longest = 0;
+        for (size_t i = 0; i < includePaths.size(); ++i) {
+            std::filesystem::path relative = std::filesystem::path(includer).lexically_relative(includePaths[i]);
+            if (!relative.empty() && *relative.begin() != ".." && includePaths[i].size() + 1 > longest) {
+                longest = includePaths[i].size() + 1;
+                first = i + 1;
+            }
+        }
+    } else if (!angled) {
+        std::string candidate = (std::filesystem::path(includer).parent_path() / name).lexically_normal().string();
+        if (isFile(candidate)) {
+            return candidate;
+        }
+    }
+    for (size_t i = first; i < includePaths.size(); ++i) {
+        std::string candidate = (std::filesystem::path(includePaths[i]) / name).lexically_normal().string();
+        if (isFile(candidate)) {
+            return candidate;
+        }
+    }
+    return "";
+}
+
+std::vector<std::string> IncludeScanner::scanFile(const std::string& path) {
+    std::vector<std::string> found;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return found;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return found;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return found;
+    }
+    scannedCount++;
+
+    DirectiveState state(predefinedMacros, [&](const std::string& header, bool next) {
+        std::string name;
+        bool angled = false;
+        return parseHeaderName(header, name, angled) && !resolve(name, angled, next, path).empty();
+    });
+    forEachDirective(static_cast<const char*>(mapped), size, [&](const std::string& text) {
+        std::string line = trimText(text);
+        std::string keyword = leadingIdentifier(line);
+        std::string rest = trimText(line.substr(keyword.size()));
+
+        if (keyword == "include" || keyword == "include_next") {
+            if (!state.isActive()) {
+                return;
+            }
+            if (!rest.empty() && rest[0] != '"' && rest[0] != '<') {
+                rest = trimText(state.lookup(leadingIdentifier(rest)));  // #include MACRO
+            }
+            std::string name;
+            bool angled = false;
+            if (parseHeaderName(rest, name, angled)) {
+                std::string resolved = resolve(name, angled, keyword == "include_next", path);
+                if (!resolved.empty()) {
+                    found.push_back(std::move(resolved));
+                }
+            }
+        } else if (keyword == "if") {
+            state.push(state.isActive() ? state.evaluate(rest) : Truth::False);
+        } else if (keyword == "ifdef" || keyword == "ifndef") {
+            Truth defined = state.isActive() ? state.isDefined(leadingIdentifier(rest)) : Truth::False;
+            state.push(keyword == "ifndef" && state.isActive() ? negate(defined) : defined);
+        } else if (keyword == "elif") {
+            state.branch(state.canTakeBranch() ? state.evaluate(rest) : Truth::False);
+        } else if (keyword == "elifdef" || keyword == "elifndef") {
+            Truth defined = state.canTakeBranch() ? state.isDefined(leadingIdentifier(rest)) : Truth::False;
+            state.branch(keyword == "elifndef" && state.canTakeBranch() ? negate(defined) : defined);
+        } else if (keyword == "else") {
+            state.branch(Truth::True);
+        } else if (keyword == "endif") {
+            state.pop();
+        } else if (keyword == "define" && state.isActive()) {
+            std::string name = leadingIdentifier(rest);
+            bool functionLike = name.size() < rest.size() && rest[name.size()] == '(';
+            state.define(name, functionLike ? functionLikeValue : trimText(rest.substr(name.size())));
+        } else if (keyword == "undef" && state.isActive()) {
+            state.define(leadingIdentifier(rest), undefinedValue);
+        }
+    });
+    ::munmap(mapped, size);
+
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    return found;
+}
+
+void IncludeScanner::scanAll(const std::vector<std::string>& sources, ThreadPool& threadPool) {
+    std::condition_variable done;
+    size_t pending = 0;
+    std::function<void(const std::string&)> schedule;
+    schedule = [&](const std::string& path) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!includes.emplace(path, std::vector<std::string>()).second) {
+                return;  // already scanned or claimed by another task
+            }
+            pending++;
+        }
+        threadPool.enqueue([&, path] {
+            std::vector<std::string> found = scanFile(path);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                includes[path] = found;
+            }
+            for (const auto& header : found) {
+                schedule(header);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                done.notify_all();
+            }
+        });
+    };
+    for (const auto& source : sources) {
+        schedule(source);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+}
+
+std::set<std::string> IncludeScanner::getDependencies(const std::string& source) {
+    std::set<std::string> dependencies;
+    std::vector<std::string> pending = {source};
+    while (!pending.empty()) {
+        std::string path = std::move(pending.back());
+        pending.pop_back();
+        for (auto& header : getIncludes(path)) {
+            if (header != source && dependencies.insert(header).second) {
+                pending.push_back(std::move(header));
+            }
+        }
+    }
+    return dependencies;
+}
+
+std::vector<std::string> IncludeScanner::getIncludes(const std::string& file) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = includes.find(file);
+        if (it != includes.end()) {
+            return it->second;
+        }
+    }
+    std::vector<std::string> direct = scanFile(file);
+    std::lock_guard<std::mutex> lock(mutex);
+    includes[file] = direct;
+    return direct;
+}
+
+}
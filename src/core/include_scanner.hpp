@@ -0,0 +1,57 @@
+#pragma once
+#include "thread_pool.hpp"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OreoBuild {
+
+// Predicts the headers a translation unit reads without running the
+// compiler, for sources that have no depfile yet. Files are memory-mapped and
+// directive lines located with SIMD. #if/#ifdef/#elif are evaluated against
+// the compiler's predefined macros and the macros the file itself defines; a
+// condition on any other macro may be decided by an includer, so all of its
+// branches count. The prediction may therefore list a header too many, but
+// should not miss one.
+//
+// Lookup follows the compiler: quoted includes try the includer's directory
+// first, #include_next resumes after the include path the current file lives
+// in, and angled includes found in no include path are system headers and
+// ignored. A scanner scans each file at most once, so a build uses a fresh
+// one and a shared header costs one scan however many sources reach it.
+class IncludeScanner {
+public:
+    IncludeScanner(const std::vector<std::string>& includePaths,
+                   std::unordered_map<std::string, std::string> predefinedMacros);
+
+    // Scans sources and every header they reach, in parallel on threadPool.
+    void scanAll(const std::vector<std::string>& sources, ThreadPool& threadPool);
+    // Every header source reaches, transitively; scans whatever scanAll()
+    // has not.
+    std::set<std::string> getDependencies(const std::string& source);
+    // Resolved direct includes of file; scans it unless already scanned.
+    std::vector<std::string> getIncludes(const std::string& file);
+    size_t getScannedCount() const { return scannedCount; }
+
+    // Reads the "#define NAME VALUE" lines "-dM -E" prints.
+    static std::unordered_map<std::string, std::string> parseMacroDefinitions(const std::string& text);
+
+private:
+    std::vector<std::string> includePaths;
+    std::unordered_map<std::string, std::string> predefinedMacros;
+    std::mutex mutex;
+    // Resolved direct includes of every file claimed for scanning.
+    std::unordered_map<std::string, std::vector<std::string>> includes;
+    mutable std::mutex existsMutex;
+    mutable std::unordered_map<std::string, bool> existsCache;
+    std::atomic<size_t> scannedCount{0};
+
+    std::vector<std::string> scanFile(const std::string& path);
+    std::string resolve(const std::string& name, bool angled, bool next, const std::string& includer) const;
+    bool isFile(const std::string& path) const;
+};
+
+}
@@ -0,0 +1,183 @@
+#include "json.hpp"
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+namespace OreoBuild {
+
+namespace {
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text(text) {}
+
+    bool parse(JsonValue& value) {
+        return parseValue(value, 0) && (skipWhitespace(), pos == text.size());
+    }
+
+private:
+    static const int maxDepth = 64;
+    const std::string& text;
+    size_t pos = 0;
+
+    void skipWhitespace() {
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) {
+            ++pos;
+        }
+    }
+
+    bool consume(char c) {
+        skipWhitespace();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > maxDepth) {
+            return false;
+        }
+        skipWhitespace();
+        if (pos >= text.size()) {
+            return false;
+        }
+        char c = text[pos];
+        if (c == '{') {
+            ++pos;
+            value.type = JsonValue::Type::Object;
+            if (consume('}')) {
+                return true;
+            }
+            do {
+                std::string key;
+                skipWhitespace();
+                if (!parseString(key) || !consume(':')) {
+                    return false;
+                }
+                value.object.emplace_back(std::move(key), JsonValue());
+                if (!parseValue(value.object.back().second, depth + 1)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            ++pos;
+            value.type = JsonValue::Type::Array;
+            if (consume(']')) {
+                return true;
+            }
+            do {
+                value.array.emplace_back();
+                if (!parseValue(value.array.back(), depth + 1)) {
+                    return false;
+                }
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = JsonValue::Type::String;
+            return parseString(value.string);
+        }
+        if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 5, "false") == 0) {
+            value.type = JsonValue::Type::Bool;
+            value.number = text[pos] == 't' ? 1 : 0;
+            pos += text[pos] == 't' ? 4 : 5;
+            return true;
+        }
+        if (text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+            return true;
+        }
+        const char* begin = text.c_str() + pos;
+        char* end = nullptr;
+        value.number = std::strtod(begin, &end);
+        if (end == begin) {
+            return false;
+        }
+        value.type = JsonValue::Type::Number;
+        pos += end - begin;
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (pos >= text.size() || text[pos] != '"') {
+            return false;
+        }
+        ++pos;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                return false;
+            }
+            char escape = text[pos++];
+            switch (escape) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (pos + 4 > text.size()) {
+                        return false;
+                    }
+                    unsigned long code = std::strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+                    pos += 4;
+                    // Paths and symbol names are ASCII in practice; encode the
+                    // rest as UTF-8 without pairing surrogates.
+                    if (code < 0x80) {
+                        out += static_cast<char>(code);
+                    } else if (code < 0x800) {
+                        out += static_cast<char>(0xC0 | (code >> 6));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    } else {
+                        out += static_cast<char>(0xE0 | (code >> 12));
+                        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                        out += static_cast<char>(0x80 | (code & 0x3F));
+                    }
+                    break;
+                }
+                default: out += escape; break;
+            }
+        }
+        if (pos >= text.size()) {
+            return false;
+        }
+        ++pos;
+        return true;
+    }
+};
+
+}
+
+bool Json::parse(const std::string& text, JsonValue& value) {
+    return JsonParser(text).parse(value);
+}
+
+std::string Json::escape(const std::string& text) {
+    std::ostringstream stream;
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': stream << "\\\""; break;
+            case '\\': stream << "\\\\"; break;
+            case '\n': stream << "\\n"; break;
+            case '\r': stream << "\\r"; break;
+            case '\t': stream << "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                } else {
+                    stream << c;
+                }
+        }
+    }
+    return stream.str();
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace OreoBuild {
+
+// Just enough JSON to read compiler-generated files (time traces, P1689
+// dependency scans) and to quote strings in the JSON oreobuild writes.
+// Object members keep their order.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    const JsonValue* find(const std::string& key) const {
+        for (const auto& member : object) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class Json {
+public:
+    static bool parse(const std::string& text, JsonValue& value);
+    // text with quotes, backslashes and control characters escaped, ready
+    // to go between double quotes.
+    static std::string escape(const std::string& text);
+};
+
+}
@@ -0,0 +1,393 @@
+#include "logger.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace OreoBuild {
+
+namespace {
+
+// Single-producer/single-consumer ring: the owning thread pushes, the writer
+// thread pops. Indices only ever move forward, so no lock is needed.
+class LogRingBuffer {
+public:
+    static const size_t capacity = 1024;
+
+    explicit LogRingBuffer(uint32_t thread) : thread(thread) {}
+
+    bool tryPush(LogRecord& record) {
+        size_t current = head.load(std::memory_order_relaxed);
+        size_t next = (current + 1) % capacity;
+        if (next == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots[current] = std::move(record);
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(LogRecord& record) {
+        size_t current = tail.load(std::memory_order_relaxed);
+        if (current == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        record = std::move(slots[current]);
+        tail.store((current + 1) % capacity, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+    }
+
+    const uint32_t thread;
+
+private:
+    LogRecord slots[capacity];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
+class LoggerState {
+public:
+    LoggerState() {
+        sinks.push_back(std::make_unique<TerminalSink>());
+    }
+
+    ~LoggerState() {
+        stop();
+    }
+
+    void addSink(std::unique_ptr<LogSink> sink) {
+        flush();
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        sinks.push_back(std::move(sink));
+    }
+
+    void write(LogRecord record) {
+        record.sequence = sequence.fetch_add(1, std::memory_order_relaxed);
+        if (stopped.load(std::memory_order_acquire)) {
+            // Late messages during shutdown bypass the queue.
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            dispatch(record);
+            return;
+        }
+
+        LogRingBuffer& buffer = localBuffer();
+        while (!buffer.tryPush(record)) {
+            // Ring is full: wake the writer and give it a moment to catch up
+            // rather than dropping build output.
+            wakeWriter();
+            std::this_thread::yield();
+        }
+        if (record.level <= LogLevel::Warning) {
+            wakeWriter();
+        }
+    }
+
+    void flush() {
+        if (!writerStarted.load(std::memory_order_acquire) || stopped.load(std::memory_order_acquire)) {
+            return;
+        }
+        wakeWriter();
+        while (!drained()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    void stop() {
+        if (stopped.exchange(true)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        if (writer.joinable()) {
+            writer.join();
+        }
+        std::lock_guard<std::mutex> lock(sinkMutex);
+        for (auto& sink : sinks) {
+            sink->flush();
+        }
+    }
+
+private:
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<LogRingBuffer>> buffers;
+    uint32_t nextThread = 0;
+
+    std::mutex sinkMutex;
+    std::vector<std::unique_ptr<LogSink>> sinks;
+
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<bool> writerBusy{false};
+    std::atomic<bool> writerStarted{false};
+    std::atomic<bool> stopped{false};
+    std::once_flag writerOnce;
+    std::thread writer;
+
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+    bool wakeRequested = false;
+    bool stopping = false;
+
+    LogRingBuffer& localBuffer() {
+        thread_local std::shared_ptr<LogRingBuffer> buffer;
+        if (!buffer) {
+            std::call_once(writerOnce, [this] {
+                writer = std::thread(&LoggerState::writerLoop, this);
+                writerStarted.store(true, std::memory_order_release);
+            });
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffer = std::make_shared<LogRingBuffer>(nextThread++);
+            buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void wakeWriter() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeRequested = true;
+        }
+        wakeCondition.notify_one();
+    }
+
+    bool drained() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : buffers) {
+            if (!buffer->empty()) {
+                return false;
+            }
+        }
+        return !writerBusy.load();
+    }
+
+    void writerLoop() {
+        std::vector<LogRecord> batch;
+        while (true) {
+            bool exiting;
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex);
+                wakeCondition.wait_for(lock, std::chrono::milliseconds(2), [this] { return wakeRequested || stopping; });
+                wakeRequested = false;
+                exiting = stopping;
+            }
+            drainOnce(batch);
+            if (exiting) {
+                drainOnce(batch);
+                return;
+            }
+        }
+    }
+
+    void drainOnce(std::vector<LogRecord>& batch) {
+        writerBusy.store(true);
+        std::vector<std::shared_ptr<LogRingBuffer>> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            // Forget rings whose threads have exited once they are empty.
+            buffers.erase(std::remove_if(buffers.begin(), buffers.end(), [](const std::shared_ptr<LogRingBuffer>& buffer) {
+                              return buffer.use_count() == 1 && buffer->empty();
+                          }),
+                          buffers.end());
+            snapshot = buffers;
+        }
+
+        batch.clear();
+        LogRecord record;
+        for (const auto& buffer : snapshot) {
+            while (buffer->tryPop(record)) {
+                record.thread = buffer->thread;
+                batch.push_back(std::move(record));
+            }
+        }
+
+        if (!batch.empty()) {
+            std::sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) { return a.sequence < b.sequence; });
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            for (const auto& entry : batch) {
+                dispatch(entry);
+            }
+            for (auto& sink : sinks) {
+                sink->flush();
+            }
+        }
+        writerBusy.store(false);
+    }
+
+    void dispatch(const LogRecord& record) {
+        for (auto& sink : sinks) {
+            sink->write(record);
+        }
+    }
+};
+
+LoggerState& state() {
+    static LoggerState instance;
+    return instance;
+}
+
+std::string stripAnsi(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\033' && i + 1 < text.size() && text[i + 1] == '[') {
+            i += 2;
+            while (i < text.size() && !std::isalpha(static_cast<unsigned char>(text[i]))) {
+                ++i;
+            }
+            continue;
+        }
+        result += text[i];
+    }
+    return result;
+}
+
+std::string formatTime(std::chrono::system_clock::time_point time) {
+    std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count() % 1000;
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    std::ostringstream stream;
+    stream << std::put_time(&local, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(3) << std::setfill('0') << millis;
+    return stream.str();
+}
+
+const struct {
+    const char* name;
+    LogCategory category;
+} categoryNames[] = {
+    {"general", LogCategory::General},
+    {"config", LogCategory::Config},
+    {"deps", LogCategory::Deps},
+    {"compile", LogCategory::Compile},
+    {"link", LogCategory::Link},
+    {"cache", LogCategory::Cache},
+    {"distributed", LogCategory::Distributed}
+};
+
+}
+
+void TerminalSink::write(const LogRecord& record) {
+    std::ostream& stream = record.level <= LogLevel::Warning ? std::cerr : std::cout;
+    stream << record.message << '\n';
+}
+
+void TerminalSink::flush() {
+    std::cout.flush();
+    std::cerr.flush();
+}
+
+FileSink::FileSink(const std::string& path) : file(path, std::ios::app) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open log file: " + path);
+    }
+}
+
+void FileSink::write(const LogRecord& record) {
+    file << formatTime(record.time) << " [" << Logger::levelName(record.level) << "] ["
+         << Logger::categoryName(record.category) << "] [t" << record.thread << "] "
+         << stripAnsi(record.message) << '\n';
+}
+
+void FileSink::flush() {
+    file.flush();
+}
+
+JsonSink::JsonSink(const std::string& path) : file(path, std::ios::app) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open structured log file: " + path);
+    }
+}
+
+void JsonSink::write(const LogRecord& record) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch()).count();
+    file << "{\"ts_us\":" << micros
+         << ",\"level\":\"" << Logger::levelName(record.level)
+         << "\",\"category\":\"" << Logger::categoryName(record.category)
+         << "\",\"thread\":" << record.thread
+         << ",\"msg\":\"" << Json::escape(stripAnsi(record.message)) << "\"}\n";
+}
+
+void JsonSink::flush() {
+    file.flush();
+}
+
+uint32_t Logger::parseCategories(const std::string& list) {
+    uint32_t mask = 0;
+    std::istringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (name.empty()) {
+            continue;
+        }
+        if (name == "all") {
+            return ~0u;
+        }
+        bool found = false;
+        for (const auto& entry : categoryNames) {
+            if (name == entry.name) {
+                mask |= static_cast<uint32_t>(entry.category);
+                found = true;
+            }
+        }
+        if (!found) {
+            throw std::runtime_error("Unknown log category: " + name);
+        }
+    }
+    return mask;
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Error: return "error";
+        case LogLevel::Warning: return "warning";
+        case LogLevel::Info: return "info";
+        case LogLevel::Verbose: return "verbose";
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Trace: return "trace";
+    }
+    return "unknown";
+}
+
+const char* Logger::categoryName(LogCategory category) {
+    for (const auto& entry : categoryNames) {
+        if (entry.category == category) {
+            return entry.name;
+        }
+    }
+    return "unknown";
+}
+
+void Logger::addSink(std::unique_ptr<LogSink> sink) {
+    state().addSink(std::move(sink));
+}
+
+void Logger::write(LogLevel level, LogCategory category, std::string message) {
+    LogRecord record;
+    record.level = level;
+    record.category = category;
+    record.time = std::chrono::system_clock::now();
+    record.message = std::move(message);
+    state().write(std::move(record));
+}
+
+void Logger::flush() {
+    state().flush();
+}
+
+void Logger::shutdown() {
+    state().stop();
+}
+
+}
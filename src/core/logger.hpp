@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace OreoBuild {
+
+enum class LogLevel : int {
+    Error = 0,
+    Warning,
+    Info,
+    Verbose,
+    Debug,
+    Trace
+};
+
+// Bit flags so that a set of categories fits in one atomic word.
+enum class LogCategory : uint32_t {
+    General     = 1u << 0,
+    Config      = 1u << 1,
+    Deps        = 1u << 2,
+    Compile     = 1u << 3,
+    Link        = 1u << 4,
+    Cache       = 1u << 5,
+    Distributed = 1u << 6
+};
+
+struct LogRecord {
+    LogLevel level = LogLevel::Info;
+    LogCategory category = LogCategory::General;
+    std::chrono::system_clock::time_point time;
+    uint64_t sequence = 0;
+    uint32_t thread = 0;
+    std::string message;
+};
+
+class LogSink {
+public:
+    virtual ~LogSink() = default;
+    virtual void write(const LogRecord& record) = 0;
+    virtual void flush() = 0;
+};
+
+// Info and below go to stdout, warnings and errors to stderr, unmodified.
+class TerminalSink : public LogSink {
+public:
+    void write(const LogRecord& record) override;
+    void flush() override;
+};
+
+// Plain-text log file with timestamps; ANSI colour codes are stripped.
+class FileSink : public LogSink {
+public:
+    explicit FileSink(const std::string& path);
+    void write(const LogRecord& record) override;
+    void flush() override;
+
+private:
+    std::ofstream file;
+};
+
+// One JSON object per line, for tools that post-process build logs.
+class JsonSink : public LogSink {
+public:
+    explicit JsonSink(const std::string& path);
+    void write(const LogRecord& record) override;
+    void flush() override;
+
+private:
+    std::ofstream file;
+};
+
+// Asynchronous logger. Each producing thread appends to its own lock-free
+// single-producer ring buffer; one background thread drains all rings in
+// order and hands the records to the sinks. Level and category checks are
+// two relaxed atomic loads, done at the call site by OREO_LOG before any
+// message formatting happens. Categories only filter verbose and below.
+class Logger {
+public:
+    static bool isEnabled(LogLevel level, LogCategory category) {
+        return static_cast<int>(level) <= threshold.load(std::memory_order_relaxed) &&
+               (level <= LogLevel::Info ||
+                (categoryMask.load(std::memory_order_relaxed) & static_cast<uint32_t>(category)) != 0);
+    }
+
+    static void setLevel(LogLevel level) { threshold.store(static_cast<int>(level), std::memory_order_relaxed); }
+    static void setCategoryMask(uint32_t mask) { categoryMask.store(mask, std::memory_order_relaxed); }
+    // Parses a comma separated list such as "deps,compile"; throws on unknown names.
+    static uint32_t parseCategories(const std::string& list);
+    static const char* levelName(LogLevel level);
+    static const char* categoryName(LogCategory category);
+
+    static void addSink(std::unique_ptr<LogSink> sink);
+    static void write(LogLevel level, LogCategory category, std::string message);
+    // Blocks until every record written so far has reached the sinks.
+    static void flush();
+    static void shutdown();
+
+private:
+    inline static std::atomic<int> threshold{static_cast<int>(LogLevel::Info)};
+    inline static std::atomic<uint32_t> categoryMask{~0u};
+};
+
+// Collects one message with stream syntax and submits it on destruction.
+class LogLine {
+public:
+    LogLine(LogLevel level, LogCategory category) : level(level), category(category) {}
+    ~LogLine() { Logger::write(level, category, stream.str()); }
+
+    template <typename T>
+    LogLine& operator<<(const T& value) {
+        stream << value;
+        return *this;
+    }
+
+private:
+    LogLevel level;
+    LogCategory category;
+    std::ostringstream stream;
+};
+
+}
+
+#define OREO_LOG(level, category, message)                                         \
+    do {                                                                           \
+        if (::OreoBuild::Logger::isEnabled(level, category)) {                     \
+            ::OreoBuild::LogLine(level, category) << message;                      \
+        }                                                                          \
+    } while (0)
+
+#define OREO_ERROR(category, message) OREO_LOG(::OreoBuild::LogLevel::Error, category, message)
+#define OREO_WARN(category, message) OREO_LOG(::OreoBuild::LogLevel::Warning, category, message)
+#define OREO_INFO(category, message) OREO_LOG(::OreoBuild::LogLevel::Info, category, message)
+#define OREO_VERBOSE(category, message) OREO_LOG(::OreoBuild::LogLevel::Verbose, category, message)
+#define OREO_DEBUG(category, message) OREO_LOG(::OreoBuild::LogLevel::Debug, category, message)
+#define OREO_TRACE(category, message) OREO_LOG(::OreoBuild::LogLevel::Trace, category, message)
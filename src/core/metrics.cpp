@@ -0,0 +1,221 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <locale>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace OreoBuild {
+
+namespace {
+
+struct Definition {
+    const char* name;
+    const char* help;
+};
+
+// Indexed by the enums; every exported name gets the "oreobuild_" prefix.
+const Definition counterDefinitions[] = {
+    {"builds", "Builds run, one per variant."},
+    {"noop_builds", "Builds that found everything up to date."},
+    {"compiles", "Translation units compiled."},
+    {"compile_failures", "Compiles that failed."},
+    {"units_up_to_date", "Translation units whose object was already up to date."},
+    {"cache_hits", "Remote cache lookups that restored the outputs."},
+    {"cache_misses", "Remote cache lookups that found nothing."},
+    {"links", "Links run."},
+    {"worker_busy_seconds", "Time worker threads spent running steps."},
+};
+
+const Definition gaugeDefinitions[] = {
+    {"success", "1 when the command succeeded."},
+    {"duration_seconds", "Wall time of the command."},
+    {"workers", "Worker threads running steps."},
+};
+
+const Definition histogramDefinitions[] = {
+    {"compile_duration_seconds", "Time per successful compile."},
+    {"link_duration_seconds", "Time per successful link."},
+    {"queue_wait_seconds", "Time a step waited for its pool and a worker."},
+    {"noop_check_duration_seconds", "Time the up-to-date check of a build took."},
+};
+
+// Upper bounds in seconds, spelled as OpenMetrics wants them in "le".
+const struct {
+    double bound;
+    const char* label;
+} buckets[] = {
+    {0.001, "0.001"}, {0.005, "0.005"}, {0.01, "0.01"}, {0.05, "0.05"}, {0.1, "0.1"}, {0.5, "0.5"},
+    {1, "1.0"}, {2.5, "2.5"}, {5, "5.0"}, {10, "10.0"}, {30, "30.0"}, {60, "60.0"}, {120, "120.0"}, {300, "300.0"},
+};
+
+std::mutex histogramMutex;
+std::vector<double> observations[static_cast<size_t>(Histogram::Count)];
+
+struct Snapshot {
+    uint64_t counters[static_cast<size_t>(Counter::Count)];
+    double gauges[static_cast<size_t>(Gauge::Count)];
+    std::vector<double> histograms[static_cast<size_t>(Histogram::Count)];  // sorted
+    double cacheHitRatio = 0;
+    double workerUtilization = 0;
+    double timestamp = 0;
+
+    uint64_t counter(Counter c) const { return counters[static_cast<size_t>(c)]; }
+    double gauge(Gauge g) const { return gauges[static_cast<size_t>(g)]; }
+    const std::vector<double>& histogram(Histogram h) const { return histograms[static_cast<size_t>(h)]; }
+};
+
+double busySeconds(const Snapshot& snapshot) {
+    return snapshot.counter(Counter::WorkerBusyMicros) / 1e6;
+}
+
+Snapshot takeSnapshot(const std::atomic<uint64_t>* counters, const std::atomic<double>* gauges) {
+    Snapshot snapshot;
+    for (size_t i = 0; i < static_cast<size_t>(Counter::Count); ++i) {
+        snapshot.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < static_cast<size_t>(Gauge::Count); ++i) {
+        snapshot.gauges[i] = gauges[i].load(std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(histogramMutex);
+        for (size_t i = 0; i < static_cast<size_t>(Histogram::Count); ++i) {
+            snapshot.histograms[i] = observations[i];
+        }
+    }
+    for (auto& values : snapshot.histograms) {
+        std::sort(values.begin(), values.end());
+    }
+    uint64_t lookups = snapshot.counter(Counter::CacheHits) + snapshot.counter(Counter::CacheMisses);
+    if (lookups > 0) {
+        snapshot.cacheHitRatio = static_cast<double>(snapshot.counter(Counter::CacheHits)) / lookups;
+    }
+    double capacity = snapshot.gauge(Gauge::DurationSeconds) * snapshot.gauge(Gauge::Workers);
+    if (capacity > 0) {
+        snapshot.workerUtilization = std::min(1.0, busySeconds(snapshot) / capacity);
+    }
+    snapshot.timestamp = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return snapshot;
+}
+
+// Nearest-rank percentile of sorted values; 0 when there are none.
+double percentile(const std::vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(std::ceil(fraction * values.size()));
+    return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+std::ostringstream makeStream() {
+    std::ostringstream stream;
+    stream.imbue(std::locale::classic());
+    stream.precision(9);
+    return stream;
+}
+
+}
+
+void Metrics::observe(Histogram histogram, double seconds) {
+    std::lock_guard<std::mutex> lock(histogramMutex);
+    observations[static_cast<size_t>(histogram)].push_back(seconds);
+}
+
+std::string Metrics::toOpenMetrics() {
+    Snapshot snapshot = takeSnapshot(counters, gauges);
+    std::ostringstream out = makeStream();
+    auto header = [&](const std::string& name, const char* type, const char* help, bool seconds) {
+        out << "# TYPE " << name << " " << type << "\n";
+        if (seconds) {
+            out << "# UNIT " << name << " seconds\n";
+        }
+        out << "# HELP " << name << " " << help << "\n";
+    };
+
+    for (size_t i = 0; i < static_cast<size_t>(Counter::Count); ++i) {
+        std::string name = std::string("oreobuild_") + counterDefinitions[i].name;
+        bool seconds = static_cast<Counter>(i) == Counter::WorkerBusyMicros;
+        header(name, "counter", counterDefinitions[i].help, seconds);
+        out << name << "_total ";
+        if (seconds) {
+            out << busySeconds(snapshot) << "\n";
+        } else {
+            out << snapshot.counters[i] << "\n";
+        }
+    }
+    for (size_t i = 0; i < static_cast<size_t>(Gauge::Count); ++i) {
+        std::string name = std::string("oreobuild_") + gaugeDefinitions[i].name;
+        header(name, "gauge", gaugeDefinitions[i].help, static_cast<Gauge>(i) == Gauge::DurationSeconds);
+        out << name << " " << snapshot.gauges[i] << "\n";
+    }
+    header("oreobuild_cache_hit_ratio", "gauge", "Share of remote cache lookups that hit.", false);
+    out << "oreobuild_cache_hit_ratio " << snapshot.cacheHitRatio << "\n";
+    header("oreobuild_worker_utilization_ratio", "gauge", "Busy time over wall time times workers.", false);
+    out << "oreobuild_worker_utilization_ratio " << snapshot.workerUtilization << "\n";
+    header("oreobuild_last_run_timestamp_seconds", "gauge", "When these metrics were written.", true);
+    out << "oreobuild_last_run_timestamp_seconds " << std::fixed << std::setprecision(3) << snapshot.timestamp
+        << std::defaultfloat << std::setprecision(9) << "\n";
+
+    for (size_t i = 0; i < static_cast<size_t>(Histogram::Count); ++i) {
+        std::string name = std::string("oreobuild_") + histogramDefinitions[i].name;
+        const auto& values = snapshot.histograms[i];
+        header(name, "histogram", histogramDefinitions[i].help, true);
+        double sum = 0;
+        for (double value : values) {
+            sum += value;
+        }
+        for (const auto& bucket : buckets) {
+            size_t below = std::upper_bound(values.begin(), values.end(), bucket.bound) - values.begin();
+            out << name << "_bucket{le=\"" << bucket.label << "\"} " << below << "\n";
+        }
+        out << name << "_bucket{le=\"+Inf\"} " << values.size() << "\n";
+        out << name << "_count " << values.size() << "\n";
+        out << name << "_sum " << sum << "\n";
+    }
+    out << "# EOF\n";
+    return out.str();
+}
+
+std::string Metrics::toJson() {
+    Snapshot snapshot = takeSnapshot(counters, gauges);
+    std::ostringstream out = makeStream();
+    auto summary = [&](Histogram histogram) {
+        const auto& values = snapshot.histogram(histogram);
+        double sum = 0;
+        for (double value : values) {
+            sum += value;
+        }
+        out << "{\"count\":" << values.size() << ",\"sum\":" << sum << ",\"p50\":" << percentile(values, 0.5)
+            << ",\"p90\":" << percentile(values, 0.9) << ",\"p99\":" << percentile(values, 0.99)
+            << ",\"max\":" << (values.empty() ? 0 : values.back()) << "}";
+    };
+
+    out << "{\"schema\":1"
+        << ",\"success\":" << (snapshot.gauge(Gauge::Success) > 0 ? "true" : "false")
+        << ",\"durationSeconds\":" << snapshot.gauge(Gauge::DurationSeconds)
+        << ",\"timestamp\":" << std::fixed << std::setprecision(3) << snapshot.timestamp
+        << std::defaultfloat << std::setprecision(9)
+        << ",\"builds\":{\"total\":" << snapshot.counter(Counter::Builds)
+        << ",\"noOp\":" << snapshot.counter(Counter::NoOpBuilds) << ",\"noOpCheckSeconds\":";
+    summary(Histogram::NoOpCheckSeconds);
+    out << "},\"compiles\":{\"total\":" << snapshot.counter(Counter::Compiles)
+        << ",\"failed\":" << snapshot.counter(Counter::CompileFailures)
+        << ",\"upToDate\":" << snapshot.counter(Counter::UnitsUpToDate) << ",\"seconds\":";
+    summary(Histogram::CompileSeconds);
+    out << "},\"links\":{\"total\":" << snapshot.counter(Counter::Links) << ",\"seconds\":";
+    summary(Histogram::LinkSeconds);
+    out << "},\"cache\":{\"hits\":" << snapshot.counter(Counter::CacheHits)
+        << ",\"misses\":" << snapshot.counter(Counter::CacheMisses)
+        << ",\"hitRatio\":" << snapshot.cacheHitRatio
+        << "},\"queueWaitSeconds\":";
+    summary(Histogram::QueueWaitSeconds);
+    out << ",\"workers\":{\"count\":" << snapshot.gauge(Gauge::Workers)
+        << ",\"busySeconds\":" << busySeconds(snapshot)
+        << ",\"utilization\":" << snapshot.workerUtilization << "}}\n";
+    return out.str();
+}
+
+}
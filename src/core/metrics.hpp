@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace OreoBuild {
+
+enum class Counter {
+    Builds,
+    NoOpBuilds,
+    Compiles,
+    CompileFailures,
+    UnitsUpToDate,
+    CacheHits,
+    CacheMisses,
+    Links,
+    WorkerBusyMicros,
+    Count
+};
+
+enum class Gauge {
+    Success,
+    DurationSeconds,
+    Workers,
+    Count
+};
+
+enum class Histogram {
+    CompileSeconds,
+    LinkSeconds,
+    QueueWaitSeconds,
+    NoOpCheckSeconds,
+    Count
+};
+
+// Counters, gauges and histograms describing one oreobuild run. The build
+// updates them as steps finish; toOpenMetrics() and toJson() render the same
+// snapshot, for a textfile collector and as a JSON summary whose layout stays
+// put across releases ("schema" changes when it does not). Counters and
+// gauges are relaxed atomics. Histograms keep every observation, so the JSON
+// percentiles are exact.
+class Metrics {
+public:
+    static void add(Counter counter, uint64_t amount = 1) {
+        counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    }
+    static void set(Gauge gauge, double value) {
+        gauges[static_cast<size_t>(gauge)].store(value, std::memory_order_relaxed);
+    }
+    static void observe(Histogram histogram, double seconds);
+
+    static std::string toOpenMetrics();
+    static std::string toJson();
+
+private:
+    inline static std::atomic<uint64_t> counters[static_cast<size_t>(Counter::Count)] = {};
+    inline static std::atomic<double> gauges[static_cast<size_t>(Gauge::Count)] = {};
+};
+
+}
@@ -0,0 +1,285 @@
+#include "module_scanner.hpp"
+#include "json.hpp"
+#include "logger.hpp"
+#include "process.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace OreoBuild {
+
+namespace {
+
+const int cacheFormatVersion = 1;
+
+bool readFile(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+// Drops comments, string and character literals, and preprocessor lines,
+// leaving only the tokens that module declarations are made of.
+std::string stripForScan(const std::string& text) {
+    std::string result;
+    result.reserve(text.size());
+    bool lineStart = true;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '/' && i + 1 < text.size() && text[i + 1] == '/') {
+            while (i < text.size() && text[i] != '\n') {
+                ++i;
+            }
+            result += '\n';
+            lineStart = true;
+            continue;
+        }
+        if (c == '/' && i + 1 < text.size() && text[i + 1] == '*') {
+            size_t end = text.find("*/", i + 2);
+            i = end == std::string::npos ? text.size() : end + 1;
+            result += ' ';
+            continue;
+        }
+        if (lineStart && c == '#') {
+            // Skip the directive, honouring line continuations.
+            while (i < text.size() && (text[i] != '\n' || text[i - 1] == '\\')) {
+                ++i;
+            }
+            result += '\n';
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            char quote = c;
+            for (++i; i < text.size() && text[i] != quote; ++i) {
+                if (text[i] == '\\') {
+                    ++i;
+                }
+            }
+            result += "\"\"";
+            continue;
+        }
+        if (c == '\n') {
+            lineStart = true;
+        } else if (!std::isspace(static_cast<unsigned char>(c))) {
+            lineStart = false;
+        }
+        result += c;
+    }
+    return result;
+}
+
+std::string joinName(std::istringstream& tokens) {
+    std::string name, token;
+    while (tokens >> token) {
+        name += token;
+    }
+    return name;
+}
+
+}
+
+ModuleScanner::ModuleScanner(const std::string& cachePath) : cachePath(cachePath) {}
+
+void ModuleScanner::load() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.clear();
+    std::ifstream file(cachePath);
+    std::string line;
+    if (!std::getline(file, line) || line != "oreobuild-modules " + std::to_string(cacheFormatVersion)) {
+        return;
+    }
+    CacheEntry* current = nullptr;
+    while (std::getline(file, line)) {
+        std::istringstream iss(line);
+        std::string kind;
+        iss >> kind;
+        if (kind == "unit") {
+            std::string key, source;
+            iss >> key;
+            iss.get();
+            std::getline(iss, source);
+            current = &cache[source];
+            current->key = key;
+            current->unit = ModuleUnit();
+        } else if (current && kind == "provides") {
+            int interface = 0;
+            iss >> interface >> current->unit.provides;
+            current->unit.isInterface = interface != 0;
+        } else if (current && kind == "imports") {
+            std::string module;
+            iss >> module;
+            current->unit.imports.push_back(module);
+        }
+    }
+}
+
+void ModuleScanner::save() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream file(cachePath, std::ios::trunc);
+    if (!file.is_open()) {
+        OREO_WARN(LogCategory::Deps, "Warning: Unable to write module scan cache: " << cachePath);
+        return;
+    }
+    file << "oreobuild-modules " << cacheFormatVersion << '\n';
+    for (const auto& [source, entry] : cache) {
+        file << "unit " << entry.key << ' ' << source << '\n';
+        if (!entry.unit.provides.empty()) {
+            file << "provides " << (entry.unit.isInterface ? 1 : 0) << ' ' << entry.unit.provides << '\n';
+        }
+        for (const auto& module : entry.unit.imports) {
+            file << "imports " << module << '\n';
+        }
+    }
+}
+
+bool ModuleScanner::scan(const Compiler& compiler, const Config& config, const std::string& source,
+                         const std::string& object, const std::string& key, ModuleUnit& unit) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(source);
+        if (it != cache.end() && it->second.key == key) {
+            unit = it->second.unit;
+            return true;
+        }
+    }
+
+    unit = ModuleUnit();
+    bool scanned = false;
+    if (config.getModuleScanner() != "builtin" && !compilerScanFailed) {
+        scanned = scanWithCompiler(compiler, config, source, object, unit);
+    }
+    if (!scanned) {
+        unit = ModuleUnit();
+        if (!scanText(source, unit)) {
+            OREO_ERROR(LogCategory::Deps, "Unable to scan " << source << " for module declarations.");
+            return false;
+        }
+    }
+    OREO_DEBUG(LogCategory::Deps, "Scanned " << source << ": provides '" << unit.provides << "', imports "
+               << unit.imports.size() << " module(s)");
+    scannedCount++;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    cache[source] = CacheEntry{key, unit};
+    return true;
+}
+
+bool ModuleScanner::scanWithCompiler(const Compiler& compiler, const Config& config, const std::string& source,
+                                     const std::string& object, ModuleUnit& unit) {
+    std::string scanOutput = object + ".ddi";
+    std::string command = compiler.getModuleScanCommand(source, object, scanOutput, config);
+    if (command.empty()) {
+        return false;
+    }
+    std::filesystem::create_directories(std::filesystem::path(object).parent_path());
+    OREO_VERBOSE(LogCategory::Deps, "Scanning: " << command);
+    int result = Process::run(command);
+    std::string text;
+    bool parsed = result == 0 && readFile(scanOutput, text) && parseP1689(text, unit);
+    std::filesystem::remove(scanOutput);
+    if (!parsed && !compilerScanFailed.exchange(true)) {
+        // Older drivers (GCC before 14, or no clang-scan-deps) cannot write
+        // P1689; the textual scan handles the common cases.
+        OREO_WARN(LogCategory::Deps, "Warning: " << compiler.getName()
+                  << " could not scan module dependencies; using the built-in scanner"
+                  << " (set module_scanner = builtin to skip this check).");
+    }
+    return parsed;
+}
+
+bool ModuleScanner::scanText(const std::string& source, ModuleUnit& unit) {
+    std::string text;
+    if (!readFile(source, text)) {
+        return false;
+    }
+    std::string stripped = stripForScan(text);
+
+    std::string currentModule;
+    size_t start = 0;
+    while (start < stripped.size()) {
+        size_t end = stripped.find_first_of(";{}", start);
+        if (end == std::string::npos) {
+            break;
+        }
+        std::string statement = stripped.substr(start, end - start);
+        start = end + 1;
+        if (stripped[end] != ';') {
+            continue;
+        }
+
+        std::istringstream tokens(statement);
+        std::string keyword;
+        tokens >> keyword;
+        bool exported = keyword == "export";
+        if (exported) {
+            tokens >> keyword;
+        }
+
+        if (keyword == "module") {
+            std::string name = joinName(tokens);
+            if (name.empty() || name[0] == ':') {
+                continue;  // global module fragment or private fragment
+            }
+            currentModule = name.substr(0, name.find(':'));
+            if (exported || name.find(':') != std::string::npos) {
+                unit.provides = name;
+                unit.isInterface = exported;
+            } else {
+                // Implementation units implicitly import their interface.
+                unit.imports.push_back(name);
+            }
+        } else if (keyword == "import") {
+            std::string name = joinName(tokens);
+            if (name.empty() || name[0] == '<' || name[0] == '"') {
+                continue;  // header units are left to the compiler
+            }
+            if (name[0] == ':') {
+                name = currentModule + name;
+            }
+            unit.imports.push_back(name);
+        }
+    }
+    return true;
+}
+
+bool ModuleScanner::parseP1689(const std::string& text, ModuleUnit& unit) {
+    JsonValue root;
+    if (!Json::parse(text, root)) {
+        return false;
+    }
+    const JsonValue* rules = root.find("rules");
+    if (!rules || rules->type != JsonValue::Type::Array) {
+        return false;
+    }
+    for (const auto& rule : rules->array) {
+        if (const JsonValue* provides = rule.find("provides")) {
+            for (const auto& entry : provides->array) {
+                const JsonValue* name = entry.find("logical-name");
+                const JsonValue* interface = entry.find("is-interface");
+                if (name) {
+                    unit.provides = name->string;
+                    unit.isInterface = !interface || interface->number != 0;
+                }
+            }
+        }
+        if (const JsonValue* imports = rule.find("requires")) {
+            for (const auto& entry : imports->array) {
+                const JsonValue* name = entry.find("logical-name");
+                const JsonValue* lookup = entry.find("lookup-method");
+                if (name && (!lookup || lookup->string == "by-name")) {
+                    unit.imports.push_back(name->string);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "compiler.hpp"
+#include "config.hpp"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OreoBuild {
+
+struct ModuleUnit {
+    // Module or partition ("m:part") this unit provides; empty for importers.
+    std::string provides;
+    bool isInterface = false;
+    std::vector<std::string> imports;
+
+    bool usesModules() const { return !provides.empty() || !imports.empty(); }
+};
+
+// Module layout of the whole build, shared with the compilers.
+struct ModuleMap {
+    std::string bmiDir;
+    // GCC module mapper file listing "<module> <bmi>" for every module.
+    std::string mapperPath;
+    std::unordered_map<std::string, ModuleUnit> units;                    // by source
+    std::unordered_map<std::string, std::string> providers;               // module -> source
+    std::unordered_map<std::string, std::vector<std::string>> importers;  // module -> sources
+    std::unordered_map<std::string, std::string> bmiPaths;                // module -> BMI
+
+    const ModuleUnit* find(const std::string& source) const {
+        auto it = units.find(source);
+        return it == units.end() ? nullptr : &it->second;
+    }
+
+    std::string getBmiPath(const std::string& module) const {
+        auto it = bmiPaths.find(module);
+        return it == bmiPaths.end() ? std::string() : it->second;
+    }
+};
+
+// Finds each source's module declarations with the compiler's P1689 scanner,
+// or with a textual scan for drivers that have none. Results are cached per
+// variant under a key covering the source, its includes and the config, so
+// only changed sources are scanned again.
+class ModuleScanner {
+public:
+    explicit ModuleScanner(const std::string& cachePath);
+
+    void load();
+    void save() const;
+
+    // Thread-safe. Returns false when the source could not be scanned.
+    bool scan(const Compiler& compiler, const Config& config, const std::string& source,
+              const std::string& object, const std::string& key, ModuleUnit& unit);
+    size_t getScannedCount() const { return scannedCount; }
+
+    static bool scanText(const std::string& source, ModuleUnit& unit);
+    static bool parseP1689(const std::string& text, ModuleUnit& unit);
+
+private:
+    struct CacheEntry {
+        std::string key;
+        ModuleUnit unit;
+    };
+
+    std::string cachePath;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, CacheEntry> cache;
+    std::atomic<bool> compilerScanFailed{false};
+    std::atomic<size_t> scannedCount{0};
+
+    bool scanWithCompiler(const Compiler& compiler, const Config& config, const std::string& source,
+                          const std::string& object, ModuleUnit& unit);
+};
+
+}
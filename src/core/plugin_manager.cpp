@@ -0,0 +1,102 @@
+#include "plugin_manager.hpp"
+#include "hash.hpp"
+#include "logger.hpp"
+#include <dlfcn.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace OreoBuild {
+
+void ConfigPluginHost::log(PluginLogLevel level, const std::string& message) {
+    switch (level) {
+        case PluginLogLevel::Error: OREO_ERROR(LogCategory::General, message); break;
+        case PluginLogLevel::Warning: OREO_WARN(LogCategory::General, "Warning: " << message); break;
+        case PluginLogLevel::Info: OREO_INFO(LogCategory::General, message); break;
+        case PluginLogLevel::Verbose: OREO_VERBOSE(LogCategory::General, message); break;
+    }
+}
+
+PluginManager::~PluginManager() {
+    // Plugins are destroyed by the library that created them, before it is
+    // unloaded.
+    for (auto it = libraries.rbegin(); it != libraries.rend(); ++it) {
+        if (it->plugin && it->destroy) {
+            it->destroy(it->plugin);
+        }
+        if (it->handle) {
+            dlclose(it->handle);
+        }
+    }
+}
+
+void PluginManager::load(const std::vector<std::string>& paths) {
+    for (const auto& path : paths) {
+        Library library;
+        library.path = path;
+        // A bare file name would make dlopen search the system library path.
+        std::string openPath = path.find('/') == std::string::npos ? "./" + path : path;
+        library.handle = dlopen(openPath.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!library.handle) {
+            throw std::runtime_error("Unable to load plugin " + path + ": " + dlerror());
+        }
+
+        auto abiVersion = reinterpret_cast<OreoBuildPluginAbiVersionFn>(dlsym(library.handle, "oreobuild_plugin_abi_version"));
+        auto create = reinterpret_cast<OreoBuildPluginCreateFn>(dlsym(library.handle, "oreobuild_plugin_create"));
+        library.destroy = reinterpret_cast<OreoBuildPluginDestroyFn>(dlsym(library.handle, "oreobuild_plugin_destroy"));
+        if (!abiVersion || !create || !library.destroy) {
+            dlclose(library.handle);
+            throw std::runtime_error("Plugin " + path + " does not export the oreobuild plugin entry points");
+        }
+        if (abiVersion() != pluginAbiVersion) {
+            uint32_t version = abiVersion();
+            dlclose(library.handle);
+            throw std::runtime_error("Plugin " + path + " was built for plugin ABI version " + std::to_string(version) +
+                                     ", this oreobuild uses version " + std::to_string(pluginAbiVersion));
+        }
+
+        library.plugin = create();
+        if (!library.plugin) {
+            dlclose(library.handle);
+            throw std::runtime_error("Plugin " + path + " failed to initialise");
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        library.digest = Sha256::hash(content.str());
+
+        OREO_VERBOSE(LogCategory::General, "Loaded plugin " << library.plugin->getName() << " from " << path);
+        libraries.push_back(std::move(library));
+    }
+}
+
+std::vector<std::string> PluginManager::getLibraryPaths() const {
+    std::vector<std::string> paths;
+    for (const auto& library : libraries) {
+        paths.push_back(library.path);
+    }
+    return paths;
+}
+
+std::vector<LoadedPluginNode> PluginManager::declareNodes(PluginHost& host) const {
+    std::vector<LoadedPluginNode> nodes;
+    std::unordered_map<std::string, std::string> producers;
+    for (const auto& library : libraries) {
+        for (auto& node : library.plugin->declareNodes(host)) {
+            std::string owner = library.plugin->getName() + ":" + node.name;
+            for (const auto& output : node.outputs) {
+                auto inserted = producers.emplace(output, owner);
+                if (!inserted.second) {
+                    throw std::runtime_error("Plugin nodes " + inserted.first->second + " and " + owner +
+                                             " both produce " + output);
+                }
+            }
+            nodes.push_back(LoadedPluginNode{library.plugin, library.digest, std::move(node)});
+        }
+    }
+    return nodes;
+}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "config.hpp"
+#include "plugins/plugin_interface.hpp"
+#include <string>
+#include <vector>
+
+namespace OreoBuild {
+
+// PluginHost backed by the loaded config and the selected variant.
+class ConfigPluginHost : public PluginHost {
+public:
+    ConfigPluginHost(const Config& config, const std::string& variantDir) : config(config), variantDir(variantDir) {}
+
+    std::string getConfigValue(const std::string& key) const override { return config.getValue(key); }
+    std::string getVariantDir() const override { return variantDir; }
+    void log(PluginLogLevel level, const std::string& message) override;
+
+private:
+    const Config& config;
+    std::string variantDir;
+};
+
+// A node together with the plugin that declared it.
+struct LoadedPluginNode {
+    BuildPlugin* plugin = nullptr;
+    // SHA-256 of the plugin library, so a rebuilt plugin reruns its nodes.
+    std::string pluginDigest;
+    PluginNode node;
+};
+
+// Owns the dlopen'ed plugin libraries and the plugin objects they created.
+class PluginManager {
+public:
+    PluginManager() = default;
+    ~PluginManager();
+    PluginManager(const PluginManager&) = delete;
+    PluginManager& operator=(const PluginManager&) = delete;
+
+    // Throws std::runtime_error when a library cannot be loaded, lacks the
+    // entry points, or was built for another ABI version.
+    void load(const std::vector<std::string>& paths);
+    bool empty() const { return libraries.empty(); }
+    std::vector<std::string> getLibraryPaths() const;
+
+    // Collects the nodes of every plugin; throws when two nodes claim the
+    // same output.
+    std::vector<LoadedPluginNode> declareNodes(PluginHost& host) const;
+
+private:
+    struct Library {
+        std::string path;
+        std::string digest;
+        void* handle = nullptr;
+        BuildPlugin* plugin = nullptr;
+        OreoBuildPluginDestroyFn destroy = nullptr;
+    };
+
+    std::vector<Library> libraries;
+};
+
+}
@@ -0,0 +1,176 @@
+#include "process.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace OreoBuild {
+
+namespace {
+
+// Process groups of the running commands. A fixed table of atomics, so the
+// signal handler can walk it without taking a lock.
+std::array<std::atomic<pid_t>, 1024> runningGroups{};
+std::atomic<bool> cancelled{false};
+volatile std::sig_atomic_t interrupted = 0;
+thread_local ProcessUsage threadUsage;
+
+uint64_t toMicros(const timeval& time) {
+    return static_cast<uint64_t>(time.tv_sec) * 1000000 + time.tv_usec;
+}
+
+void killRunningGroups() {
+    for (auto& group : runningGroups) {
+        pid_t pgid = group.load();
+        if (pgid > 0) {
+            ::killpg(pgid, SIGTERM);
+        }
+    }
+}
+
+void handleInterrupt(int) {
+    interrupted = 1;
+    cancelled = true;
+    killRunningGroups();
+}
+
+}
+
+void ProcessUsage::add(const ProcessUsage& other) {
+    jobs += other.jobs;
+    peakRssKb = std::max(peakRssKb, other.peakRssKb);
+    userMicros += other.userMicros;
+    systemMicros += other.systemMicros;
+    majorFaults += other.majorFaults;
+}
+
+ProcessUsage Process::getThreadUsage() {
+    return threadUsage;
+}
+
+void Process::resetThreadUsage() {
+    threadUsage = ProcessUsage();
+}
+
+int Process::run(const std::string& command) {
+    bool timedOut = false;
+    return run(command, 0, timedOut);
+}
+
+int Process::run(const std::string& command, int timeoutMs, bool& timedOut) {
+    timedOut = false;
+    if (cancelled) {
+        return -1;
+    }
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        ::setpgid(0, 0);
+        ::execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+        ::_exit(127);
+    }
+    // Set from both sides so the group exists before anyone can signal it.
+    ::setpgid(pid, pid);
+
+    std::atomic<pid_t>* slot = nullptr;
+    for (auto& group : runningGroups) {
+        pid_t expected = 0;
+        if (group.compare_exchange_strong(expected, pid)) {
+            slot = &group;
+            break;
+        }
+    }
+    // A cancellation that ran before the slot was filled missed this group.
+    if (cancelled) {
+        ::killpg(pid, SIGTERM);
+    }
+
+    int status = -1;
+    struct rusage usage {};
+    // With a time limit the child is polled, backing off to 20 ms so that
+    // short commands still finish promptly.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    auto pause = std::chrono::milliseconds(1);
+    for (;;) {
+        pid_t waited = ::wait4(pid, &status, timeoutMs > 0 && !timedOut ? WNOHANG : 0, &usage);
+        if (waited == pid) {
+            ProcessUsage used;
+            used.jobs = 1;
+            used.peakRssKb = static_cast<uint64_t>(usage.ru_maxrss);
+            used.userMicros = toMicros(usage.ru_utime);
+            used.systemMicros = toMicros(usage.ru_stime);
+            used.majorFaults = static_cast<uint64_t>(usage.ru_majflt);
+            threadUsage.add(used);
+            break;
+        }
+        if (waited < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            status = -1;
+            break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            timedOut = true;
+            ::killpg(pid, SIGKILL);
+            continue;
+        }
+        std::this_thread::sleep_for(pause);
+        pause = std::min(pause * 2, std::chrono::milliseconds(20));
+    }
+    if (slot) {
+        *slot = 0;
+    }
+    return status;
+}
+
+void Process::cancelAll() {
+    cancelled = true;
+    killRunningGroups();
+}
+
+bool Process::isCancelled() {
+    return cancelled;
+}
+
+void Process::resetCancellation() {
+    // An interrupt stays in effect for the rest of the run.
+    cancelled = interrupted != 0;
+}
+
+void Process::installInterruptHandler() {
+    struct sigaction action {};
+    action.sa_handler = handleInterrupt;
+    // A second signal gets the default action and ends oreobuild at once.
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+}
+
+bool Process::wasInterrupted() {
+    return interrupted != 0;
+}
+
+std::string Process::shellQuote(const std::string& value) {
+    std::string quoted = "'";
+    for (char c : value) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace OreoBuild {
+
+// What finished commands used, as wait4 reports it for each of them and the
+// processes they waited for (cc1plus, as, ld).
+struct ProcessUsage {
+    uint64_t jobs = 0;
+    // Largest resident set of any one command, in KiB.
+    uint64_t peakRssKb = 0;
+    uint64_t userMicros = 0;
+    uint64_t systemMicros = 0;
+    uint64_t majorFaults = 0;
+
+    void add(const ProcessUsage& other);
+};
+
+// Runs the tools a build spawns. Every command gets its own process group, so
+// cancelling a build stops the compiler driver together with everything it
+// started (cc1plus, as, ld), and Ctrl-C reaches oreobuild alone, which then
+// cancels the build the same way instead of leaving half-written outputs.
+class Process {
+public:
+    // Runs command through /bin/sh and returns its wait status, like
+    // std::system. Returns -1 without starting anything once cancelled.
+    static int run(const std::string& command);
+    // Same, but kills the command's process group and sets timedOut once it
+    // has run for timeoutMs; 0 means no limit.
+    static int run(const std::string& command, int timeoutMs, bool& timedOut);
+    // value in single quotes, safe to paste into a command for run().
+    static std::string shellQuote(const std::string& value);
+
+    // Usage of the commands the calling thread ran since its last reset, so
+    // a step run on a worker thread can tell what its commands cost.
+    static ProcessUsage getThreadUsage();
+    static void resetThreadUsage();
+
+    // Terminates every running command's process group; later run() calls
+    // fail until resetCancellation(), which does not undo an interrupt.
+    static void cancelAll();
+    static bool isCancelled();
+    static void resetCancellation();
+
+    // SIGINT and SIGTERM cancel the build; a second one exits immediately.
+    static void installInterruptHandler();
+    static bool wasInterrupted();
+};
+
+}
@@ -0,0 +1,320 @@
+#include "remote_cache.hpp"
+#include "file_utils.hpp"
+#include "hash.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace OreoBuild {
+
+namespace {
+
+// The subset of remote_execution.proto's ActionResult that a compile needs:
+//   ActionResult { repeated OutputFile output_files = 2; }
+//   OutputFile   { string path = 1; Digest digest = 2; }
+//   Digest       { string hash = 1; int64 size_bytes = 2; }
+struct OutputDigest {
+    std::string path;
+    std::string hash;
+    uint64_t size = 0;
+};
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void putLengthDelimited(std::string& out, int field, const std::string& value) {
+    putVarint(out, (static_cast<uint64_t>(field) << 3) | 2);
+    putVarint(out, value.size());
+    out += value;
+}
+
+std::string encodeActionResult(const std::vector<OutputDigest>& files) {
+    std::string result;
+    for (const auto& file : files) {
+        std::string digest;
+        putLengthDelimited(digest, 1, file.hash);
+        putVarint(digest, (2 << 3) | 0);
+        putVarint(digest, file.size);
+
+        std::string outputFile;
+        putLengthDelimited(outputFile, 1, file.path);
+        putLengthDelimited(outputFile, 2, digest);
+        putLengthDelimited(result, 2, outputFile);
+    }
+    return result;
+}
+
+class ProtoReader {
+public:
+    explicit ProtoReader(const std::string& data) : data(data) {}
+
+    bool atEnd() const { return offset >= data.size(); }
+
+    bool next(int& field, int& wireType, uint64_t& varint, std::string& bytes) {
+        uint64_t tag;
+        if (!readVarint(tag)) {
+            return false;
+        }
+        field = static_cast<int>(tag >> 3);
+        wireType = static_cast<int>(tag & 7);
+        switch (wireType) {
+            case 0:
+                return readVarint(varint);
+            case 1:
+                return skip(8);
+            case 2: {
+                uint64_t length;
+                if (!readVarint(length) || length > data.size() - offset) {
+                    return false;
+                }
+                bytes.assign(data, offset, static_cast<size_t>(length));
+                offset += static_cast<size_t>(length);
+                return true;
+            }
+            case 5:
+                return skip(4);
+            default:
+                return false;
+        }
+    }
+
+private:
+    const std::string& data;
+    size_t offset = 0;
+
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && offset < data.size(); shift += 7) {
+            unsigned char byte = static_cast<unsigned char>(data[offset++]);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool skip(size_t count) {
+        if (count > data.size() - offset) {
+            return false;
+        }
+        offset += count;
+        return true;
+    }
+};
+
+bool decodeActionResult(const std::string& data, std::vector<OutputDigest>& files) {
+    ProtoReader reader(data);
+    int field, wireType;
+    uint64_t varint;
+    std::string bytes;
+    while (!reader.atEnd()) {
+        if (!reader.next(field, wireType, varint, bytes)) {
+            return false;
+        }
+        if (field != 2 || wireType != 2) {
+            continue;
+        }
+        OutputDigest file;
+        std::string outputFile = bytes;
+        ProtoReader fileReader(outputFile);
+        while (!fileReader.atEnd()) {
+            if (!fileReader.next(field, wireType, varint, bytes)) {
+                return false;
+            }
+            if (field == 1 && wireType == 2) {
+                file.path = bytes;
+            } else if (field == 2 && wireType == 2) {
+                std::string digest = bytes;
+                ProtoReader digestReader(digest);
+                while (!digestReader.atEnd()) {
+                    if (!digestReader.next(field, wireType, varint, bytes)) {
+                        return false;
+                    }
+                    if (field == 1 && wireType == 2) {
+                        file.hash = bytes;
+                    } else if (field == 2 && wireType == 0) {
+                        file.size = varint;
+                    }
+                }
+            }
+        }
+        files.push_back(file);
+    }
+    return true;
+}
+
+bool readFile(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    content = buffer.str();
+    return true;
+}
+
+}
+
+RemoteCache::RemoteCache(const std::string& url, bool readOnly, int timeoutMs)
+    : client(url, timeoutMs),
+      readOnly(readOnly),
+      timeoutMs(timeoutMs),
+      consecutiveFailures(0),
+      disabled(false) {
+    if (!readOnly) {
+        uploader = std::thread(&RemoteCache::uploadLoop, this);
+    }
+}
+
+RemoteCache::~RemoteCache() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    if (uploader.joinable()) {
+        uploader.join();
+    }
+}
+
+bool RemoteCache::send(const std::string& method, const std::string& path, const std::string& body, HttpResponse& response) {
+    if (disabled) {
+        return false;
+    }
+    if (client.request(method, path, body, response)) {
+        consecutiveFailures = 0;
+        return true;
+    }
+    if (++consecutiveFailures >= maxConsecutiveFailures && !disabled.exchange(true)) {
+        OREO_WARN(LogCategory::Cache, "Warning: Remote cache " << client.getHost() << ":" << client.getPort()
+                  << " is not responding; continuing with local compilation only.");
+    }
+    return false;
+}
+
+bool RemoteCache::fetch(const std::string& actionKey, const std::vector<CacheOutput>& outputs) {
+    HttpResponse response;
+    if (!send("GET", "/ac/" + actionKey, "", response) || response.status != 200) {
+        return false;
+    }
+    std::vector<OutputDigest> files;
+    if (!decodeActionResult(response.body, files)) {
+        return false;
+    }
+
+    // Download everything first so a partial hit never leaves mixed outputs behind.
+    std::vector<std::pair<std::string, std::string>> staged;
+    for (const auto& output : outputs) {
+        auto file = std::find_if(files.begin(), files.end(), [&](const OutputDigest& f) { return f.path == output.name; });
+        if (file == files.end()) {
+            return false;
+        }
+        HttpResponse blob;
+        if (!send("GET", "/cas/" + file->hash, "", blob) || blob.status != 200 ||
+            blob.body.size() != file->size || Sha256::hash(blob.body) != file->hash) {
+            return false;
+        }
+        staged.emplace_back(output.path, std::move(blob.body));
+    }
+
+    for (const auto& [path, content] : staged) {
+        // Renamed into place once complete, like objects compiled locally.
+        std::string scratch = FileUtils::getScratchPath(path);
+        std::ofstream file(scratch, std::ios::binary | std::ios::trunc);
+        file.write(content.data(), content.size());
+        file.close();
+        std::error_code error;
+        if (file.fail()) {
+            std::filesystem::remove(scratch, error);
+            return false;
+        }
+        std::filesystem::rename(scratch, path, error);
+        if (error) {
+            std::filesystem::remove(scratch, error);
+            return false;
+        }
+    }
+    return true;
+}
+
+void RemoteCache::storeAsync(const std::string& actionKey, const std::vector<CacheOutput>& outputs) {
+    if (readOnly || disabled) {
+        return;
+    }
+    PendingUpload pending;
+    pending.actionKey = actionKey;
+    for (const auto& output : outputs) {
+        std::string content;
+        if (!readFile(output.path, content)) {
+            return;
+        }
+        pending.blobs.emplace_back(output.name, std::move(content));
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploads.push_back(std::move(pending));
+    }
+    queueCondition.notify_one();
+}
+
+void RemoteCache::uploadLoop() {
+    std::chrono::steady_clock::time_point drainDeadline;
+    while (true) {
+        PendingUpload pending;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this] { return stopping || !uploads.empty(); });
+            if (uploads.empty()) {
+                return;
+            }
+            if (stopping) {
+                // The build is over; finish what is queued, but never hold up
+                // the exit by more than one timeout period.
+                auto now = std::chrono::steady_clock::now();
+                if (drainDeadline == std::chrono::steady_clock::time_point()) {
+                    drainDeadline = now + std::chrono::milliseconds(timeoutMs);
+                } else if (now > drainDeadline) {
+                    OREO_WARN(LogCategory::Cache, "Warning: Skipped " << uploads.size() << " remote cache upload(s) at exit.");
+                    return;
+                }
+            }
+            pending = std::move(uploads.front());
+            uploads.pop_front();
+        }
+        if (disabled) {
+            continue;
+        }
+        upload(pending);
+    }
+}
+
+bool RemoteCache::upload(const PendingUpload& pending) {
+    std::vector<OutputDigest> files;
+    for (const auto& [name, content] : pending.blobs) {
+        OutputDigest file;
+        file.path = name;
+        file.hash = Sha256::hash(content);
+        file.size = content.size();
+        HttpResponse response;
+        if (!send("PUT", "/cas/" + file.hash, content, response) || response.status >= 300) {
+            return false;
+        }
+        files.push_back(file);
+    }
+    // The action entry goes last so readers never see it before its blobs exist.
+    HttpResponse response;
+    return send("PUT", "/ac/" + pending.actionKey, encodeActionResult(files), response) && response.status < 300;
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "http_client.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace OreoBuild {
+
+// A named output of a cached action and where it lives on disk.
+struct CacheOutput {
+    std::string name;
+    std::string path;
+};
+
+// Content-addressed cache tier speaking the Bazel remote-cache HTTP layout:
+// blobs under /cas/<sha256> and action results (ActionResult protobufs)
+// under /ac/<sha256>. Lookups are synchronous; uploads run on a background
+// thread so they never hold up a compile. Repeated transport failures turn the
+// cache off for the rest of the build, which then compiles locally.
+class RemoteCache {
+public:
+    RemoteCache(const std::string& url, bool readOnly, int timeoutMs);
+    ~RemoteCache();
+
+    // Restores every output of actionKey; returns false on a miss or any error.
+    bool fetch(const std::string& actionKey, const std::vector<CacheOutput>& outputs);
+    // Queues the outputs for upload; a no-op in read-only mode.
+    void storeAsync(const std::string& actionKey, const std::vector<CacheOutput>& outputs);
+
+    bool isReadOnly() const { return readOnly; }
+    bool isAvailable() const { return !disabled; }
+
+private:
+    struct PendingUpload {
+        std::string actionKey;
+        std::vector<std::pair<std::string, std::string>> blobs;  // name, content
+    };
+
+    static const int maxConsecutiveFailures = 3;
+
+    HttpClient client;
+    bool readOnly;
+    int timeoutMs;
+    std::atomic<int> consecutiveFailures;
+    std::atomic<bool> disabled;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    std::deque<PendingUpload> uploads;
+    bool stopping = false;
+    std::thread uploader;
+
+    bool send(const std::string& method, const std::string& path, const std::string& body, HttpResponse& response);
+    void uploadLoop();
+    bool upload(const PendingUpload& pending);
+};
+
+}
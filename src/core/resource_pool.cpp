@@ -0,0 +1,115 @@
+#include "resource_pool.hpp"
+#include "metrics.hpp"
+#include <chrono>
+#include <vector>
+
+namespace OreoBuild {
+
+void ResourcePools::setDepths(const std::map<std::string, int>& depths) {
+    std::vector<Task> startable;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [name, depth] : depths) {
+            Pool& pool = pools[name];
+            pool.depth = depth;
+            while (pool.active < pool.depth && !pool.waiting.empty()) {
+                pool.active++;
+                admitLocked(std::move(pool.waiting.front()), startable);
+                pool.waiting.pop_front();
+            }
+        }
+    }
+    for (auto& task : startable) {
+        start(std::move(task));
+    }
+}
+
+void ResourcePools::setMemoryBudget(uint64_t bytes) {
+    std::vector<Task> startable;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        memoryBudget = bytes;
+        admitWaitingLocked(startable);
+    }
+    for (auto& task : startable) {
+        start(std::move(task));
+    }
+}
+
+void ResourcePools::submit(const std::string& pool, std::function<void()> task, uint64_t memoryBytes) {
+    // Queue wait counts from here, whether the task waits for its pool or
+    // for a free worker.
+    auto submitted = std::chrono::steady_clock::now();
+    task = [task = std::move(task), submitted] {
+        auto started = std::chrono::steady_clock::now();
+        Metrics::observe(Histogram::QueueWaitSeconds, std::chrono::duration<double>(started - submitted).count());
+        task();
+        Metrics::add(Counter::WorkerBusyMicros, std::chrono::duration_cast<std::chrono::microseconds>(
+                                                    std::chrono::steady_clock::now() - started).count());
+    };
+    std::vector<Task> startable;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Task queued{pool, std::move(task), memoryBytes};
+        auto it = pools.find(pool);
+        if (it != pools.end()) {
+            if (it->second.active >= it->second.depth) {
+                it->second.waiting.push_back(std::move(queued));
+                return;
+            }
+            it->second.active++;
+        }
+        admitLocked(std::move(queued), startable);
+    }
+    for (auto& next : startable) {
+        start(std::move(next));
+    }
+}
+
+void ResourcePools::admitLocked(Task task, std::vector<Task>& startable) {
+    memoryWaiting.push_back(std::move(task));
+    admitWaitingLocked(startable);
+}
+
+void ResourcePools::admitWaitingLocked(std::vector<Task>& startable) {
+    while (!memoryWaiting.empty()) {
+        uint64_t needed = memoryWaiting.front().memoryBytes;
+        if (memoryBudget > 0 && memoryInUse > 0 && memoryInUse + needed > memoryBudget) {
+            return;
+        }
+        memoryInUse += needed;
+        startable.push_back(std::move(memoryWaiting.front()));
+        memoryWaiting.pop_front();
+    }
+}
+
+void ResourcePools::start(Task task) {
+    threadPool->enqueue([this, task = std::move(task)] {
+        task.run();
+        finish(task);
+    });
+}
+
+void ResourcePools::finish(const Task& task) {
+    std::vector<Task> startable;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        memoryInUse -= task.memoryBytes;
+        // Hand the pool slot straight to the next waiting task, if any.
+        auto it = pools.find(task.pool);
+        if (it != pools.end()) {
+            if (it->second.waiting.empty() || it->second.active > it->second.depth) {
+                it->second.active--;
+            } else {
+                memoryWaiting.push_back(std::move(it->second.waiting.front()));
+                it->second.waiting.pop_front();
+            }
+        }
+        admitWaitingLocked(startable);
+    }
+    for (auto& next : startable) {
+        start(std::move(next));
+    }
+}
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "thread_pool.hpp"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OreoBuild {
+
+// Ninja-style pools on top of the thread pool. A task in a named pool only
+// starts while fewer than depth tasks of that pool are running; the rest wait
+// in the pool's queue without holding a worker thread. Tasks in no pool (an
+// empty name) are only bounded by the thread pool itself.
+//
+// Past its pool, a task also has to fit the memory budget: the memory
+// estimates of the running tasks plus its own may not exceed it. Tasks wait
+// for memory in submission order, and one always starts when nothing else
+// holds memory, so an estimate above the whole budget only serializes.
+class ResourcePools {
+public:
+    explicit ResourcePools(ThreadPool& threadPool) : threadPool(&threadPool) {}
+
+    void setThreadPool(ThreadPool& pool) { threadPool = &pool; }
+    // Declares or resizes pools; tasks already running are not affected.
+    void setDepths(const std::map<std::string, int>& depths);
+    // 0 turns the memory bound off.
+    void setMemoryBudget(uint64_t bytes);
+    // Runs task on the thread pool as soon as pool and memory budget have
+    // room. Unknown pool names behave like no pool; memoryBytes 0 means
+    // unknown and always fits.
+    void submit(const std::string& pool, std::function<void()> task, uint64_t memoryBytes = 0);
+
+private:
+    struct Task {
+        std::string pool;
+        std::function<void()> run;
+        uint64_t memoryBytes = 0;
+    };
+
+    struct Pool {
+        int depth = 1;
+        int active = 0;
+        std::deque<Task> waiting;
+    };
+
+    ThreadPool* threadPool;
+    std::mutex mutex;
+    std::unordered_map<std::string, Pool> pools;
+    uint64_t memoryBudget = 0;
+    uint64_t memoryInUse = 0;
+    // Tasks holding their pool slot but waiting for memory.
+    std::deque<Task> memoryWaiting;
+
+    // Queues task for memory, then moves every task that fits, in order,
+    // into startable. Called with mutex held.
+    void admitLocked(Task task, std::vector<Task>& startable);
+    void admitWaitingLocked(std::vector<Task>& startable);
+    void start(Task task);
+    void finish(const Task& task);
+};
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace OreoBuild {
+
+// String-keyed map that worker threads update concurrently. Keys are spread
+// over independently locked shards, so compiles finishing at the same time
+// rarely wait on each other.
+template <typename Value>
+class ShardedMap {
+public:
+    void set(const std::string& key, Value value) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.entries[key] = std::move(value);
+    }
+
+    // Runs update on the key's value, value-initialized when missing, while
+    // holding the shard's lock. Returns the updated value.
+    template <typename Update>
+    Value update(const std::string& key, Update update) {
+        Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        Value& value = shard.entries[key];
+        update(value);
+        return value;
+    }
+
+    // False, leaving value alone, when the key is missing.
+    bool find(const std::string& key, Value& value) const {
+        const Shard& shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+
+    void clear() {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.entries.clear();
+        }
+    }
+
+    // Visits every entry one shard at a time; entries written meanwhile may
+    // or may not be seen.
+    template <typename Visit>
+    void forEach(Visit visit) const {
+        for (const auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& [key, value] : shard.entries) {
+                visit(key, value);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t shardCount = 16;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Value> entries;
+    };
+
+    std::array<Shard, shardCount> shards;
+
+    Shard& shardFor(const std::string& key) { return shards[std::hash<std::string>()(key) % shardCount]; }
+    const Shard& shardFor(const std::string& key) const { return shards[std::hash<std::string>()(key) % shardCount]; }
+};
+
+}
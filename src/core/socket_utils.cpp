@@ -0,0 +1,207 @@
+#include "socket_utils.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+namespace OreoBuild {
+
+Socket::~Socket() {
+    close();
+}
+
+Socket::Socket(Socket&& other) noexcept : fd(other.fd) {
+    other.fd = -1;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        close();
+        fd = other.fd;
+        other.fd = -1;
+    }
+    return *this;
+}
+
+void Socket::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+Socket Socket::connectTo(const std::string& host, uint16_t port, int timeoutMs) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* results = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &results) != 0) {
+        return Socket();
+    }
+
+    Socket connected;
+    for (addrinfo* ai = results; ai && !connected.isValid(); ai = ai->ai_next) {
+        Socket candidate(::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol));
+        if (!candidate.isValid()) {
+            continue;
+        }
+
+        // Non-blocking connect so an unreachable worker costs at most timeoutMs.
+        int flags = ::fcntl(candidate.fd, F_GETFL, 0);
+        ::fcntl(candidate.fd, F_SETFL, flags | O_NONBLOCK);
+        int rc = ::connect(candidate.fd, ai->ai_addr, ai->ai_addrlen);
+        if (rc != 0 && errno == EINPROGRESS) {
+            pollfd pfd{candidate.fd, POLLOUT, 0};
+            if (::poll(&pfd, 1, timeoutMs) == 1) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                ::getsockopt(candidate.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+                rc = error == 0 ? 0 : -1;
+            }
+        }
+        if (rc != 0) {
+            continue;
+        }
+        ::fcntl(candidate.fd, F_SETFL, flags);
+
+        int noDelay = 1;
+        ::setsockopt(candidate.fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        candidate.setTimeout(timeoutMs);
+        connected = std::move(candidate);
+    }
+    ::freeaddrinfo(results);
+    return connected;
+}
+
+Socket Socket::listenOn(const std::string& bindAddress, uint16_t port) {
+    Socket listener(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (!listener.isValid()) {
+        throw std::runtime_error(std::string("socket() failed: ") + std::strerror(errno));
+    }
+    int reuse = 1;
+    ::setsockopt(listener.fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* results = nullptr;
+    const char* node = bindAddress.empty() ? nullptr : bindAddress.c_str();
+    if (::getaddrinfo(node, std::to_string(port).c_str(), &hints, &results) != 0 || !results) {
+        throw std::runtime_error("Unable to resolve bind address: " + bindAddress);
+    }
+    int rc = ::bind(listener.fd, results->ai_addr, results->ai_addrlen);
+    ::freeaddrinfo(results);
+    if (rc != 0 || ::listen(listener.fd, 64) != 0) {
+        throw std::runtime_error("Unable to listen on port " + std::to_string(port) + ": " + std::strerror(errno));
+    }
+    return listener;
+}
+
+Socket Socket::accept() const {
+    int client = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+    return Socket(client);
+}
+
+void Socket::setTimeout(int timeoutMs) {
+    timeval tv{};
+    tv.tv_sec = timeoutMs / 1000;
+    tv.tv_usec = (timeoutMs % 1000) * 1000;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool Socket::sendAll(const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t sent = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool Socket::recvAll(void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t received = ::recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+long Socket::recvSome(void* data, size_t size) {
+    while (true) {
+        ssize_t received = ::recv(fd, data, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        return static_cast<long>(received);
+    }
+}
+
+bool Socket::sendFrame(const std::string& payload) {
+    uint64_t size = payload.size();
+    unsigned char header[8];
+    for (int i = 7; i >= 0; --i) {
+        header[i] = static_cast<unsigned char>(size & 0xff);
+        size >>= 8;
+    }
+    return sendAll(header, sizeof(header)) && sendAll(payload.data(), payload.size());
+}
+
+bool Socket::recvFrame(std::string& payload, size_t maxSize) {
+    unsigned char header[8];
+    if (!recvAll(header, sizeof(header))) {
+        return false;
+    }
+    uint64_t size = 0;
+    for (unsigned char byte : header) {
+        size = (size << 8) | byte;
+    }
+    if (size > maxSize) {
+        return false;
+    }
+    payload.resize(static_cast<size_t>(size));
+    return size == 0 || recvAll(&payload[0], payload.size());
+}
+
+bool parseHostPort(const std::string& address, std::string& host, uint16_t& port) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+        return false;
+    }
+    try {
+        int value = std::stoi(address.substr(colon + 1));
+        if (value <= 0 || value > 65535) {
+            return false;
+        }
+        port = static_cast<uint16_t>(value);
+    } catch (const std::exception&) {
+        return false;
+    }
+    host = address.substr(0, colon);
+    return true;
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace OreoBuild {
+
+// Owning wrapper around a blocking TCP socket.
+class Socket {
+public:
+    Socket() = default;
+    explicit Socket(int fd) : fd(fd) {}
+    ~Socket();
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    bool isValid() const { return fd >= 0; }
+    int getFd() const { return fd; }
+    void close();
+
+    // Returns an invalid socket when the connection cannot be established
+    // within timeoutMs. The same timeout then applies to every send/receive.
+    static Socket connectTo(const std::string& host, uint16_t port, int timeoutMs);
+    // Binds and listens; throws std::runtime_error on failure.
+    static Socket listenOn(const std::string& bindAddress, uint16_t port);
+    Socket accept() const;
+
+    void setTimeout(int timeoutMs);
+    bool sendAll(const void* data, size_t size);
+    bool recvAll(void* data, size_t size);
+    // Reads whatever is available, up to size bytes; 0 on EOF, -1 on error.
+    long recvSome(void* data, size_t size);
+
+    // Length-prefixed frames used by the worker protocol.
+    bool sendFrame(const std::string& payload);
+    bool recvFrame(std::string& payload, size_t maxSize = 1ull << 30);
+
+private:
+    int fd = -1;
+};
+
+// Splits "host:port"; returns false when the port is missing or invalid.
+bool parseHostPort(const std::string& address, std::string& host, uint16_t& port);
+
+}
@@ -0,0 +1,158 @@
+#include "time_trace_report.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace OreoBuild {
+
+namespace {
+
+void accumulate(std::unordered_map<std::string, TimeTraceReport::Entry>& table, const std::string& name, uint64_t durationUs) {
+    auto& entry = table[name];
+    if (entry.name.empty()) {
+        entry.name = name;
+    }
+    entry.totalUs += durationUs;
+    entry.maxUs = std::max(entry.maxUs, durationUs);
+    entry.count++;
+}
+
+void merge(std::unordered_map<std::string, TimeTraceReport::Entry>& into,
+           const std::unordered_map<std::string, TimeTraceReport::Entry>& from) {
+    for (const auto& item : from) {
+        auto& entry = into[item.first];
+        if (entry.name.empty()) {
+            entry.name = item.first;
+        }
+        entry.totalUs += item.second.totalUs;
+        entry.maxUs = std::max(entry.maxUs, item.second.maxUs);
+        entry.count += item.second.count;
+    }
+}
+
+std::string formatMs(uint64_t micros) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(1) << micros / 1000.0 << " ms";
+    return stream.str();
+}
+
+void writeTable(std::ostream& out, const std::string& title, const std::vector<TimeTraceReport::Entry>& entries) {
+    out << title << ":\n";
+    if (entries.empty()) {
+        out << "  (none)\n";
+        return;
+    }
+    for (const auto& entry : entries) {
+        out << "  " << std::setw(12) << formatMs(entry.totalUs)
+            << "  x" << std::left << std::setw(5) << entry.count << std::right
+            << "  avg " << std::setw(10) << formatMs(entry.totalUs / entry.count)
+            << "  " << entry.name << "\n";
+    }
+}
+
+}
+
+bool TimeTraceReport::addTrace(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    JsonValue root;
+    if (!Json::parse(text, root)) {
+        return false;
+    }
+    const JsonValue* events = root.type == JsonValue::Type::Array ? &root : root.find("traceEvents");
+    if (!events || events->type != JsonValue::Type::Array) {
+        return false;
+    }
+
+    // Fold into locals first so the lock is only held for the merge.
+    std::unordered_map<std::string, Entry> localHeaders;
+    std::unordered_map<std::string, Entry> localInstantiations;
+    uint64_t localFrontend = 0;
+    uint64_t localBackend = 0;
+    uint64_t localTotal = 0;
+
+    for (const auto& event : events->array) {
+        const JsonValue* phase = event.find("ph");
+        const JsonValue* name = event.find("name");
+        const JsonValue* duration = event.find("dur");
+        if (!phase || phase->string != "X" || !name || !duration) {
+            continue;
+        }
+        uint64_t durationUs = static_cast<uint64_t>(std::max(0.0, duration->number));
+        const JsonValue* args = event.find("args");
+        const JsonValue* detail = args ? args->find("detail") : nullptr;
+
+        if (name->string == "Source" && detail) {
+            accumulate(localHeaders, detail->string, durationUs);
+        } else if ((name->string == "InstantiateClass" || name->string == "InstantiateFunction") && detail) {
+            accumulate(localInstantiations, detail->string, durationUs);
+        } else if (name->string == "Frontend") {
+            localFrontend += durationUs;
+        } else if (name->string == "Backend") {
+            localBackend += durationUs;
+        } else if (name->string == "ExecuteCompiler") {
+            localTotal += durationUs;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    merge(headers, localHeaders);
+    merge(instantiations, localInstantiations);
+    frontendUs += localFrontend;
+    backendUs += localBackend;
+    totalUs += localTotal;
+    traceCount++;
+    return true;
+}
+
+std::vector<TimeTraceReport::Entry> TimeTraceReport::ranked(const std::unordered_map<std::string, Entry>& table, size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Entry> entries;
+    entries.reserve(table.size());
+    for (const auto& item : table) {
+        entries.push_back(item.second);
+    }
+    size_t count = std::min(limit, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), [](const Entry& a, const Entry& b) {
+        return a.totalUs != b.totalUs ? a.totalUs > b.totalUs : a.name < b.name;
+    });
+    entries.resize(count);
+    return entries;
+}
+
+void TimeTraceReport::write(std::ostream& out, size_t limit) const {
+    uint64_t frontend, backend, total;
+    size_t traces;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frontend = frontendUs;
+        backend = backendUs;
+        total = totalUs;
+        traces = traceCount;
+    }
+
+    out << "Compile time report (" << traces << " translation unit(s))\n";
+    out << "  Total:    " << formatMs(total) << "\n";
+    out << "  Frontend: " << formatMs(frontend);
+    if (total > 0) {
+        out << " (" << (frontend * 100 / total) << "%)";
+    }
+    out << "\n  Backend:  " << formatMs(backend);
+    if (total > 0) {
+        out << " (" << (backend * 100 / total) << "%)";
+    }
+    out << "\n\n";
+    writeTable(out, "Most expensive headers (inclusive parse time)", getTopHeaders(limit));
+    out << "\n";
+    writeTable(out, "Most expensive template instantiations", getTopInstantiations(limit));
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace OreoBuild {
+
+// Aggregates clang -ftime-trace files across a whole build: inclusive time
+// per header, time per template instantiation, and the frontend/backend split.
+class TimeTraceReport {
+public:
+    struct Entry {
+        std::string name;
+        uint64_t totalUs = 0;
+        uint64_t maxUs = 0;
+        uint64_t count = 0;
+    };
+
+    // Parses one trace and folds it in. Safe to call from several threads.
+    bool addTrace(const std::string& path);
+
+    size_t getTraceCount() const { return traceCount; }
+    std::vector<Entry> getTopHeaders(size_t limit) const { return ranked(headers, limit); }
+    std::vector<Entry> getTopInstantiations(size_t limit) const { return ranked(instantiations, limit); }
+
+    // Writes the ranked tables, at most limit rows each.
+    void write(std::ostream& out, size_t limit) const;
+
+private:
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> headers;
+    std::unordered_map<std::string, Entry> instantiations;
+    uint64_t frontendUs = 0;
+    uint64_t backendUs = 0;
+    uint64_t totalUs = 0;
+    size_t traceCount = 0;
+
+    std::vector<Entry> ranked(const std::unordered_map<std::string, Entry>& table, size_t limit) const;
+};
+
+}
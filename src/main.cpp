@@ -1,6 +1,7 @@
 #include "core/build_system.hpp"
 #include "cli_handler.hpp"
 #include "color.hpp"
+#include "core/logger.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -16,6 +17,13 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // JSON output owns stdout, so keep the config summary off it too.
+    for (int i = 2; i < argc; ++i) {
+        if (std::string(argv[i]) == "--format=json") {
+            OreoBuild::Logger::setLevel(OreoBuild::LogLevel::Warning);
+        }
+    }
+
     try {
         OreoBuild::BuildSystem buildSystem;
         
@@ -30,13 +38,17 @@ int main(int argc, char* argv[]) {
         try {
             buildSystem.loadConfig(argv[1]);
         } catch (const std::exception& e) {
+            OreoBuild::Logger::shutdown();
             std::cerr << Color::Red << "Error loading config: " << e.what() << Color::Reset << std::endl;
             return 1;
         }
 
         CLIHandler cliHandler(buildSystem);
-        return cliHandler.run(argc - 1, argv + 1);  // Skip the config file argument
+        int result = cliHandler.run(argc - 2, argv + 2);  // Skip the program name and config file arguments
+        OreoBuild::Logger::shutdown();
+        return result;
     } catch (const std::exception& e) {
+        OreoBuild::Logger::shutdown();
         std::cerr << Color::Red << "Error: " << e.what() << Color::Reset << std::endl;
         return 1;
     }
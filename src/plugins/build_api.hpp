@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+// Typed API for build descriptions written in C++. Pass a .cpp file where a
+// config file would go (oreobuild build.cpp build):
+//
+//     #include "plugins/build_api.hpp"
+//
+//     constexpr std::string_view sources[] = {"main.cpp", "util.cpp"};
+//
+//     OREOBUILD_DESCRIPTION(project) {
+//         project.executable("app")
+//                .sources(sources)
+//                .includePaths({"include"})
+//                .libraries({"m"});
+//     }
+//
+// oreobuild compiles the description once into a shared object cached in
+// .oreobuild/ next to it, keyed by the file's content and
+// descriptionAbiVersion, and afterwards only loads it. Descriptions should
+// not include project headers, whose changes the key would miss.
+namespace OreoBuild {
+
+// Bumped whenever the entry points or Project's config keys change meaning.
+constexpr uint32_t descriptionAbiVersion = 1;
+
+// Plain C callback, so no standard library type crosses the boundary.
+using DescriptionEmitFn = void (*)(void* context, const char* key, const char* value);
+
+// Builder over the same keys a key = value config file uses.
+class Project {
+public:
+    Project(DescriptionEmitFn emit, void* context) : emit(emit), context(context) {}
+
+    Project& compiler(std::string_view driver) { return set("compiler", driver); }
+    Project& executable(std::string_view output) { return set("output", output); }
+    Project& buildDir(std::string_view dir) { return set("build_dir", dir); }
+    Project& debugFlags(std::string_view flags) { return set("debug_flags", flags); }
+    Project& releaseFlags(std::string_view flags) { return set("release_flags", flags); }
+    Project& jobs(int count) { return set("jobs", std::to_string(count)); }
+    Project& lto(std::string_view mode) { return set("lto", mode); }
+    Project& modules(bool enabled = true) { return set("modules", enabled ? "true" : "false"); }
+
+    // Lists accept braced lists or any range of string-like values, such as
+    // constexpr arrays of std::string_view.
+    Project& sources(std::initializer_list<std::string_view> files) { return setList("sources", files); }
+    template <typename Range>
+    Project& sources(const Range& files) { return setList("sources", files); }
+    Project& includePaths(std::initializer_list<std::string_view> paths) { return setList("include_paths", paths); }
+    template <typename Range>
+    Project& includePaths(const Range& paths) { return setList("include_paths", paths); }
+    Project& libraries(std::initializer_list<std::string_view> names) { return setList("libraries", names); }
+    template <typename Range>
+    Project& libraries(const Range& names) { return setList("libraries", names); }
+    Project& plugins(std::initializer_list<std::string_view> paths) { return setList("plugins", paths); }
+    template <typename Range>
+    Project& plugins(const Range& paths) { return setList("plugins", paths); }
+
+    // Any other config key, with the value a config file would give it.
+    Project& set(std::string_view key, std::string_view value) {
+        emit(context, std::string(key).c_str(), std::string(value).c_str());
+        return *this;
+    }
+
+private:
+    DescriptionEmitFn emit;
+    void* context;
+
+    template <typename Range>
+    Project& setList(std::string_view key, const Range& items) {
+        std::string joined;
+        for (const auto& item : items) {
+            if (!joined.empty()) {
+                joined += ", ";
+            }
+            joined += std::string_view(item);
+        }
+        return set(key, joined);
+    }
+};
+
+}
+
+#define OREOBUILD_DESCRIPTION(project) \
+    static void oreobuildDescribe(OreoBuild::Project& project); \
+    extern "C" uint32_t oreobuild_description_abi_version() { return OreoBuild::descriptionAbiVersion; } \
+    extern "C" void oreobuild_describe(OreoBuild::DescriptionEmitFn emit, void* context) { \
+        OreoBuild::Project description(emit, context); \
+        oreobuildDescribe(description); \
+    } \
+    static void oreobuildDescribe(OreoBuild::Project& project)
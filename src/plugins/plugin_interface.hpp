@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ABI between oreobuild and in-process build-step plugins. A plugin is a
+// shared library, listed under "plugins" in the config, that is built against
+// this header with the same compiler and standard library as oreobuild and
+// exports the three functions below, most easily through OREOBUILD_PLUGIN().
+namespace OreoBuild {
+
+// Bumped whenever anything in this header changes layout or meaning.
+constexpr uint32_t pluginAbiVersion = 2;
+
+// One step in the build graph. Nodes run before anything is compiled, each
+// after the nodes that produce its inputs, and only when out of date.
+struct PluginNode {
+    // Unique within the plugin, e.g. "protoc:api/user.proto".
+    std::string name;
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    // Anything else the outputs depend on, such as tool options or versions.
+    // A change reruns the node just like a changed compile command.
+    std::string signature;
+    // Whether outputs may be fetched from and stored in the remote cache.
+    bool cacheable = true;
+    // Resource pool (see "pools" in the config) that bounds how many heavy
+    // steps run at once; empty for none.
+    std::string pool;
+};
+
+enum class PluginLogLevel {
+    Error,
+    Warning,
+    Info,
+    Verbose
+};
+
+// Services oreobuild offers to plugins; safe to call from run().
+class PluginHost {
+public:
+    virtual ~PluginHost() = default;
+    // Value of a config file entry, empty when not set.
+    virtual std::string getConfigValue(const std::string& key) const = 0;
+    virtual std::string getVariantDir() const = 0;
+    virtual void log(PluginLogLevel level, const std::string& message) = 0;
+};
+
+class BuildPlugin {
+public:
+    virtual ~BuildPlugin() = default;
+    virtual std::string getName() const = 0;
+    // Called once per build, before any up-to-date check. Nodes should follow
+    // from the config and the files they name: a build in which no recorded
+    // file changed skips plugins altogether.
+    virtual std::vector<PluginNode> declareNodes(PluginHost& host) = 0;
+    // Produces node.outputs from node.inputs and returns false on failure.
+    // Runs on the build's thread pool, possibly alongside other nodes of the
+    // same plugin.
+    virtual bool run(const PluginNode& node, PluginHost& host) = 0;
+};
+
+}
+
+extern "C" {
+typedef uint32_t (*OreoBuildPluginAbiVersionFn)();
+typedef OreoBuild::BuildPlugin* (*OreoBuildPluginCreateFn)();
+typedef void (*OreoBuildPluginDestroyFn)(OreoBuild::BuildPlugin*);
+}
+
+#define OREOBUILD_PLUGIN(PluginClass) \
+    extern "C" uint32_t oreobuild_plugin_abi_version() { return OreoBuild::pluginAbiVersion; } \
+    extern "C" OreoBuild::BuildPlugin* oreobuild_plugin_create() { return new PluginClass(); } \
+    extern "C" void oreobuild_plugin_destroy(OreoBuild::BuildPlugin* plugin) { delete plugin; }
@@ -0,0 +1,231 @@
+#include "core/distributed_protocol.hpp"
+#include "core/socket_utils.hpp"
+#include "core/process.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <set>
+#include <filesystem>
+#include <cerrno>
+#include <cstdlib>
+#include <csignal>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace OreoBuild;
+
+namespace {
+
+// Compilers a client may ask for; anything else is rejected so that job
+// requests cannot run arbitrary programs on the worker.
+const std::set<std::string> allowedCompilers = {"g++", "gcc", "c++", "cc", "clang++", "clang"};
+
+class SlotLimiter {
+public:
+    explicit SlotLimiter(unsigned slots) : available(slots) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return available > 0; });
+        --available;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++available;
+        }
+        condition.notify_one();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    unsigned available;
+};
+
+std::string readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::ostringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+RemoteCompileResult runJob(const RemoteCompileJob& job, const std::filesystem::path& workDir) {
+    static std::atomic<unsigned long> jobCounter(0);
+    RemoteCompileResult result;
+
+    if (allowedCompilers.count(job.compiler) == 0) {
+        result.diagnostics = "oreobuild-worker: compiler not allowed: " + job.compiler + "\n";
+        return result;
+    }
+    if (DistributedProtocol::toolchainFingerprint(job.compiler) != job.toolchainFingerprint) {
+        result.status = JobStatus::ToolchainMismatch;
+        return result;
+    }
+
+    std::ostringstream command;
+    command << "cd " << Process::shellQuote(workDir.string()) << " && " << Process::shellQuote(job.compiler);
+    for (const auto& flag : job.flags) {
+        if (!DistributedProtocol::isAllowedFlag(flag)) {
+            result.diagnostics = "oreobuild-worker: flag not allowed: " + flag + "\n";
+            return result;
+        }
+        command << ' ' << Process::shellQuote(flag);
+    }
+
+    std::filesystem::path base = workDir / ("job-" + std::to_string(jobCounter++));
+    std::filesystem::path input = base.string() + ".ii";
+    std::filesystem::path object = base.string() + ".o";
+    std::filesystem::path diagnostics = base.string() + ".err";
+    {
+        std::ofstream file(input, std::ios::binary);
+        file.write(job.preprocessedSource.data(), job.preprocessedSource.size());
+        if (!file) {
+            result.diagnostics = "oreobuild-worker: unable to write " + input.string() + "\n";
+            return result;
+        }
+    }
+
+    command << " -c " << Process::shellQuote(input.string()) << " -o " << Process::shellQuote(object.string())
+            << " 2> " << Process::shellQuote(diagnostics.string());
+    int exitCode = std::system(command.str().c_str());
+
+    result.diagnostics = readFile(diagnostics);
+    if (exitCode == 0) {
+        result.status = JobStatus::Ok;
+        result.object = readFile(object);
+    } else {
+        result.status = JobStatus::CompileError;
+    }
+
+    std::error_code ignored;
+    std::filesystem::remove(input, ignored);
+    std::filesystem::remove(object, ignored);
+    std::filesystem::remove(diagnostics, ignored);
+    return result;
+}
+
+void serveConnection(Socket connection, SlotLimiter& limiter, unsigned slots, const std::filesystem::path& workDir) {
+    std::string payload;
+    while (connection.recvFrame(payload)) {
+        MessageType type;
+        if (!DistributedProtocol::peekType(payload, type)) {
+            return;
+        }
+
+        if (type == MessageType::Hello) {
+            HelloRequest request;
+            HelloReply reply;
+            if (DistributedProtocol::decode(payload, request)) {
+                bool usable = allowedCompilers.count(request.compiler) != 0 &&
+                              DistributedProtocol::toolchainFingerprint(request.compiler) == request.toolchainFingerprint;
+                reply.status = usable ? JobStatus::Ok : JobStatus::ToolchainMismatch;
+                reply.slots = slots;
+            }
+            if (!connection.sendFrame(DistributedProtocol::encode(reply))) {
+                return;
+            }
+        } else {
+            RemoteCompileJob job;
+            RemoteCompileResult result;
+            if (DistributedProtocol::decode(payload, job)) {
+                limiter.acquire();
+                result = runJob(job, workDir);
+                limiter.release();
+            } else {
+                result.diagnostics = "oreobuild-worker: malformed or incompatible job request\n";
+            }
+            if (!connection.sendFrame(DistributedProtocol::encode(result))) {
+                return;
+            }
+        }
+    }
+}
+
+// Parses a whole decimal number in [min, max]; false on anything else.
+bool parseNumber(const std::string& text, long min, long max, long& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtol(text.c_str(), &end, 10);
+    return !text.empty() && *end == '\0' && errno != ERANGE && value >= min && value <= max;
+}
+
+// SIGINT and SIGTERM are blocked in every thread and taken here instead, so
+// the scratch directory can be removed with ordinary code before exiting.
+void removeWorkDirOnSignal(sigset_t signals, std::filesystem::path workDir) {
+    int received = 0;
+    sigwait(&signals, &received);
+    std::error_code ignored;
+    std::filesystem::remove_all(workDir, ignored);
+    std::_Exit(128 + received);
+}
+
+void printUsage() {
+    std::cout << "Usage: oreobuild-worker [--port=<port>] [--bind=<address>] [--slots=<n>]" << std::endl;
+    std::cout << "  --port=<port>     TCP port to listen on (default 3633)" << std::endl;
+    std::cout << "  --bind=<address>  Address to bind (default 127.0.0.1; the worker has no authentication," << std::endl;
+    std::cout << "                    so only expose it, e.g. with --bind=0.0.0.0, on a trusted network)" << std::endl;
+    std::cout << "  --slots=<n>       Concurrent compile jobs (default: hardware threads)" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    uint16_t port = 3633;
+    std::string bindAddress = "127.0.0.1";
+    unsigned slots = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        long value = 0;
+        if (arg.substr(0, 7) == "--port=" && parseNumber(arg.substr(7), 1, 65535, value)) {
+            port = static_cast<uint16_t>(value);
+        } else if (arg.substr(0, 7) == "--bind=") {
+            bindAddress = arg.substr(7);
+        } else if (arg.substr(0, 8) == "--slots=" && parseNumber(arg.substr(8), 1, 4096, value)) {
+            slots = static_cast<unsigned>(value);
+        } else {
+            printUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::filesystem::path workDir = std::filesystem::temp_directory_path() /
+                                    ("oreobuild-worker-" + std::to_string(::getpid()));
+    std::filesystem::create_directories(workDir);
+
+    // Blocked before any other thread starts, so all of them inherit it.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::thread(removeWorkDirOnSignal, signals, workDir).detach();
+
+    try {
+        Socket listener = Socket::listenOn(bindAddress, port);
+        SlotLimiter limiter(slots);
+        std::cout << "oreobuild-worker listening on port " << port << " with " << slots << " slot(s)" << std::endl;
+
+        while (true) {
+            Socket connection = listener.accept();
+            if (!connection.isValid()) {
+                continue;
+            }
+            std::thread(serveConnection, std::move(connection), std::ref(limiter), slots, workDir).detach();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::error_code ignored;
+        std::filesystem::remove_all(workDir, ignored);
+        return 1;
+    }
+}
@@ -0,0 +1,125 @@
+#!/usr/bin/env bash
+# End-to-end check of distributed compilation with two oreobuild-worker
+# processes on localhost plus one unreachable address: remote compiles, a
+# remote compile error, flags workers refuse, and local fallback once every
+# worker is gone.
+#
+# Usage: distributed_test.sh <oreobuild> <oreobuild-worker>
+set -euo pipefail
+
+oreobuild=$(realpath "$1")
+worker=$(realpath "$2")
+work=$(mktemp -d)
+workers=()
+ports=()
+
+cleanup() {
+    stop_workers
+    rm -rf "$work"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# Workers take a fixed port, so try random ones until one is free.
+start_worker() {
+    for _ in $(seq 20); do
+        local port=$((20000 + RANDOM % 40000))
+        "$worker" --port="$port" --slots=1 > "$work/worker-$port.log" 2>&1 &
+        local pid=$!
+        for _ in $(seq 50); do
+            grep -q listening "$work/worker-$port.log" && break
+            kill -0 "$pid" 2>/dev/null || break
+            sleep 0.1
+        done
+        if kill -0 "$pid" 2>/dev/null; then
+            workers+=("$pid")
+            ports+=("$port")
+            return
+        fi
+    done
+    fail "no worker could start"
+}
+
+stop_workers() {
+    for pid in "${workers[@]}"; do
+        kill "$pid" 2>/dev/null || true
+        wait "$pid" 2>/dev/null || true
+    done
+    workers=()
+}
+
+write_config() {
+    cat > "$work/project/config.txt" <<EOF
+compiler = g++
+sources = main.cpp, a.cpp, b.cpp, c.cpp, d.cpp, e.cpp
+output = app
+include_paths = .
+distributed_workers = 127.0.0.1:${ports[0]}, 127.0.0.1:${ports[1]}, 127.0.0.1:1
+distributed_timeout_ms = 10000
+$1
+EOF
+}
+
+# Clean build, or an incremental one when $3 is "incremental"; $2 is the
+# expected exit status.
+build() {
+    local status=0
+    if [ "${3:-}" != incremental ]; then
+        (cd "$work/project" && "$oreobuild" config.txt clean --force > /dev/null 2>&1)
+    fi
+    (cd "$work/project" && "$oreobuild" config.txt build 2>&1) > "$work/build.log" || status=$?
+    if [ "$status" -ne "$2" ]; then
+        cat "$work/build.log" >&2
+        fail "$1: build exited with $status"
+    fi
+}
+
+count() {
+    grep -c "$1" "$2" || true
+}
+
+mkdir -p "$work/project"
+cat > "$work/project/main.cpp" <<'EOF'
+#include <cstdio>
+int a(); int b(); int c(); int d(); int e();
+int main() { std::printf("%d\n", a() + b() + c() + d() + e()); }
+EOF
+for name in a b c d e; do
+    echo "int $name() { return 1; }" > "$work/project/$name.cpp"
+done
+
+start_worker
+start_worker
+write_config ""
+
+build "remote build" 0
+[ "$("$work/project/build/debug/app")" = "5" ] || fail "remote build: wrong program output"
+for port in "${ports[@]}"; do
+    [ "$(count "Compiling: .* on 127.0.0.1:$port" "$work/build.log")" -ge 1 ] ||
+        fail "remote build: worker on port $port got no job"
+done
+
+# Only c.cpp is out of date, so a worker is free for it; in a clean build
+# it could land on the local compiler while both workers are busy.
+echo 'int c() { return 1 }' > "$work/project/c.cpp"
+build "remote compile error" 1 incremental
+[ "$(count 'Compilation failed on remote worker: c.cpp' "$work/build.log")" = 1 ] ||
+    fail "remote compile error: error not reported"
+echo 'int c() { return 1; }' > "$work/project/c.cpp"
+
+# -include names a file on the worker, so the unit has to stay local.
+write_config "debug_flags = -g -include cstdio"
+build "refused flag" 0
+[ "$(count 'Compiling: .* on 127.0.0.1' "$work/build.log")" = 0 ] || fail "refused flag: compiled remotely"
+
+stop_workers
+write_config ""
+build "workers down" 0
+[ "$("$work/project/build/debug/app")" = "5" ] || fail "workers down: wrong program output"
+[ "$(count 'Compiling: .* on 127.0.0.1' "$work/build.log")" = 0 ] || fail "workers down: compiled remotely"
+
+echo "distributed test passed"
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""Stand-in for a Bazel-style HTTP remote cache, for the remote cache tests.
+
+Keeps /ac/<key> and /cas/<hash> blobs in memory, answers GET and PUT, and
+logs one "<METHOD> <path> <status>" line per request to --log. The port it
+listens on (0 picks a free one) is written to --port-file once it accepts
+connections. --bad-content-length answers every GET with an unparsable
+Content-Length, to check that the client treats it as a failed response.
+"""
+
+import argparse
+import http.server
+import os
+import threading
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    blobs = {}
+    lock = threading.Lock()
+
+    def record(self, status):
+        with self.lock:
+            self.server.log.write(f"{self.command} {self.path} {status}\n")
+            self.server.log.flush()
+
+    def do_GET(self):
+        with self.lock:
+            body = self.blobs.get(self.path)
+        if self.server.bad_content_length:
+            self.send_response(200)
+            self.send_header("Content-Length", "99999999999999999999999999")
+            self.end_headers()
+            self.record(200)
+            return
+        if body is None:
+            self.send_response(404)
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            self.record(404)
+            return
+        self.send_response(200)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+        self.record(200)
+
+    def do_PUT(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", "0")))
+        with self.lock:
+            self.blobs[self.path] = body
+        self.send_response(200)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+        self.record(200)
+
+    def log_message(self, format, *args):
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", type=int, default=0)
+    parser.add_argument("--port-file", required=True)
+    parser.add_argument("--log", required=True)
+    parser.add_argument("--bad-content-length", action="store_true")
+    args = parser.parse_args()
+
+    server = http.server.ThreadingHTTPServer(("127.0.0.1", args.port), Handler)
+    server.log = open(args.log, "a")
+    server.bad_content_length = args.bad_content_length
+    with open(args.port_file + ".tmp", "w") as port_file:
+        port_file.write(str(server.server_address[1]))
+    # Renamed into place so readers never see a half-written port.
+    os.replace(args.port_file + ".tmp", args.port_file)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,109 @@
+#!/usr/bin/env bash
+# End-to-end check of the remote object cache against tests/http_cache_server.py:
+# uploads after a build, a clean rebuild served from the cache, read-only
+# mode, a malformed response, and local compilation once the server is gone.
+#
+# Usage: remote_cache_test.sh <oreobuild> <python3>
+set -euo pipefail
+
+oreobuild=$(realpath "$1")
+python=$2
+here=$(cd "$(dirname "$0")" && pwd)
+work=$(mktemp -d)
+server=
+
+cleanup() {
+    stop_server
+    rm -rf "$work"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+start_server() {
+    rm -f "$work/port"
+    "$python" "$here/http_cache_server.py" --port-file="$work/port" --log="$work/server.log" "$@" &
+    server=$!
+    for _ in $(seq 100); do
+        [ -s "$work/port" ] && break
+        sleep 0.1
+    done
+    [ -s "$work/port" ] || fail "cache server did not start"
+    port=$(cat "$work/port")
+}
+
+stop_server() {
+    if [ -n "$server" ]; then
+        kill "$server" 2>/dev/null || true
+        wait "$server" 2>/dev/null || true
+        server=
+    fi
+}
+
+write_config() {
+    cat > "$work/project/config.txt" <<EOF
+compiler = g++
+sources = main.cpp, a.cpp, b.cpp
+output = app
+include_paths = .
+remote_cache = http://127.0.0.1:$1
+remote_cache_timeout_ms = 1000
+$2
+EOF
+}
+
+build() {
+    (cd "$work/project" && "$oreobuild" config.txt clean --force > /dev/null 2>&1 &&
+        "$oreobuild" config.txt build 2>&1) > "$work/build.log" || {
+        cat "$work/build.log" >&2
+        fail "$1: build failed"
+    }
+    [ "$("$work/project/build/debug/app")" = "6" ] || fail "$1: wrong program output"
+}
+
+count() {
+    grep -c "$1" "$2" || true
+}
+
+mkdir -p "$work/project"
+cat > "$work/project/main.cpp" <<'EOF'
+#include <cstdio>
+int a();
+int b();
+int main() { std::printf("%d\n", a() + b()); }
+EOF
+echo 'int a() { return 2; }' > "$work/project/a.cpp"
+echo 'int b() { return 4; }' > "$work/project/b.cpp"
+
+start_server
+write_config "$port" ""
+
+build "first build"
+[ "$(count 'Cache hit' "$work/build.log")" = 0 ] || fail "first build: unexpected cache hit"
+# The uploader drains its queue before oreobuild exits.
+[ "$(count '^PUT /ac/' "$work/server.log")" = 3 ] || fail "first build: expected 3 action uploads"
+
+build "clean rebuild"
+[ "$(count 'Cache hit' "$work/build.log")" = 3 ] || fail "clean rebuild: expected 3 cache hits"
+
+write_config "$port" "remote_cache_read_only = true"
+echo 'int b() { return 4 + 0; }' > "$work/project/b.cpp"
+uploads=$(count '^PUT ' "$work/server.log")
+build "read-only build"
+[ "$(count 'Cache hit' "$work/build.log")" = 2 ] || fail "read-only build: expected 2 cache hits"
+[ "$(count '^PUT ' "$work/server.log")" = "$uploads" ] || fail "read-only build: uploaded anyway"
+stop_server
+
+start_server --bad-content-length
+write_config "$port" ""
+build "malformed response"
+[ "$(count 'Cache hit' "$work/build.log")" = 0 ] || fail "malformed response: unexpected cache hit"
+stop_server
+
+build "server down"
+[ "$(count 'Compiled:' "$work/build.log")" = 3 ] || fail "server down: expected 3 local compiles"
+
+echo "remote cache test passed"